@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the helpers for the benchmark programmes.
+ */
+
+#ifndef BENCHMARK_BENCHMARK_HPP_INCLUDED
+#define BENCHMARK_BENCHMARK_HPP_INCLUDED
+
+#include <chrono>
+
+namespace benchmark {
+
+/**
+ * Measures the time needed to execute a function.
+ *
+ * @param iterations              The number of times to execute the
+ *                                function.
+ * @param function                The function to measure.
+ *
+ * @returns                       The average duration of a call in
+ *                                nanoseconds.
+ */
+template<class FUNCTION>
+inline double
+measure(const unsigned iterations, FUNCTION function)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for(unsigned i = 0; i < iterations; ++i) {
+		function();
+	}
+
+	return std::chrono::duration<double, std::nano>(
+			std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+} // namespace benchmark
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Benchmarks @ref lib::concatenate.
+ *
+ * Compares the function with concatenating with a @c std::stringstream,
+ * which was its implementation before.
+ */
+
+#include "benchmark/benchmark.hpp"
+#include "lib/string/concatenate.tpp"
+
+#include <cstdlib>
+#include <iostream>
+
+/** The number of strings concatenated per benchmark. */
+static const unsigned iterations = 1000000;
+
+/** Concatenates with a @c std::stringstream. */
+template<class... Pack>
+static std::string
+concatenate_stream(const Pack&... pack)
+{
+	std::stringstream sstr;
+	lib::stream(sstr, pack...);
+	return sstr.str();
+}
+
+/**
+ * Benchmarks both implementations and reports their results.
+ *
+ * @param name                    The name of the benchmark.
+ * @param pack                    The parameters to concatenate.
+ */
+template<class... Pack>
+static void
+report(const std::string& name, const Pack&... pack)
+{
+	size_t size = 0;
+
+	const double stream = benchmark::measure(iterations, [&]()
+		{
+			size += concatenate_stream(pack...).size();
+		});
+
+	const double concatenate = benchmark::measure(iterations, [&]()
+		{
+			size += lib::concatenate(pack...).size();
+		});
+
+	std::string buffer;
+	const double append = benchmark::measure(iterations, [&]()
+		{
+			buffer.clear();
+			size += lib::append(buffer, pack...).size();
+		});
+
+	std::cout << "Concatenate »"
+			<< name
+			<< "« stream »"
+			<< stream
+			<< "« ns concatenate »"
+			<< concatenate
+			<< "« ns append »"
+			<< append
+			<< "« ns size »"
+			<< size
+			<< "«.\n";
+}
+
+int main()
+{
+	const std::string id = "benchmark";
+
+	report("reply", "OK\nCreated game '", id, "'.\n");
+
+	report("log"
+			, "Received message »"
+			, 123456u
+			, "« contents »"
+			, id
+			, "« bytes »"
+			, id.size()
+			, "«.\n");
+
+	report("exception"
+			, "Conditional failure in function '"
+			, __PRETTY_FUNCTION__
+			, "' file '"
+			, __FILE__
+			, "' line '"
+			, __LINE__
+			, "' condition '"
+			, "message"
+			, "'");
+
+	report("numbers", -42, ' ', 3.141, ' ', 1ULL << 60);
+
+	return EXIT_SUCCESS;
+}
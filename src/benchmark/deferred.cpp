@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Benchmarks the caller's cost of a deferred log message.
+ *
+ * Compares formatting the message in the caller's thread with deferring the
+ * formatting to the writer thread of the backend.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "benchmark"
+
+#include "benchmark/benchmark.hpp"
+#include "modules/logging/log.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+/** The capacity of the rings. */
+static const unsigned capacity = 65536;
+
+/**
+ * The number of messages logged in one round.
+ *
+ * A round fits in the ring, so the caller's cost is measured, not the time
+ * waiting for the writer thread.
+ */
+static const unsigned iterations = capacity / 2;
+
+/** The number of rounds. */
+static const unsigned rounds = 16;
+
+/**
+ * Measures the average cost of a log statement.
+ *
+ * @param deferred                Whether the messages are deferred.
+ *
+ * @returns                       The average duration in nanoseconds.
+ */
+static double
+measure(const bool deferred)
+{
+	logging::module::set_backend_mode(
+			  capacity
+			, logging::tfull_policy::block
+			, deferred);
+
+	const std::string contents = "game create benchmark";
+	double result = 0;
+
+	for(unsigned round = 0; round < rounds; ++round) {
+		unsigned id = 0;
+		result += benchmark::measure(iterations, [&]()
+			{
+				LOG_I("Received message »"
+						, ++id
+						, "« contents »"
+						, contents
+						, "« bytes »"
+						, contents.size()
+						, "«.\n");
+			});
+
+		/* Let the writer thread drain the ring before the next round. */
+		std::this_thread::sleep_for(std::chrono::milliseconds(
+				50 + logging::tbackend::flush_interval));
+	}
+
+	logging::module::set_sync_mode();
+
+	return result / rounds;
+}
+
+int main()
+{
+	/* Discard the output, only the caller's cost is measured. */
+	logging::module::module_logger().set_stream_function(
+			[](const std::string&, const logging::tlevel) -> std::ostream*
+			{
+				return nullptr;
+			});
+
+	logging::module::set_threshold_level(logging::tlevel::information);
+
+	const double formatted = measure(false);
+	const double deferred = measure(true);
+
+	std::cout << "Log statement formatted »"
+			<< formatted
+			<< "« ns deferred »"
+			<< deferred
+			<< "« ns.\n";
+
+	return EXIT_SUCCESS;
+}
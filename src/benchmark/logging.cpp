@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Benchmarks the cost of the log statements in a handler.
+ *
+ * The programme is built once per log level floor, comparing the builds
+ * shows the effect of compiling out the log statements.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "benchmark"
+
+#include "benchmark/benchmark.hpp"
+#include "modules/logging/log.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * A handler logging like
+ * @ref communication::detail::treceiver::asio_receive_handler().
+ */
+static size_t
+handler(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred
+		, const std::string& contents)
+{
+	LOG_T(__PRETTY_FUNCTION__
+			, ": error »", error.message()
+			, "« bytes_transferred »" , bytes_transferred
+			, "«.\n");
+
+	LOG_D("Received »", contents, "«.\n");
+
+	return bytes_transferred + contents.size();
+}
+
+int main()
+{
+	static const unsigned iterations = 1000000;
+
+	/* Discard the output, only the cost of the log statements is measured. */
+	logging::module::module_logger().set_stream_function(
+			[](const std::string&, const logging::tlevel) -> std::ostream*
+			{
+				return nullptr;
+			});
+
+	const boost::system::error_code error;
+	const std::string contents = "game create benchmark";
+	size_t result = 0;
+
+	for(const logging::tlevel threshold
+			: {logging::tlevel::trace, logging::tlevel::information}) {
+
+		logging::module::set_threshold_level(threshold);
+
+		const double duration = benchmark::measure(iterations, [&]()
+			{
+				result += handler(error, contents.size(), contents);
+			});
+
+		std::cout << "Log level floor »"
+				<< LOGGER_LEVEL_FLOOR_BENCHMARK
+				<< "« threshold »"
+				<< threshold
+				<< "« handler »"
+				<< duration
+				<< "« ns.\n";
+	}
+
+	/* Use the result so the handler is not optimised away. */
+	return result == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Benchmarks the memory resources with multiple threads.
+ *
+ * Every thread repeatedly allocates and deallocates the blocks of a
+ * message, the queue node, the message and its encoded form, like the
+ * io threads do.
+ */
+
+#include "benchmark/benchmark.hpp"
+#include "lib/memory/memory_resource.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/** The number of messages per thread. */
+static const unsigned iterations = 1000000;
+
+/** The sizes of the blocks of a message. */
+static const size_t sizes[] {32, 48, 200, 210, 24, 640};
+
+/** The number of blocks of a message. */
+static const size_t count = sizeof(sizes) / sizeof(sizes[0]);
+
+/**
+ * Reports the duration of a message.
+ *
+ * @param name                    The name of the resource.
+ * @param resource                The resource to measure.
+ * @param threads                 The number of threads.
+ */
+static void
+report(const char* name
+		, lib::tmemory_resource* resource
+		, const unsigned threads)
+{
+	std::vector<double> durations(threads);
+	std::vector<std::thread> workers;
+
+	for(unsigned i = 0; i < threads; ++i) {
+		workers.emplace_back([&, i]()
+			{
+				void* blocks[count];
+
+				durations[i] = benchmark::measure(iterations, [&]()
+					{
+						for(size_t j = 0; j < count; ++j) {
+							blocks[j] = resource->allocate(sizes[j]);
+						}
+						for(size_t j = 0; j < count; ++j) {
+							resource->deallocate(blocks[j], sizes[j]);
+						}
+					});
+			});
+	}
+
+	for(std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::cout << "Resource »" << name
+			<< "« threads »" << threads
+			<< "« message »"
+			<< *std::max_element(durations.begin(), durations.end())
+			<< "« ns.\n";
+}
+
+int main()
+{
+	const unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+
+	report("new delete", lib::new_delete_resource(), 1);
+	report("new delete", lib::new_delete_resource(), threads);
+	report("thread pool", lib::thread_pool_resource(), 1);
+	report("thread pool", lib::thread_pool_resource(), threads);
+
+	return EXIT_SUCCESS;
+}
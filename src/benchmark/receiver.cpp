@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Compares the throughput of the receivers.
+ *
+ * A thread writes the messages over a loopback connection as fast as
+ * possible, the receiver under test receives them. Both receivers are
+ * always part of the communication library, so the comparison does not
+ * depend on @c ENABLE_COROUTINE_RECEIVER.
+ */
+
+#include "modules/communication/detail/coroutine_receiver.hpp"
+#include "modules/communication/detail/receiver.hpp"
+
+#include <boost/asio/write.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+/** The number of messages to receive. */
+static const unsigned messages = 1000000;
+
+/**
+ * Reports the duration of a message.
+ *
+ * @tparam RECEIVER               The receiver to measure.
+ *
+ * @param name                    The name of the receiver.
+ * @param protocol                The protocol of the messages.
+ */
+template<class RECEIVER>
+static void
+report(const char* name, const communication::tprotocol protocol)
+{
+	boost::asio::io_service io_service;
+
+	boost::asio::ip::tcp::acceptor acceptor(
+			  io_service
+			, boost::asio::ip::tcp::endpoint(
+				boost::asio::ip::address_v4::loopback(), 0));
+
+	boost::asio::ip::tcp::socket client(io_service);
+	client.connect(acceptor.local_endpoint());
+
+	boost::asio::ip::tcp::socket server(io_service);
+	acceptor.accept(server);
+
+	communication::detail::tconnection connection;
+	connection.set_protocol(protocol);
+
+	std::string data;
+	const communication::tmessage sent(
+			  communication::tmessage::ttype::action
+			, 0
+			, "benchmark message");
+
+	const std::string encoded = sent.encode(protocol);
+	data.reserve(encoded.size() * messages);
+	for(unsigned i = 0; i < messages; ++i) {
+		data += encoded;
+	}
+
+	unsigned received = 0;
+	RECEIVER receiver(connection, server);
+	receiver.set_receive_handler([&](
+				  const boost::system::error_code&
+				, const size_t
+				, const communication::tmessage* message)
+			{
+				if(message) {
+					++received;
+				}
+			});
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::thread writer([&]()
+		{
+			boost::asio::write(client, boost::asio::buffer(data));
+			client.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+		});
+
+	receiver.receive();
+	io_service.run();
+	writer.join();
+
+	const double duration = std::chrono::duration<double, std::nano>(
+			std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Receiver »" << name
+			<< "« protocol »" << protocol
+			<< "« received »" << received
+			<< "« message »" << duration / messages
+			<< "« ns.\n";
+}
+
+int main()
+{
+	using communication::tprotocol;
+	typedef communication::detail::treceiver_socket tcallback;
+	typedef communication::detail::tcoroutine_receiver_socket tcoroutine;
+
+	report<tcallback>("callback", tprotocol::line);
+	report<tcoroutine>("coroutine", tprotocol::line);
+	report<tcallback>("callback", tprotocol::basic);
+	report<tcoroutine>("coroutine", tprotocol::basic);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Benchmarks the cost of recording an event in the flight recorder.
+ */
+
+#include "benchmark/benchmark.hpp"
+#include "modules/logging/recorder.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+/** The number of events recorded. */
+static const unsigned iterations = 10000000;
+
+int main()
+{
+	uint64_t size = 0;
+
+	/* Register the ring of the thread before measuring. */
+	logging::recorder::record(
+			  logging::recorder::tevent::frame_received
+			, &size);
+
+	const double duration = benchmark::measure(iterations, [&]()
+		{
+			logging::recorder::record(
+					  logging::recorder::tevent::frame_received
+					, &size
+					, ++size);
+		});
+
+	std::cout << "Record event »" << duration << "« ns.\n";
+
+	return EXIT_SUCCESS;
+}
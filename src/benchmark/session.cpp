@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Reports the memory used by idle connected sessions.
+ *
+ * The sessions are accepted like the lobby does, they send the greeting and
+ * wait for data. Every client sends one line, so the receive buffer and the
+ * sender have been used. The clients run in a child process, so only the
+ * memory of the sessions is reported.
+ *
+ * The heap is measured by replacing the global allocation functions, so
+ * the report includes the sizes of the objects and everything they
+ * allocate, but not the allocator's own overhead.
+ */
+
+#include "modules/lobby/session.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <new>
+
+/** The number of bytes allocated and not yet freed. */
+static std::atomic<size_t> allocated{0};
+
+/**
+ * The header in front of every allocation.
+ *
+ * The header is aligned for the fundamental types, so the data following
+ * it is aligned as well.
+ */
+union theader
+{
+	struct
+	{
+		/** The block returned by @c std::malloc. */
+		void* block;
+
+		/** The size of the allocation. */
+		size_t size;
+	} allocation;
+
+	long double alignment;
+};
+
+void*
+operator new(size_t size)
+{
+	void* block = std::malloc(sizeof(theader) + size);
+	if(!block) {
+		throw std::bad_alloc();
+	}
+
+	theader* header = new(block) theader;
+	header->allocation.block = block;
+	header->allocation.size = size;
+	allocated += size;
+	return header + 1;
+}
+
+void
+operator delete(void* pointer) noexcept
+{
+	if(pointer) {
+		/*
+		 * The header is found by its address and the block is freed by
+		 * the pointer stored in it, so the compiler doesn't take the data
+		 * for the start of the block.
+		 */
+		const theader* header = reinterpret_cast<const theader*>(
+				reinterpret_cast<uintptr_t>(pointer) - sizeof(theader));
+		allocated -= header->allocation.size;
+		std::free(header->allocation.block);
+	}
+}
+
+void*
+operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void
+operator delete[](void* pointer) noexcept
+{
+	operator delete(pointer);
+}
+
+/**
+ * Connects the clients.
+ *
+ * Runs in the child process. Every client uses its own loopback address,
+ * so the clients don't run out of ephemeral ports. The clients stay
+ * connected until the @p done pipe is closed.
+ *
+ * @param port                    The port of the sessions.
+ * @param count                   The number of clients.
+ * @param done                    The reading end of the pipe.
+ */
+static void
+connect_clients(const unsigned short port, const unsigned count, const int done)
+{
+	sockaddr_in server{};
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for(unsigned i = 0; i < count; ++i) {
+		sockaddr_in client{};
+		client.sin_family = AF_INET;
+		client.sin_addr.s_addr = htonl(0x7f100000 + i);
+
+		const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if(fd == -1
+				|| ::bind(fd
+					, reinterpret_cast<sockaddr*>(&client)
+					, sizeof(client)) != 0
+				|| ::connect(fd
+					, reinterpret_cast<sockaddr*>(&server)
+					, sizeof(server)) != 0
+				|| ::write(fd, "ping\r\n", 6) != 6) {
+
+			return;
+		}
+	}
+
+	char byte;
+	while(::read(done, &byte, 1) != 0) {
+		/* Wait until the parent closes the pipe. */
+	}
+}
+
+/**
+ * Reports the bytes per idle connected session.
+ *
+ * @param count                   The number of sessions to connect.
+ */
+static void
+report(const unsigned count)
+{
+	rlimit limit;
+	if(::getrlimit(RLIMIT_NOFILE, &limit) != 0
+			|| limit.rlim_cur < count + 64) {
+
+		std::cout << "Idle sessions »" << count
+				<< "« need more file descriptors than the limit »"
+				<< limit.rlim_cur
+				<< "«.\n";
+		return;
+	}
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::acceptor acceptor(
+			  io_service
+			, boost::asio::ip::tcp::endpoint(
+				  boost::asio::ip::address_v4::loopback()
+				, 0));
+
+	int done[2];
+	if(::pipe(done) != 0) {
+		std::cout << "Failed to create the pipe for the clients.\n";
+		return;
+	}
+
+	const pid_t pid = ::fork();
+	if(pid == -1) {
+		::close(done[0]);
+		::close(done[1]);
+		std::cout << "Failed to start the clients.\n";
+		return;
+	} else if(pid == 0) {
+		::close(done[1]);
+		connect_clients(acceptor.local_endpoint().port(), count, done[0]);
+		_exit(EXIT_SUCCESS);
+	}
+	::close(done[0]);
+
+	const size_t before = allocated;
+	{
+		std::list<lobby::tsession> sessions;
+		unsigned received = 0;
+		bool failed = false;
+
+		/* Accepts the sessions one at a time, like the lobby. */
+		std::function<void()> listen = [&]()
+			{
+				sessions.emplace_back(io_service);
+				lobby::tsession& session = sessions.back();
+
+				session.set_accept_handler(
+						[&](const boost::system::error_code& error)
+						{
+							if(error) {
+								failed = true;
+								return;
+							}
+
+							session.set_status(
+									lobby::tsession::tstatus::connected);
+							session.send("Zard\n1");
+							session.receive();
+
+							if(sessions.size() < count) {
+								listen();
+							}
+						});
+
+				session.set_receive_handler(
+						[&](const boost::system::error_code& error
+							, const size_t
+							, const communication::tmessage*)
+						{
+							if(error) {
+								failed = true;
+							} else {
+								++received;
+							}
+						});
+
+				session.accept(acceptor);
+			};
+
+		listen();
+		while(!failed && received < count) {
+			io_service.run_one();
+		}
+		io_service.poll();
+
+		if(failed) {
+			std::cout << "Idle sessions »" << count
+					<< "« failed to connect.\n";
+		} else {
+			std::cout << "Idle connected sessions »" << count
+					<< "« bytes per session »"
+					<< (allocated - before) / count
+					<< "« sizeof(tsession) »" << sizeof(lobby::tsession)
+					<< "«.\n";
+		}
+	}
+
+	::close(done[1]);
+	::waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+	/* The sessions and the clients each need a descriptor per connection. */
+	rlimit limit;
+	if(::getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	report(10000);
+	report(100000);
+
+	return EXIT_SUCCESS;
+}
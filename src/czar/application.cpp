@@ -149,11 +149,11 @@ tapplication::execute_client(const std::string& command)
 				, "Not in buffering mode");
 		}
 		buffering_mode_ = false;
-		/*
-		 * If not empty need to strip the last new line
-		 */
-		std::string cmd;
-		std::swap(command_buffer_, cmd);
+
+		/* The server executes the buffered commands as one batch. */
+		std::string cmd("batch\n");
+		cmd += command_buffer_;
+		command_buffer_.clear();
 		return execute_server(cmd);
 
 	} else if(command.substr(0, connect_cmd.size()) == connect_cmd) {
@@ -17,61 +17,15 @@
 #include "czar/application.hpp"
 #include "lib/exception/validate.tpp"
 //#include "lib/exception/exit.hpp"
+#include "modules/logging/file.hpp"
 #include "modules/logging/log.hpp"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
 #include <thread>
 
-namespace logging {
-
-class tfile final
-{
-public:
-
-	tfile(const std::string& filename);
-	~tfile() = default;
-
-	tfile&
-	operator=(const tfile&) = delete;
-	tfile(const tfile&) = delete;
-
-	tfile&
-	operator=(tfile&&) = delete;
-	tfile(tfile&&) = delete;
-
-
-	std::ofstream*
-	ostream();
-
-private:
-
-	std::ofstream ostream_;
-};
-
-tfile::tfile(const std::string& filename)
-	: ostream_(filename.c_str(), std::ios_base::app | std::ios_base::binary)
-{
-	if(!ostream_.is_open()) {
-		throw lib::texception(lib::texception::ttype::no_access
-				, lib::concatenate(
-					  "Couldn't open »"
-					, filename
-					, "« for writing"));
-	}
-}
-
-std::ofstream*
-tfile::ostream()
-{
-	return ostream_.is_open() ? &ostream_ : nullptr;
-}
-
-} // namespace logging
-
 static std::string
 log_level_to_string(const logging::tlevel level)
 {
@@ -153,6 +107,10 @@ int main(int /*argc*/, char* /*argv*/[])
 				  &logging::tfile::ostream
 				, &logfile));
 
+		logging::module::module_logger().set_post_process_function(std::bind(
+				  &logging::tfile::post_process
+				, &logfile));
+
 		logging::module::module_logger().set_pre_process_function(std::bind(
 				  module_logger_multi_threaded_pre_process_function
 				, std::placeholders::_1
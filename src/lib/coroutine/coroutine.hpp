@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the stackless coroutines.
+ *
+ * A stackless coroutine is a member function which can be suspended and
+ * resumed. The function returns when suspended and continues after the
+ * suspension point when called again. This allows writing a chain of
+ * asynchronous operations as one function, the function itself being the
+ * completion handler of the operations.
+ *
+ * The design is based on the coroutines of the boost asio examples [1],
+ * which are only part of the boost asio library since boost 1.54.
+ *
+ * Since the coroutine has no stack of its own:
+ * - The state kept between suspensions shall be stored in members.
+ * - A suspension point shall not be in the scope of an initialised local
+ *   variable or inside a @c switch statement.
+ * - A line shall contain at most one suspension point.
+ *
+ * [1]
+ * http://www.boost.org/doc/libs/1_48_0/doc/html/boost_asio/examples.html
+ */
+
+#ifndef LIB_COROUTINE_COROUTINE_HPP_INCLUDED
+#define LIB_COROUTINE_COROUTINE_HPP_INCLUDED
+
+namespace lib {
+
+/** The state of a stackless coroutine. */
+struct tcoroutine
+{
+	/** The line of the last suspension point, @c 0 before starting. */
+	int line{0};
+};
+
+} // namespace lib
+
+/**
+ * Starts or resumes the body of a coroutine.
+ *
+ * The body follows the macro, like the body of a @c switch statement.
+ *
+ * @param coroutine               The @ref lib::tcoroutine of the coroutine.
+ */
+#define COROUTINE_REENTER(coroutine)                                         \
+	switch((coroutine).line)                                                 \
+		case 0:
+
+/**
+ * Suspends a coroutine.
+ *
+ * Executes the statement, e.g. starts an asynchronous operation, and
+ * returns. When the coroutine is resumed it continues after this macro.
+ * Since the coroutine may be resumed before the statement returns, the
+ * coroutine shall not use its state after starting the operation.
+ *
+ * @param coroutine               The @ref lib::tcoroutine of the coroutine.
+ * @param ...                     The statement to execute.
+ */
+#define COROUTINE_YIELD(coroutine, ...)                                      \
+	do {                                                                     \
+		(coroutine).line = __LINE__;                                         \
+		__VA_ARGS__;                                                         \
+		return;                                                              \
+		case __LINE__ :                                                      \
+			;                                                                \
+	} while(false)
+
+#endif
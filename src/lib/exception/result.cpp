@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "lib/exception/result.hpp"
+
+#include "lib/exception/validate.tpp"
+
+namespace lib {
+
+tresult::tresult()
+	: ok_(true)
+	, code_(texception::ttype::internal_failure)
+	, message_("")
+	, argument_()
+{
+}
+
+tresult::tresult(
+		  const texception::ttype code__
+		, const char* message__
+		, const std::string& argument__)
+	: ok_(false)
+	, code_(code__)
+	, message_(message__)
+	, argument_(argument__)
+{
+}
+
+tresult::operator bool() const
+{
+	return ok_;
+}
+
+std::string
+tresult::reply() const
+{
+	VALIDATE(!ok_);
+
+	return concatenate(reply_code(code_), '\n', message_, ".\n");
+}
+
+std::string
+tresult::detail() const
+{
+	VALIDATE(!ok_);
+
+	if(argument_.empty()) {
+		return message_;
+	}
+
+	return concatenate(message_, ", value »", argument_, "«");
+}
+
+void
+tresult::raise() const
+{
+	VALIDATE(!ok_);
+
+	throw texception(code_, detail());
+}
+
+texception::ttype
+tresult::get_code() const
+{
+	return code_;
+}
+
+const char*
+reply_code(const texception::ttype code)
+{
+	switch(code) {
+		case texception::ttype::invalid_value :
+			return "EINVAL";
+
+		case texception::ttype::busy :
+			return "EBUSY";
+
+		case texception::ttype::no_access :
+			return "EACCES";
+
+		case texception::ttype::protocol_error :
+			return "EPROTO";
+
+		case texception::ttype::socket_error :
+			return "EIO";
+
+		case texception::ttype::not_implemented_yet :
+			return "ENOSYS";
+
+		case texception::ttype::internal_failure :
+			return "ERROR";
+	}
+
+	ENUM_FAIL_RANGE(code);
+}
+
+} // namespace lib
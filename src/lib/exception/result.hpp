@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Defines the result of an operation which can fail.
+ */
+
+#ifndef LIB_EXCEPTION_RESULT_HPP_INCLUDED
+#define LIB_EXCEPTION_RESULT_HPP_INCLUDED
+
+#include "lib/exception/exception.hpp"
+
+#include <string>
+
+namespace lib {
+
+/**
+ * The result of an operation which can fail.
+ *
+ * An exception is intended for faults, e.g. a failed validation. Expected
+ * failures, e.g. a client creating a game which already exists, return a
+ * result instead. This avoids the cost of throwing for every invalid
+ * request of a client.
+ *
+ * A failure has a code, a message and an argument. The message is a string
+ * literal, which is sent to the client in the @ref reply(). The argument
+ * is the value causing the failure, e.g. the id of the game. It's only
+ * formatted together with the message when the @ref detail() is requested,
+ * e.g. for logging.
+ */
+class tresult final
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/** Creates a successful result. */
+	tresult();
+
+	/**
+	 * Creates a failed result.
+	 *
+	 * @param code__              The value of @ref code_.
+	 * @param message__           The value of @ref message_.
+	 * @param argument__          The value of @ref argument_.
+	 */
+	tresult(const texception::ttype code__
+			, const char* message__
+			, const std::string& argument__ = std::string());
+
+	~tresult() = default;
+
+	tresult&
+	operator=(const tresult&) = default;
+	tresult(const tresult&) = default;
+
+	tresult&
+	operator=(tresult&&) = default;
+	tresult(tresult&&) = default;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/** Returns whether the operation succeeded. */
+	explicit operator bool() const;
+
+	/**
+	 * Returns the reply to send to the client.
+	 *
+	 * The reply is the reply code of the @ref code_, e.g. @c EBUSY, followed
+	 * by the @ref message_, see @ref reply_code().
+	 *
+	 * @pre                       The operation failed.
+	 */
+	std::string
+	reply() const;
+
+	/**
+	 * Returns a description of the failure.
+	 *
+	 * @pre                       The operation failed.
+	 */
+	std::string
+	detail() const;
+
+	/**
+	 * Throws the failure as exception.
+	 *
+	 * For callers which can't handle a failure.
+	 *
+	 * @pre                       The operation failed.
+	 */
+	void
+	raise() const;
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	texception::ttype
+	get_code() const;
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** Whether the operation succeeded. */
+	bool ok_;
+
+	/** The kind of failure. */
+	texception::ttype code_;
+
+	/** The string literal describing the failure. */
+	const char* message_;
+
+	/** The value causing the failure. */
+	std::string argument_;
+};
+
+/**
+ * Returns the reply code for a failure.
+ *
+ * The reply codes are the first line of a reply, they resemble the names of
+ * the @c errno values.
+ *
+ * @param code                    The kind of failure.
+ *
+ * @returns                       The reply code.
+ */
+const char*
+reply_code(const texception::ttype code);
+
+} // namespace lib
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "lib/exception/validate.tpp"
+
+namespace lib {
+
+/** The hook called upon a failed validation. */
+static tvalidate_failure_hook validate_failure_hook = nullptr;
+
+void
+set_validate_failure_hook(const tvalidate_failure_hook hook)
+{
+	validate_failure_hook = hook;
+}
+
+void
+validate_failure()
+{
+	if(validate_failure_hook) {
+		validate_failure_hook();
+	}
+}
+
+} // namespace lib
@@ -62,6 +62,28 @@ is_enum(const T&)
 }
 
 } // namespace static_assert_wrapper
+
+/**
+ * The function type of the hook called upon a failed validation.
+ *
+ * The hook is called before the exception is thrown, e.g. to dump the
+ * @ref logging::recorder.
+ */
+typedef void (*tvalidate_failure_hook)();
+
+/**
+ * Sets the hook called upon a failed validation.
+ *
+ * @param hook                    The hook, when @c nullptr no hook is
+ *                                called.
+ */
+void
+set_validate_failure_hook(const tvalidate_failure_hook hook);
+
+/** Calls the hook set by @ref set_validate_failure_hook(), if any. */
+void
+validate_failure();
+
 } // namespace lib
 
 /**
@@ -80,6 +102,7 @@ is_enum(const T&)
 #define VALIDATE(condition)                                                  \
 	do {                                                                     \
 		if(!(condition)) {                                                   \
+			::lib::validate_failure();                                       \
 			throw ::lib::texception(                                         \
 					  ::lib::texception::ttype::internal_failure             \
 					, ::lib::concatenate(                                    \
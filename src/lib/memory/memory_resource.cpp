@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "lib/memory/memory_resource.hpp"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace lib {
+
+const size_t tmemory_resource::max_alignment;
+
+tmemory_resource::~tmemory_resource() = default;
+
+/***** ***** ***** ***** New delete resource. ***** ***** ***** *****/
+
+namespace {
+
+/** The resource using the global allocation functions. */
+class tnew_delete_resource final
+	: public tmemory_resource
+{
+private:
+
+	void*
+	do_allocate(const size_t bytes, const size_t /*alignment*/)
+	{
+		return ::operator new(bytes);
+	}
+
+	void
+	do_deallocate(
+			  void* pointer
+			, const size_t /*bytes*/
+			, const size_t /*alignment*/)
+	{
+		::operator delete(pointer);
+	}
+};
+
+} // namespace
+
+tmemory_resource*
+new_delete_resource()
+{
+	static tnew_delete_resource result;
+	return &result;
+}
+
+/***** ***** ***** ***** Thread pool resource. ***** ***** ***** *****/
+
+/** The size of the smallest block, the size of a block is a power of 2. */
+static const size_t min_block = 16;
+
+/** The size of the largest block, larger blocks are not pooled. */
+static const size_t max_block = 1024;
+
+/** The number of block sizes. */
+static const size_t pool_count = 7;
+
+/**
+ * The size of the memory allocated when a pool is empty.
+ *
+ * The chunks are aligned at their size, so the chunk of a block is found by
+ * masking its address.
+ */
+static const size_t chunk_size = 16384;
+
+/** A free block in a pool. */
+struct tblock
+{
+	/** The next free block. */
+	tblock* next;
+};
+
+struct tpools;
+
+/**
+ * The header of a chunk.
+ *
+ * Only the owner of the chunk uses its blocks and its list, other threads
+ * return the blocks of the chunk to the owner, see @ref tpool::remote.
+ */
+struct tchunk
+{
+	/** The pools of the thread which allocated the chunk. */
+	tpools* owner;
+
+	/** The index of the pool of the chunk. */
+	size_t index;
+
+	/** The free blocks of the chunk. */
+	tblock* blocks;
+
+	/** The number of blocks in use. */
+	size_t used;
+
+	/** The previous chunk with free blocks. */
+	tchunk* previous;
+
+	/** The next chunk with free blocks. */
+	tchunk* next;
+};
+
+/** A pool, the blocks of a size of a thread. */
+struct tpool
+{
+	/** The chunks with free blocks, the first is used first. */
+	tchunk* chunks;
+
+	/** The number of chunks without blocks in use. */
+	size_t empty;
+
+	/** The blocks returned by other threads, not added to their chunks. */
+	std::atomic<tblock*> remote;
+};
+
+/**
+ * The pools of a thread.
+ *
+ * Every pool has blocks of the same size, the size of the blocks in pool
+ * @p i is @c min_block @c << @c i.
+ *
+ * The pools are not destroyed when their thread exits, so other threads can
+ * still return blocks.
+ */
+struct tpools
+{
+	tpool pools[pool_count];
+
+	/** The number of chunks of the pools. */
+	size_t chunks;
+};
+
+/** The pools of the calling thread, created when the thread allocates. */
+static __thread tpools* thread_pools = nullptr;
+
+/**
+ * Returns the pool of a block.
+ *
+ * @param bytes                   The size of the block.
+ *
+ * @returns                       The index in @ref tpools::pools.
+ */
+static size_t
+pool_index(const size_t bytes)
+{
+	size_t result = 0;
+	for(size_t size = min_block; size < bytes; size *= 2) {
+		++result;
+	}
+	return result;
+}
+
+/** Returns the chunk of a block. */
+static tchunk*
+chunk_of(void* block)
+{
+	return reinterpret_cast<tchunk*>(
+			reinterpret_cast<uintptr_t>(block) & ~(chunk_size - 1));
+}
+
+/** Adds a chunk to the front of the chunks with free blocks of its pool. */
+static void
+link(tpool& pool, tchunk* chunk)
+{
+	chunk->previous = nullptr;
+	chunk->next = pool.chunks;
+	if(pool.chunks) {
+		pool.chunks->previous = chunk;
+	}
+	pool.chunks = chunk;
+}
+
+/** Removes a chunk from the chunks with free blocks of its pool. */
+static void
+unlink(tpool& pool, tchunk* chunk)
+{
+	if(chunk->previous) {
+		chunk->previous->next = chunk->next;
+	} else {
+		pool.chunks = chunk->next;
+	}
+	if(chunk->next) {
+		chunk->next->previous = chunk->previous;
+	}
+}
+
+/**
+ * Adds a new chunk to a pool.
+ *
+ * @param pools                   The pools of the calling thread.
+ * @param index                   The index of the pool.
+ */
+static void
+fill_pool(tpools& pools, const size_t index)
+{
+	void* memory;
+	if(posix_memalign(&memory, chunk_size, chunk_size) != 0) {
+		throw std::bad_alloc();
+	}
+
+	const size_t size = min_block << index;
+	tchunk* chunk = static_cast<tchunk*>(memory);
+	*chunk = tchunk{&pools, index, nullptr, 0, nullptr, nullptr};
+
+	/* The blocks are aligned at their size, after the header. */
+	const size_t first = (sizeof(tchunk) + size - 1) / size * size;
+	for(size_t offset = chunk_size - size; offset >= first; offset -= size) {
+		tblock* block = reinterpret_cast<tblock*>(
+				static_cast<char*>(memory) + offset);
+		block->next = chunk->blocks;
+		chunk->blocks = block;
+	}
+
+	link(pools.pools[index], chunk);
+	++pools.pools[index].empty;
+	++pools.chunks;
+}
+
+/**
+ * Returns a block to its chunk, the chunk is owned by the calling thread.
+ *
+ * When the chunk has no blocks in use and the pool already has an empty
+ * chunk, the chunk is released.
+ *
+ * @param pools                   The pools of the calling thread.
+ * @param block                   The block to return.
+ */
+static void
+release_block(tpools& pools, tblock* block)
+{
+	tchunk* chunk = chunk_of(block);
+	tpool& pool = pools.pools[chunk->index];
+
+	if(!chunk->blocks) {
+		link(pool, chunk);
+	}
+	block->next = chunk->blocks;
+	chunk->blocks = block;
+
+	if(--chunk->used != 0) {
+		return;
+	}
+
+	if(pool.empty == 0) {
+		++pool.empty;
+		return;
+	}
+
+	unlink(pool, chunk);
+	--pools.chunks;
+	free(chunk);
+}
+
+namespace {
+
+/** The resource using the pools of the calling thread. */
+class tthread_pool_resource final
+	: public tmemory_resource
+{
+private:
+
+	void*
+	do_allocate(const size_t bytes, const size_t alignment)
+	{
+		if(bytes > max_block || alignment > max_alignment) {
+			return ::operator new(bytes);
+		}
+
+		if(!thread_pools) {
+			thread_pools = new tpools();
+		}
+
+		const size_t index = pool_index(bytes);
+		tpool& pool = thread_pools->pools[index];
+
+		if(!pool.chunks) {
+			tblock* block = pool.remote.exchange(
+					  nullptr
+					, std::memory_order_acquire);
+
+			while(block) {
+				tblock* next = block->next;
+				release_block(*thread_pools, block);
+				block = next;
+			}
+		}
+
+		if(!pool.chunks) {
+			fill_pool(*thread_pools, index);
+		}
+
+		tchunk* chunk = pool.chunks;
+		if(chunk->used++ == 0) {
+			--pool.empty;
+		}
+
+		tblock* result = chunk->blocks;
+		chunk->blocks = result->next;
+		if(!chunk->blocks) {
+			unlink(pool, chunk);
+		}
+		return result;
+	}
+
+	void
+	do_deallocate(
+			  void* pointer
+			, const size_t bytes
+			, const size_t alignment)
+	{
+		if(bytes > max_block || alignment > max_alignment) {
+			::operator delete(pointer);
+			return;
+		}
+
+		tblock* block = static_cast<tblock*>(pointer);
+		tchunk* chunk = chunk_of(block);
+
+		if(chunk->owner == thread_pools) {
+			release_block(*thread_pools, block);
+			return;
+		}
+
+		std::atomic<tblock*>& remote = chunk->owner->pools[chunk->index].remote;
+		block->next = remote.load(std::memory_order_relaxed);
+		while(!remote.compare_exchange_weak(
+				  block->next
+				, block
+				, std::memory_order_release
+				, std::memory_order_relaxed)) {
+		}
+	}
+};
+
+} // namespace
+
+tmemory_resource*
+thread_pool_resource()
+{
+	static tthread_pool_resource result;
+	return &result;
+}
+
+size_t
+thread_pool_size()
+{
+	return thread_pools ? thread_pools->chunks * chunk_size : 0;
+}
+
+/***** ***** ***** ***** Monotonic resource. ***** ***** ***** *****/
+
+/** The size of the first buffer allocated from the upstream resource. */
+static const size_t min_chunk = 1024;
+
+tmonotonic_resource::tmonotonic_resource(tmemory_resource* upstream)
+	: tmonotonic_resource(nullptr, 0, upstream)
+{
+}
+
+tmonotonic_resource::tmonotonic_resource(
+		  void* buffer
+		, const size_t size
+		, tmemory_resource* upstream)
+	: upstream_(upstream)
+	, initial_buffer_(static_cast<char*>(buffer))
+	, initial_size_(size)
+	, current_(initial_buffer_)
+	, available_(initial_size_)
+	, next_size_(std::max(min_chunk, 2 * initial_size_))
+{
+}
+
+tmonotonic_resource::~tmonotonic_resource()
+{
+	release();
+}
+
+void
+tmonotonic_resource::release()
+{
+	while(chunks_) {
+		tchunk* chunk = chunks_;
+		chunks_ = chunk->next;
+		upstream_->deallocate(chunk, chunk->size);
+	}
+
+	current_ = initial_buffer_;
+	available_ = initial_size_;
+	next_size_ = std::max(min_chunk, 2 * initial_size_);
+}
+
+/**
+ * Returns the padding needed to align a pointer.
+ *
+ * @param pointer                 The pointer to align.
+ * @param alignment               The wanted alignment, a power of 2.
+ *
+ * @returns                       The number of bytes to add to @p pointer.
+ */
+static size_t
+padding(const char* pointer, const size_t alignment)
+{
+	const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+	return static_cast<size_t>(-address & (alignment - 1));
+}
+
+void*
+tmonotonic_resource::do_allocate(const size_t bytes, const size_t alignment)
+{
+	size_t offset = padding(current_, alignment);
+
+	if(!current_ || offset + bytes > available_) {
+		/* The header keeps the data aligned for max_alignment. */
+		const size_t header = (sizeof(tchunk) + max_alignment - 1)
+				/ max_alignment * max_alignment;
+
+		const size_t size = std::max(next_size_, header + alignment + bytes);
+		tchunk* chunk = static_cast<tchunk*>(upstream_->allocate(size));
+		chunk->next = chunks_;
+		chunk->size = size;
+		chunks_ = chunk;
+
+		current_ = reinterpret_cast<char*>(chunk) + header;
+		available_ = size - header;
+		next_size_ = 2 * size;
+
+		offset = padding(current_, alignment);
+	}
+
+	char* result = current_ + offset;
+	current_ = result + bytes;
+	available_ -= offset + bytes;
+	return result;
+}
+
+void
+tmonotonic_resource::do_deallocate(
+		  void* /*pointer*/
+		, const size_t /*bytes*/
+		, const size_t /*alignment*/)
+{
+}
+
+} // namespace lib
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the memory resources and their allocator.
+ *
+ * This is a subset of the @c std::pmr memory resources of C++17:
+ * - @ref tmemory_resource is @c std::pmr::memory_resource.
+ * - @ref tmonotonic_resource is @c std::pmr::monotonic_buffer_resource.
+ * - @ref thread_pool_resource() has no equivalent, it is an
+ *   @c std::pmr::unsynchronized_pool_resource per thread.
+ * - @ref tallocator is @c std::pmr::polymorphic_allocator.
+ *
+ * The containers of gcc-4.7 don't use @c std::allocator_traits yet, so the
+ * allocator also has the members of a C++03 allocator.
+ */
+
+#ifndef LIB_MEMORY_MEMORY_RESOURCE_HPP_INCLUDED
+#define LIB_MEMORY_MEMORY_RESOURCE_HPP_INCLUDED
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace lib {
+
+/** The interface of a memory resource. */
+class tmemory_resource
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The alignment of the memory of the global allocation functions.
+	 *
+	 * Allocations with a larger alignment are not supported.
+	 */
+	static const size_t max_alignment = alignof(long double);
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	tmemory_resource() = default;
+
+	virtual ~tmemory_resource();
+
+	tmemory_resource&
+	operator=(const tmemory_resource&) = delete;
+	tmemory_resource(const tmemory_resource&) = delete;
+
+	tmemory_resource&
+	operator=(tmemory_resource&&) = delete;
+	tmemory_resource(tmemory_resource&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Allocates memory.
+	 *
+	 * @param bytes               The number of bytes to allocate.
+	 * @param alignment           The alignment of the memory.
+	 *
+	 * @returns                   The allocated memory.
+	 */
+	void*
+	allocate(const size_t bytes, const size_t alignment = max_alignment)
+	{
+		return do_allocate(bytes, alignment);
+	}
+
+	/**
+	 * Deallocates memory.
+	 *
+	 * @pre                       @p pointer is allocated by this resource
+	 *                            with the same @p bytes and @p alignment.
+	 *
+	 * @param pointer             The memory to deallocate.
+	 * @param bytes               The number of bytes allocated.
+	 * @param alignment           The alignment of the memory.
+	 */
+	void
+	deallocate(
+			  void* pointer
+			, const size_t bytes
+			, const size_t alignment = max_alignment)
+	{
+		do_deallocate(pointer, bytes, alignment);
+	}
+
+private:
+
+	/** Implements @ref allocate(). */
+	virtual void*
+	do_allocate(const size_t bytes, const size_t alignment) = 0;
+
+	/** Implements @ref deallocate(). */
+	virtual void
+	do_deallocate(
+			  void* pointer
+			, const size_t bytes
+			, const size_t alignment) = 0;
+};
+
+/** Returns the resource using the global allocation functions. */
+tmemory_resource*
+new_delete_resource();
+
+/**
+ * Returns the resource using the pools of the calling thread.
+ *
+ * Small blocks are taken from and returned to the pools of the calling
+ * thread, so the threads don't contend for the global allocator. Larger
+ * blocks use the global allocation functions.
+ *
+ * The pools allocate chunks of blocks. A chunk without blocks in use is
+ * released, except for one chunk per pool, so the pools don't keep the
+ * memory of their peak usage.
+ *
+ * A block may be deallocated in another thread than it was allocated in,
+ * e.g. when a strand runs its handlers in several io threads. The block is
+ * then returned to the pools of the allocating thread, which adds it to
+ * its chunk when the pool is empty. The pools of a thread aren't destroyed
+ * when the thread exits, since other threads may still return blocks, so
+ * short lived threads shouldn't use this resource.
+ */
+tmemory_resource*
+thread_pool_resource();
+
+/**
+ * Returns the memory held by the pools of the calling thread.
+ *
+ * @returns                       The size of the chunks in bytes, the blocks
+ *                                in use and the free blocks.
+ */
+size_t
+thread_pool_size();
+
+/**
+ * A memory resource which only releases its memory when destroyed.
+ *
+ * The resource allocates from a buffer by incrementing a pointer, the
+ * deallocation doesn't release the memory. When the buffer is full a new
+ * and larger buffer is allocated from the upstream resource. This makes
+ * the resource well suited for the scratch data of a single message.
+ *
+ * The resource is not thread-safe.
+ */
+class tmonotonic_resource final
+	: public tmemory_resource
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @param upstream            The resource for the buffers.
+	 */
+	explicit tmonotonic_resource(
+			tmemory_resource* upstream = new_delete_resource());
+
+	/**
+	 * Constructor.
+	 *
+	 * @pre                       lifetime(buffer) > lifetime(*this)
+	 *
+	 * @param buffer              The initial buffer, e.g. on the stack.
+	 * @param size                The size of the initial buffer.
+	 * @param upstream            The resource for the next buffers.
+	 */
+	tmonotonic_resource(
+			  void* buffer
+			, const size_t size
+			, tmemory_resource* upstream = new_delete_resource());
+
+	~tmonotonic_resource();
+
+	tmonotonic_resource&
+	operator=(const tmonotonic_resource&) = delete;
+	tmonotonic_resource(const tmonotonic_resource&) = delete;
+
+	tmonotonic_resource&
+	operator=(tmonotonic_resource&&) = delete;
+	tmonotonic_resource(tmonotonic_resource&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Releases all allocated memory.
+	 *
+	 * The buffers are returned to the upstream resource and the resource
+	 * continues with its initial buffer.
+	 */
+	void
+	release();
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/** The header of a buffer allocated from the @ref upstream_. */
+	struct tchunk
+	{
+		/** The previous buffer. */
+		tchunk* next;
+
+		/** The size of the buffer, including the header. */
+		size_t size;
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The resource for the buffers. */
+	tmemory_resource* upstream_;
+
+	/** The initial buffer. */
+	char* initial_buffer_;
+
+	/** The size of the @ref initial_buffer_. */
+	size_t initial_size_;
+
+	/** The next free byte in the current buffer. */
+	char* current_;
+
+	/** The number of free bytes in the current buffer. */
+	size_t available_;
+
+	/** The buffers allocated from the @ref upstream_, the last first. */
+	tchunk* chunks_{nullptr};
+
+	/** The size of the next buffer. */
+	size_t next_size_;
+
+	void*
+	do_allocate(const size_t bytes, const size_t alignment);
+
+	void
+	do_deallocate(
+			  void* pointer
+			, const size_t bytes
+			, const size_t alignment);
+};
+
+/**
+ * An allocator using a memory resource.
+ *
+ * Unlike the @c std::allocator the allocator has a state, the resource.
+ * A container using the allocator shall not outlive its resource.
+ *
+ * @tparam T                      The type to allocate.
+ */
+template<class T>
+class tallocator
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<class U>
+	struct rebind
+	{
+		typedef tallocator<U> other;
+	};
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/** Constructor, uses the @ref new_delete_resource(). */
+	tallocator()
+		: resource_(new_delete_resource())
+	{
+	}
+
+	/**
+	 * Constructor.
+	 *
+	 * @pre                       lifetime(resource__) > lifetime(*this)
+	 *
+	 * @param resource__          The resource to allocate from.
+	 */
+	tallocator(tmemory_resource* resource__)
+		: resource_(resource__)
+	{
+	}
+
+	template<class U>
+	tallocator(const tallocator<U>& rhs)
+		: resource_(rhs.resource())
+	{
+	}
+
+	~tallocator() = default;
+
+	tallocator&
+	operator=(const tallocator&) = default;
+	tallocator(const tallocator&) = default;
+
+	tallocator&
+	operator=(tallocator&&) = default;
+	tallocator(tallocator&&) = default;
+
+
+	/***** ***** Operators. ***** *****/
+
+	T*
+	allocate(const size_t count, const void* = nullptr)
+	{
+		return static_cast<T*>(
+				resource_->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void
+	deallocate(T* pointer__, const size_t count)
+	{
+		resource_->deallocate(pointer__, count * sizeof(T), alignof(T));
+	}
+
+	template<class U, class... ARGUMENTS>
+	void
+	construct(U* pointer__, ARGUMENTS&&... arguments)
+	{
+		::new(static_cast<void*>(pointer__))
+				U(std::forward<ARGUMENTS>(arguments)...);
+	}
+
+	template<class U>
+	void
+	destroy(U* pointer__)
+	{
+		pointer__->~U();
+	}
+
+	T*
+	address(T& value) const
+	{
+		return &value;
+	}
+
+	const T*
+	address(const T& value) const
+	{
+		return &value;
+	}
+
+	size_t
+	max_size() const
+	{
+		return std::numeric_limits<size_t>::max() / sizeof(T);
+	}
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	tmemory_resource*
+	resource() const
+	{
+		return resource_;
+	}
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The resource to allocate from. */
+	tmemory_resource* resource_;
+};
+
+template<class T, class U>
+inline bool
+operator==(const tallocator<T>& lhs, const tallocator<U>& rhs)
+{
+	return lhs.resource() == rhs.resource();
+}
+
+template<class T, class U>
+inline bool
+operator!=(const tallocator<T>& lhs, const tallocator<U>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+/** A string using a memory resource. */
+typedef std::basic_string<char, std::char_traits<char>, tallocator<char>>
+		tstring;
+
+} // namespace lib
+
+#endif
@@ -12,17 +12,396 @@
  * See the COPYING file for more details.
  */
 
+/**
+ * @file
+ * Contains the functions to concatenate a list of variables to a string.
+ *
+ * The variables are formatted like the operator<<() of a @c std::ostream
+ * with its default flags formats them, but most types are appended directly
+ * to the string:
+ * - Strings and characters are copied.
+ * - Integers, including @c bool, are converted with a digit table.
+ * - Floating point values are converted with @c std::snprintf, using the
+ *   same @c %g conversion as the stream.
+ * - Enumerates with the stream operators of
+ *   @ref lib/string/enumerate.tpp use their string literal.
+ * - Other types are formatted with a @c std::ostringstream.
+ *
+ * The size of the result is estimated before formatting, so the string is
+ * normally only allocated once.
+ */
+
 #ifndef LIB_STRING_CONCATENATE_TPP_INCLUDED
 #define LIB_STRING_CONCATENATE_TPP_INCLUDED
 
 #include "lib/string/stream.tpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+
 namespace lib {
 
+namespace detail {
+
+/** Is the type a character, formatted as character by a stream? */
+template<class T>
+struct tis_character
+	: std::integral_constant<bool
+			, std::is_same<T, char>::value
+				|| std::is_same<T, signed char>::value
+				|| std::is_same<T, unsigned char>::value>
+{
+};
+
+/** Is the type a pointer to a (const) character? */
+template<class T>
+struct tis_character_pointer
+	: std::integral_constant<bool
+			, std::is_pointer<T>::value
+				&& tis_character<
+					typename std::remove_cv<
+						typename std::remove_pointer<T>::type>::type>::value>
+{
+};
+
+/** Has the enumerate the conversion of the enumerate stream operators? */
+template<class T>
+struct tis_string_enum
+{
+	/*
+	 * The tests are public, a class with only private member functions
+	 * triggers -Wctor-dtor-privacy.
+	 */
+	template<class U>
+	static auto
+	test(int) -> decltype(enum_to_string(std::declval<U>()), std::true_type());
+
+	template<class U>
+	static std::false_type
+	test(...);
+
+	static const bool value =
+			std::is_enum<T>::value && decltype(test<T>(0))::value;
+};
+
+/**
+ * Appends an unsigned integer to a string.
+ *
+ * The digits are converted two at a time from the end of a local buffer.
+ *
+ * @param buffer                  The string to append to.
+ * @param value                   The value to append.
+ */
+inline void
+append_unsigned(std::string& buffer, unsigned long long value)
+{
+	static const char digits[] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+	char result[std::numeric_limits<unsigned long long>::digits10 + 1];
+	char* end = result + sizeof(result);
+	char* begin = end;
+
+	while(value >= 100) {
+		const unsigned index = static_cast<unsigned>(value % 100) * 2;
+		value /= 100;
+		*--begin = digits[index + 1];
+		*--begin = digits[index];
+	}
+
+	if(value >= 10) {
+		const unsigned index = static_cast<unsigned>(value) * 2;
+		*--begin = digits[index + 1];
+		*--begin = digits[index];
+	} else {
+		*--begin = static_cast<char>('0' + value);
+	}
+
+	buffer.append(begin, end);
+}
+
+/**
+ * The formatter for a type.
+ *
+ * Every formatter has two functions:
+ * - @c size returns an estimate of the formatted size of the value.
+ * - @c append appends the formatted value to a string.
+ *
+ * This is the generic version, which formats with a @c std::ostringstream.
+ */
+template<class T, class Enable = void>
+struct tformatter
+{
+	static size_t
+	size(const T& /*value*/)
+	{
+		return 16;
+	}
+
+	static void
+	append(std::string& buffer, const T& value)
+	{
+		std::ostringstream sstr;
+		sstr << value;
+		buffer += sstr.str();
+	}
+};
+
+/** The formatter for a string. */
+template<>
+struct tformatter<std::string>
+{
+	static size_t
+	size(const std::string& value)
+	{
+		return value.size();
+	}
+
+	static void
+	append(std::string& buffer, const std::string& value)
+	{
+		buffer += value;
+	}
+};
+
+/** The formatter for an array of characters, e.g. a string literal. */
+template<size_t N>
+struct tformatter<char[N]>
+{
+	static size_t
+	size(const char (&/*value*/)[N])
+	{
+		return N;
+	}
+
+	static void
+	append(std::string& buffer, const char (&value)[N])
+	{
+		buffer.append(value, std::strlen(value));
+	}
+};
+
+/**
+ * The formatter for a pointer to a string.
+ *
+ * A stream fails when writing a @c nullptr and doesn't write anything, the
+ * formatter also doesn't append anything.
+ */
+template<class T>
+struct tformatter<T
+		, typename std::enable_if<tis_character_pointer<T>::value>::type>
+{
+	static size_t
+	size(const T value)
+	{
+		return value ? std::strlen(reinterpret_cast<const char*>(value)) : 0;
+	}
+
+	static void
+	append(std::string& buffer, const T value)
+	{
+		if(value) {
+			buffer += reinterpret_cast<const char*>(value);
+		}
+	}
+};
+
+/** The formatter for a character. */
+template<class T>
+struct tformatter<T, typename std::enable_if<tis_character<T>::value>::type>
+{
+	static size_t
+	size(const T /*value*/)
+	{
+		return 1;
+	}
+
+	static void
+	append(std::string& buffer, const T value)
+	{
+		buffer += static_cast<char>(value);
+	}
+};
+
+/** The formatter for an integer, including @c bool. */
+template<class T>
+struct tformatter<T, typename std::enable_if<
+		std::is_integral<T>::value && !tis_character<T>::value>::type>
+{
+	static size_t
+	size(const T /*value*/)
+	{
+		return std::numeric_limits<T>::digits10 + 2;
+	}
+
+	static void
+	append(std::string& buffer, const T value)
+	{
+		append(buffer, value, std::is_signed<T>());
+	}
+
+private:
+
+	static void
+	append(std::string& buffer, const T value, std::false_type)
+	{
+		append_unsigned(buffer, static_cast<unsigned long long>(value));
+	}
+
+	static void
+	append(std::string& buffer, const T value, std::true_type)
+	{
+		if(value < 0) {
+			buffer += '-';
+
+			/* Negate after the conversion, the minimum has no positive. */
+			append_unsigned(
+					  buffer
+					, 0ULL - static_cast<unsigned long long>(value));
+		} else {
+			append_unsigned(buffer, static_cast<unsigned long long>(value));
+		}
+	}
+};
+
+/** The formatter for a floating point value. */
+template<class T>
+struct tformatter<T
+		, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	static size_t
+	size(const T /*value*/)
+	{
+		return 16;
+	}
+
+	static void
+	append(std::string& buffer, const T value)
+	{
+		/* The default precision of a stream is 6. */
+		char result[64];
+		const int size = std::snprintf(
+				  result
+				, sizeof(result)
+				, "%.*Lg"
+				, 6
+				, static_cast<long double>(value));
+
+		if(size > 0) {
+			buffer.append(result, std::min(
+					  static_cast<size_t>(size)
+					, sizeof(result) - 1));
+		}
+	}
+};
+
+/** The formatter for an enumerate with stream operators. */
+template<class T>
+struct tformatter<T, typename std::enable_if<tis_string_enum<T>::value>::type>
+{
+	static size_t
+	size(const T /*value*/)
+	{
+		return 16;
+	}
+
+	static void
+	append(std::string& buffer, const T value)
+	{
+		buffer += enum_to_string(value);
+	}
+};
+
+/**
+ * Estimates the size of a list of formatted variables.
+ *
+ * This is the terminator for the other @ref size function.
+ */
+inline size_t
+size()
+{
+	return 0;
+}
+
+/**
+ * Estimates the size of a list of formatted variables.
+ *
+ * @param t                       A variable to estimate.
+ * @param pack                    The other variables to estimate.
+ *
+ * @returns                       The estimated size.
+ */
+template<class T, class... Pack>
+inline size_t
+size(const T& t, const Pack&... pack)
+{
+	return tformatter<T>::size(t) + size(pack...);
+}
+
+/**
+ * Appends a list of variables to a string.
+ *
+ * This is the terminator for the other @ref append function.
+ */
+inline void
+append(std::string& /*buffer*/)
+{
+}
+
+/**
+ * Appends a list of variables to a string.
+ *
+ * @param buffer                  The string to append to.
+ * @param t                       A variable to append.
+ * @param pack                    The other variables to append.
+ */
+template<class T, class... Pack>
+inline void
+append(std::string& buffer, const T& t, const Pack&... pack)
+{
+	tformatter<T>::append(buffer, t);
+	append(buffer, pack...);
+}
+
+} // namespace detail
+
+/**
+ * Appends a list of variables to a string.
+ *
+ * Allows to reuse the storage of the string for multiple messages.
+ *
+ * @param buffer                  The string to append to.
+ * @param pack                    The parameters to convert to a string.
+ *
+ * @returns                       The parameter @p buffer.
+ */
+template<class... Pack>
+inline std::string&
+append(std::string& buffer, const Pack&... pack)
+{
+	buffer.reserve(buffer.size() + detail::size(pack...));
+	detail::append(buffer, pack...);
+	return buffer;
+}
+
 /**
  * Concatenates a list of variables to a string.
  *
- * It uses the operator<<() for all variables.
+ * The variables are formatted as by their operator<<().
  *
  * @param pack                    The parameters to convert to a string.
  *
@@ -32,9 +411,9 @@ template<class... Pack>
 inline std::string
 concatenate(const Pack&... pack)
 {
-	std::stringstream sstr;
-	stream(sstr, pack...);
-	return sstr.str();
+	std::string result;
+	append(result, pack...);
+	return result;
 }
 
 } // namespace lib
@@ -35,18 +35,74 @@
  *   -# The @c enum value.
  *   -# The string representation of the @c enum value.
  *   All values of the @c enum should be in this list.
+ *
+ * The list is expanded to @c switch statements, so the conversions don't
+ * allocate memory or search a table:
+ * - An enumerate is converted to its string literal by a @c switch on the
+ *   enumerate.
+ * - A string is converted by a @c switch on its @ref detail::enum_hash(),
+ *   the case labels are the hashes of the string literals, calculated at
+ *   compile-time. Since the labels of a @c switch need to be unique, the
+ *   compiler validates the hash is a perfect hash for the strings of the
+ *   enumerate. The matching string is compared once, to reject strings with
+ *   the same hash.
  */
 
 #ifndef LIB_STRING_ENUMERATE_TPP_INCLUDED
 #define LIB_STRING_ENUMERATE_TPP_INCLUDED
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
+namespace detail {
+
+/**
+ * Hashes a string literal.
+ *
+ * The hash is the 32-bit FNV-1a hash, calculated at compile-time for the
+ * string literals in the case labels.
+ *
+ * @param string                  The string to hash.
+ * @param hash                    The hash of the preceding characters.
+ *
+ * @returns                       The hash of the string.
+ */
+constexpr uint32_t
+enum_hash(const char* string, const uint32_t hash = 2166136261u)
+{
+	return *string
+			? enum_hash(string + 1
+				, (hash ^ static_cast<unsigned char>(*string)) * 16777619u)
+			: hash;
+}
+
+/**
+ * Hashes a string.
+ *
+ * The run-time version of @ref enum_hash(const char*, const uint32_t).
+ *
+ * @param string                  The string to hash.
+ *
+ * @returns                       The hash of the string.
+ */
+inline uint32_t
+enum_hash(const std::string& string)
+{
+	uint32_t hash = 2166136261u;
+	for(const char c : string) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+	}
+	return hash;
+}
+
+} // namespace detail
+
 /**
  * Declares the stream operators for an enumerate type.
  *
  * The operators declared are:
+ * - const char* enum_to_string(T);
  * - std::ostream& operator<<(std::ostream, T);
  * - void operator<<(std::string, T);
  * - std::istream& operator>>(std::istream, T&);
@@ -57,6 +113,9 @@
  * @param T                       The type of the enumerate.
  */
 #define ENUM_DECLARE_STREAM_OPERATORS(T)                                     \
+	const char*                                                              \
+	enum_to_string(const T rhs);                                             \
+                                                                             \
 	std::ostream&                                                            \
 	operator<<(std::ostream& lhs, const T rhs);                              \
                                                                              \
@@ -85,6 +144,12 @@
  * @param T                      The type of the enumerate.
  */
 #define ENUM_DEFINE_STREAM_OPERATORS(T)                                      \
+	const char*                                                              \
+	enum_to_string(const T rhs)                                              \
+	{                                                                        \
+		return detail::enum_to_string(rhs);                                  \
+	}	                                                                     \
+                                                                             \
 	std::ostream&                                                            \
 	operator<<(std::ostream& lhs, const T rhs)                               \
 	{                                                                        \
@@ -111,6 +176,35 @@
 
 namespace detail {
 
+/**
+ * Converts an enumerate value to a string.
+ *
+ * Contains the implementation details for a function declared in
+ * @ref ENUM_DECLARE_STREAM_OPERATORS. This version implements:
+ * - const char* enum_to_string(T);
+ *
+ * @pre                           std::is_enum<T>::value == true
+ *
+ * @param rhs                     The enumerate to convert.
+ *
+ * @returns                       The string literal of the enumerate.
+ */
+template<class T>
+typename std::enable_if<std::is_enum<T>::value, const char*>::type
+enum_to_string(const T rhs)
+{
+#define ENUM(ENUMERATE, STRING)    \
+	case ENUM_TYPE::ENUMERATE: return STRING
+
+	switch(rhs) {
+		ENUM_LIST
+	}
+
+#undef ENUM
+
+	ENUM_FAIL_OUTPUT(rhs);
+}
+
 /**
  * Stream operator for an enumerate value.
  *
@@ -129,9 +223,7 @@ template<class T>
 typename std::enable_if<std::is_enum<T>::value, std::ostream&>::type
 operator<<(std::ostream& lhs, const T rhs)
 {
-	std::string str;
-	str << rhs;
-	lhs << str;
+	lhs << enum_to_string(rhs);
 	return lhs;
 }
 
@@ -150,18 +242,41 @@ operator<<(std::ostream& lhs, const T rhs)
 template<class T>
 typename std::enable_if<std::is_enum<T>::value>::type
 operator<<(std::string& lhs, const T rhs)
+{
+	lhs = enum_to_string(rhs);
+}
+
+/**
+ * Stream operator for an enumerate value.
+ *
+ * Contains the implementation details for an operator declared in
+ * @ref ENUM_DECLARE_STREAM_OPERATORS. This version implements:
+ * - void operator>>(std::string, T&);
+ *
+ * @pre                           std::is_enum<T>::value == true
+ *
+ * @param lhs                     The string to read from.
+ * @param rhs                     The enumerate to read.
+ */
+template<class T>
+typename std::enable_if<std::is_enum<T>::value>::type
+operator>>(const std::string& lhs, T& rhs)
 {
 #define ENUM(ENUMERATE, STRING)    \
-	case ENUM_TYPE::ENUMERATE: lhs = STRING; \
-	return
+	case enum_hash(STRING): \
+		if(lhs == STRING) { \
+			rhs = ENUM_TYPE::ENUMERATE; \
+			return; \
+		} \
+		break
 
-	switch(rhs) {
+	switch(enum_hash(lhs)) {
 		ENUM_LIST
 	}
 
 #undef ENUM
 
-	ENUM_FAIL_OUTPUT(rhs);
+	ENUM_FAIL_INPUT(lhs);
 }
 
 /**
@@ -188,38 +303,6 @@ operator>>(std::istream& lhs, T& rhs)
 	return lhs;
 }
 
-/**
- * Stream operator for an enumerate value.
- *
- * Contains the implementation details for an operator declared in
- * @ref ENUM_DECLARE_STREAM_OPERATORS. This version implements:
- * - void operator>>(std::string, T&);
- *
- * @pre                           std::is_enum<T>::value == true
- *
- * @param lhs                     The string to read from.
- * @param rhs                     The enumerate to read.
- */
-template<class T>
-typename std::enable_if<std::is_enum<T>::value>::type
-operator>>(const std::string& lhs, T& rhs)
-{
-
-#define ENUM(enumerate, string)    \
-	do { \
-		if(lhs == string) { \
-			rhs = ENUM_TYPE::enumerate; \
-			return; \
-		} \
-	} while(0)
-
-	ENUM_LIST
-
-#undef ENUM
-
-	ENUM_FAIL_INPUT(lhs);
-}
-
 } // namespace detail
 
 #endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains a view on a string.
+ */
+
+#ifndef LIB_STRING_STRING_VIEW_TPP_INCLUDED
+#define LIB_STRING_STRING_VIEW_TPP_INCLUDED
+
+#include "lib/string/concatenate.tpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <string>
+
+namespace lib {
+
+/**
+ * A view on a string.
+ *
+ * The view refers to the characters of another string, so parsing a string
+ * doesn't need to copy its parts. The view is only valid as long as the
+ * string it refers to.
+ *
+ * This is a subset of the @c std::string_view of C++17.
+ */
+class tstring_view final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/** Returned by @ref find() when the character is not found. */
+	static const size_t npos = static_cast<size_t>(-1);
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	tstring_view()
+		: data_("")
+		, size_(0)
+	{
+	}
+
+	tstring_view(const char* data__, const size_t size__)
+		: data_(data__)
+		, size_(size__)
+	{
+	}
+
+	/** Views a string literal. */
+	tstring_view(const char* data__)
+		: data_(data__)
+		, size_(std::strlen(data__))
+	{
+	}
+
+	/** Views a string. */
+	tstring_view(const std::string& string)
+		: data_(string.data())
+		, size_(string.size())
+	{
+	}
+
+	~tstring_view() = default;
+
+	tstring_view&
+	operator=(const tstring_view&) = default;
+	tstring_view(const tstring_view&) = default;
+
+	tstring_view&
+	operator=(tstring_view&&) = default;
+	tstring_view(tstring_view&&) = default;
+
+
+	/***** ***** Operators. ***** *****/
+
+	char
+	operator[](const size_t index) const
+	{
+		return data_[index];
+	}
+
+	/**
+	 * Returns a part of the view.
+	 *
+	 * @param position            The first character of the part, when
+	 *                            beyond the end the part is empty.
+	 * @param size                The maximum size of the part.
+	 */
+	tstring_view
+	substr(const size_t position, const size_t size = npos) const
+	{
+		if(position >= size_) {
+			return tstring_view(data_ + size_, 0);
+		}
+		return tstring_view(
+				  data_ + position
+				, size < size_ - position ? size : size_ - position);
+	}
+
+	/**
+	 * Finds a character.
+	 *
+	 * @param c                   The character to find.
+	 * @param position            The position to start searching.
+	 *
+	 * @returns                   The position of the character or @ref npos.
+	 */
+	size_t
+	find(const char c, const size_t position = 0) const
+	{
+		for(size_t i = position; i < size_; ++i) {
+			if(data_[i] == c) {
+				return i;
+			}
+		}
+		return npos;
+	}
+
+	/** Returns a copy of the viewed characters. */
+	std::string
+	str() const
+	{
+		return std::string(data_, size_);
+	}
+
+	bool
+	operator==(const tstring_view& rhs) const
+	{
+		return size_ == rhs.size_
+				&& std::memcmp(data_, rhs.data_, size_) == 0;
+	}
+
+	bool
+	operator!=(const tstring_view& rhs) const
+	{
+		return !(*this == rhs);
+	}
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	const char*
+	data() const
+	{
+		return data_;
+	}
+
+	size_t
+	size() const
+	{
+		return size_;
+	}
+
+	bool
+	empty() const
+	{
+		return size_ == 0;
+	}
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The first character viewed. */
+	const char* data_;
+
+	/** The number of characters viewed. */
+	size_t size_;
+};
+
+inline std::ostream&
+operator<<(std::ostream& lhs, const tstring_view& rhs)
+{
+	lhs.write(rhs.data(), static_cast<std::streamsize>(rhs.size()));
+	return lhs;
+}
+
+/**
+ * Parses an unsigned number.
+ *
+ * @param string                  The string to parse, it shall only contain
+ *                                decimal digits.
+ * @param value                   The parsed value, only modified upon
+ *                                success.
+ *
+ * @returns                       Whether the string is a valid number in
+ *                                the range of the value.
+ */
+inline bool
+parse(const tstring_view& string, uint32_t& value)
+{
+	if(string.empty()) {
+		return false;
+	}
+
+	uint64_t result = 0;
+	for(size_t i = 0; i < string.size(); ++i) {
+		if(string[i] < '0' || string[i] > '9') {
+			return false;
+		}
+		result = result * 10 + static_cast<uint64_t>(string[i] - '0');
+		if(result > std::numeric_limits<uint32_t>::max()) {
+			return false;
+		}
+	}
+
+	value = static_cast<uint32_t>(result);
+	return true;
+}
+
+namespace detail {
+
+/** The formatter for a view on a string. */
+template<>
+struct tformatter<tstring_view>
+{
+	static size_t
+	size(const tstring_view& value)
+	{
+		return value.size();
+	}
+
+	static void
+	append(std::string& buffer, const tstring_view& value)
+	{
+		buffer.append(value.data(), value.size());
+	}
+};
+
+} // namespace detail
+
+} // namespace lib
+
+#endif
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "communication"
+
+#include "modules/communication/detail/coroutine_receiver.hpp"
+
+#include "lib/exception/validate.tpp"
+#include "modules/communication/detail/receiver.hpp"
+#include "lib/string/string_view.tpp"
+#include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
+
+#include <boost/asio/completion_condition.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+
+#include <limits>
+
+namespace communication {
+
+namespace detail {
+
+/*
+ * The operations started by the coroutine.
+ *
+ * The operations are started by @ref lib::tstrand::strand_execute(), which
+ * wraps the handler in the strand when enabled. Since the type of the
+ * handler differs the operations are functors with a template operator.
+ */
+
+/** Waits until a stream is readable. */
+template<class STREAM>
+struct twait_readable
+{
+	STREAM& stream;
+
+	template<class HANDLER>
+	void
+	operator()(const HANDLER& handler) const
+	{
+		stream.async_read_some(boost::asio::null_buffers(), handler);
+	}
+};
+
+/** Reads until a terminator is received. */
+template<class STREAM, class BUFFER>
+struct tread_until
+{
+	STREAM& stream;
+	BUFFER& buffer;
+	const std::string& terminator;
+
+	template<class HANDLER>
+	void
+	operator()(const HANDLER& handler) const
+	{
+		boost::asio::async_read_until(stream, buffer, terminator, handler);
+	}
+};
+
+/** Reads a number of bytes. */
+template<class STREAM, class BUFFER>
+struct tread_exactly
+{
+	STREAM& stream;
+	BUFFER& buffer;
+	size_t bytes;
+
+	template<class HANDLER>
+	void
+	operator()(const HANDLER& handler) const
+	{
+		boost::asio::async_read(
+				  stream
+				, buffer
+				, boost::asio::transfer_exactly(bytes)
+				, handler);
+	}
+};
+
+/** Waits until a timer expires. */
+struct twait_timer
+{
+	boost::asio::deadline_timer& timer;
+
+	template<class HANDLER>
+	void
+	operator()(const HANDLER& handler) const
+	{
+		timer.async_wait(handler);
+	}
+};
+
+/** The terminator of the @ref tprotocol::line protocol. */
+static const std::string line_terminator("\n");
+
+/** The terminator of the @ref tprotocol::telnet protocol. */
+static const std::string telnet_terminator("\r\n");
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::thandler::operator()(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred) const
+{
+	receiver->resume(error, bytes_transferred);
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::thandler::operator()(
+		const boost::system::error_code& error) const
+{
+	receiver->resume(error, 0);
+}
+
+template<class STREAM>
+tcoroutine_receiver<STREAM>::tcoroutine_receiver(
+		  tconnection& connection__
+		, STREAM& stream__)
+	: connection_(connection__)
+	, stream_(stream__)
+	, throttle_timer_(stream__.get_io_service())
+{
+}
+
+template<class STREAM>
+tcoroutine_receiver<STREAM>::~tcoroutine_receiver() = default;
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::set_receive_handler(
+		const treceive_handler& receive_handler__)
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	receive_handler_ = receive_handler__;
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::set_throttle_handler(
+		const tthrottle_handler& throttle_handler__)
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	throttle_handler_ = throttle_handler__;
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::receive()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	/* After an error the coroutine starts again. */
+	coroutine_ = lib::tcoroutine();
+
+	connection_.strand_execute(std::bind(
+			  &tcoroutine_receiver::resume
+			, this
+			, boost::system::error_code()
+			, 0));
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::close()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	boost::system::error_code error;
+	throttle_timer_.cancel(error);
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::resume(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred)
+{
+	LOG_T(__PRETTY_FUNCTION__
+			, ": error »", error.message()
+			, "« bytes_transferred »" , bytes_transferred
+			, "«.\n");
+
+	COROUTINE_REENTER(coroutine_) for(;;) {
+
+		if(!input_buffer_ || (input_buffer_->size() == 0
+				&& !has_pending_data(stream_))) {
+
+			input_buffer_.reset();
+
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  twait_readable<STREAM>{stream_}
+					, thandler{this}));
+
+			if(error) {
+				fail(error, bytes_transferred);
+				return;
+			}
+
+			input_buffer_.reset(new tstreambuf(
+					  std::numeric_limits<size_t>::max()
+					, lib::tallocator<char>(lib::thread_pool_resource())));
+		}
+
+		if(connection_.get_protocol() == tprotocol::line) {
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  tread_until<STREAM, tstreambuf>{
+						  stream_
+						, *input_buffer_
+						, line_terminator}
+					, thandler{this}));
+
+		} else if(connection_.get_protocol() == tprotocol::telnet) {
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  tread_until<STREAM, tstreambuf>{
+						  stream_
+						, *input_buffer_
+						, telnet_terminator}
+					, thandler{this}));
+
+		} else if(connection_.get_protocol() == tprotocol::basic) {
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  tread_exactly<STREAM, tstreambuf>{
+						  stream_
+						, *input_buffer_
+						, 4}
+					, thandler{this}));
+
+			total_bytes_transferred_ += bytes_transferred;
+
+			if(error) {
+				fail(error, bytes_transferred);
+				return;
+			}
+
+			VALIDATE(bytes_transferred == 4);
+
+			length_ = network_buffer_to_host(
+					boost::asio::buffer_cast<const char*>(
+						input_buffer_->data()));
+
+			input_buffer_->consume(bytes_transferred);
+
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  tread_exactly<STREAM, tstreambuf>{
+						  stream_
+						, *input_buffer_
+						, length_}
+					, thandler{this}));
+
+		} else {
+			NOT_IMPLEMENTED_YET;
+		}
+
+		total_bytes_transferred_ += bytes_transferred;
+
+		if(error) {
+			fail(error, bytes_transferred);
+			return;
+		}
+
+		if(deliver(bytes_transferred)) {
+			COROUTINE_YIELD(coroutine_, connection_.strand_execute(
+					  twait_timer{throttle_timer_}
+					, thandler{this}));
+
+			if(error == boost::asio::error::operation_aborted) {
+				return;
+			}
+		}
+	}
+}
+
+template<class STREAM>
+void
+tcoroutine_receiver<STREAM>::fail(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred)
+{
+	if(receive_handler_) {
+		receive_handler_(error, bytes_transferred, nullptr);
+	}
+
+	if(input_buffer_) {
+		input_buffer_->consume(bytes_transferred);
+	}
+}
+
+template<class STREAM>
+bool
+tcoroutine_receiver<STREAM>::deliver(const size_t bytes_transferred)
+{
+	logging::recorder::record(
+			  logging::recorder::tevent::frame_received
+			, &connection_
+			, bytes_transferred);
+
+	tmessage message(
+			  connection_.get_protocol()
+			, lib::tstring_view(
+				  boost::asio::buffer_cast<const char*>(input_buffer_->data())
+				, bytes_transferred));
+
+	input_buffer_->consume(bytes_transferred);
+
+	if(receive_handler_) {
+		receive_handler_(boost::system::error_code(), bytes_transferred
+				, &message);
+	}
+
+	const std::chrono::nanoseconds pause = throttle_handler_
+			? throttle_handler_(bytes_transferred)
+			: std::chrono::nanoseconds(0);
+
+	if(pause.count() <= 0) {
+		return false;
+	}
+
+	LOG_D("Receiving paused for »", pause.count(), "« ns.\n");
+
+	throttle_timer_.expires_from_now(
+			boost::posix_time::microseconds(pause.count() / 1000 + 1));
+
+	return true;
+}
+
+template class tcoroutine_receiver<boost::asio::ip::tcp::socket>;
+template class tcoroutine_receiver<boost::asio::posix::stream_descriptor>;
+
+} // namespace detail
+
+} // namespace communication
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#ifndef MODULES_COMMUNICATION_DETAIL_COROUTINE_RECEIVER_HPP_INCLUDED
+#define MODULES_COMMUNICATION_DETAIL_COROUTINE_RECEIVER_HPP_INCLUDED
+
+#include "lib/coroutine/coroutine.hpp"
+#include "lib/memory/memory_resource.hpp"
+#include "modules/communication/detail/connection.hpp"
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/streambuf.hpp>
+
+#include <memory>
+
+namespace communication {
+
+namespace detail {
+
+/**
+ * Class that receives data over a stream.
+ *
+ * This is an alternative for the @ref treceiver with the same interface.
+ * Instead of a chain of handlers the receiving of a message is a single
+ * @ref lib::tcoroutine, which is the completion handler of all its
+ * operations. The handlers are not type-erased and after receiving a
+ * message the next message is received without a post to the strand.
+ *
+ * The receiver is used when the programme is build with
+ * @c ENABLE_COROUTINE_RECEIVER, so both implementations can be compared.
+ *
+ * @tparam STREAM                 The stream type to use.
+ */
+template<class STREAM>
+class tcoroutine_receiver
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @pre                       lifetime(connection__) > lifetime(*this)
+	 * @pre                       lifetime(stream__) > lifetime(*this)
+	 *
+	 * @param connection__        The connection containing the settings for
+	 *                            the connector.
+	 * @param stream__            The stream used for communication.
+	 */
+	tcoroutine_receiver(tconnection& connection__, STREAM& stream__);
+
+	~tcoroutine_receiver();
+
+	tcoroutine_receiver&
+	operator=(const tcoroutine_receiver&) = delete;
+	tcoroutine_receiver(const tcoroutine_receiver&) = delete;
+
+	tcoroutine_receiver&
+	operator=(tcoroutine_receiver&&) = delete;
+	tcoroutine_receiver(tcoroutine_receiver&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Starts receiving messages.
+	 *
+	 * For every message received @ref receive_handler_ is called. Until an
+	 * error occurs the coroutine continues with the next message.
+	 */
+	void
+	receive();
+
+	/** See @ref treceiver::close(). */
+	void
+	close();
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	void
+	set_receive_handler(const treceive_handler& receive_handler__);
+
+	void
+	set_throttle_handler(const tthrottle_handler& throttle_handler__);
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/** See @ref treceiver::tstreambuf. */
+	typedef boost::asio::basic_streambuf<lib::tallocator<char>> tstreambuf;
+
+	/** The completion handler of the operations, resumes the coroutine. */
+	struct thandler
+	{
+		/** The receiver to resume. */
+		tcoroutine_receiver* receiver;
+
+		/** The handler for the stream operations. */
+		void
+		operator()(
+				  const boost::system::error_code& error
+				, const size_t bytes_transferred) const;
+
+		/** The handler for the timer. */
+		void
+		operator()(const boost::system::error_code& error) const;
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The settings for the connection. */
+	tconnection& connection_;
+
+	/** The stream used for the communication. */
+	STREAM& stream_;
+
+	/** The user supplied functor to call after a message is received. */
+	treceive_handler receive_handler_{};
+
+	/** See @ref treceiver::throttle_handler_. */
+	tthrottle_handler throttle_handler_{};
+
+	/** The timer to resume receiving after a pause. */
+	boost::asio::deadline_timer throttle_timer_;
+
+	/** The total number of bytes received over the @ref stream_. */
+	size_t total_bytes_transferred_{0};
+
+	/** See @ref treceiver::input_buffer_. */
+	std::unique_ptr<tstreambuf> input_buffer_{};
+
+	/** The length of the message of the @ref tprotocol::basic protocol. */
+	uint32_t length_{0};
+
+	/** The state of the coroutine in @ref resume(). */
+	lib::tcoroutine coroutine_{};
+
+	/**
+	 * The coroutine receiving the messages.
+	 *
+	 * @param error               The result of the last operation.
+	 * @param bytes_transferred   The bytes transferred by the last
+	 *                            operation.
+	 */
+	void
+	resume(
+			  const boost::system::error_code& error
+			, const size_t bytes_transferred);
+
+	/**
+	 * Reports an error to the @ref receive_handler_.
+	 *
+	 * @param error               The error of the operation.
+	 * @param bytes_transferred   The bytes transferred by the operation.
+	 */
+	void
+	fail(
+			  const boost::system::error_code& error
+			, const size_t bytes_transferred);
+
+	/**
+	 * Delivers a received message to the @ref receive_handler_.
+	 *
+	 * @param bytes_transferred   The size of the message in the
+	 *                            @ref input_buffer_.
+	 *
+	 * @returns                   Whether receiving is throttled, then the
+	 *                            @ref throttle_timer_ is set.
+	 */
+	bool
+	deliver(const size_t bytes_transferred);
+};
+
+extern template class tcoroutine_receiver<boost::asio::ip::tcp::socket>;
+typedef tcoroutine_receiver<boost::asio::ip::tcp::socket>
+		tcoroutine_receiver_socket;
+
+extern template class
+		tcoroutine_receiver<boost::asio::posix::stream_descriptor>;
+typedef tcoroutine_receiver<boost::asio::posix::stream_descriptor>
+		tcoroutine_receiver_file;
+
+} // namespace detail
+
+} // namespace communication
+
+#endif
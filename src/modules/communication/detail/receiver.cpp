@@ -17,12 +17,16 @@
 #include "modules/communication/detail/receiver.hpp"
 
 #include "lib/exception/validate.tpp"
+#include "lib/string/string_view.tpp"
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
 
 #include <boost/asio/completion_condition.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/read_until.hpp>
 
+#include <limits>
+
 namespace communication {
 
 namespace detail {
@@ -31,6 +35,8 @@ template<class STREAM>
 treceiver<STREAM>::treceiver(tconnection& connection__, STREAM& stream__)
 	: connection_(connection__)
 	, stream_(stream__)
+	, throttle_timer_(stream__.get_io_service())
+	, self_(std::make_shared<treceiver*>(this))
 {
 }
 
@@ -47,6 +53,16 @@ treceiver<STREAM>::set_receive_handler(
 	receive_handler_ = receive_handler__;
 }
 
+template<class STREAM>
+void
+treceiver<STREAM>::set_throttle_handler(
+		const tthrottle_handler& throttle_handler__)
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	throttle_handler_ = throttle_handler__;
+}
+
 template<class STREAM>
 void
 treceiver<STREAM>::receive()
@@ -56,12 +72,72 @@ treceiver<STREAM>::receive()
 	connection_.strand_execute(std::bind(&treceiver::receive_message, this));
 }
 
+template<class STREAM>
+void
+treceiver<STREAM>::close()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	boost::system::error_code error;
+	throttle_timer_.cancel(error);
+}
+
 template<class STREAM>
 void
 treceiver<STREAM>::receive_message()
 {
 	LOG_T(__PRETTY_FUNCTION__, ".\n");
 
+	if(input_buffer_
+			&& (input_buffer_->size() != 0 || has_pending_data(stream_))) {
+
+		receive_data();
+		return;
+	}
+
+	input_buffer_.reset();
+
+	auto functor = [&](tasio_receive_handler&& handler)
+		{
+			stream_.async_read_some(boost::asio::null_buffers(), handler);
+		};
+
+	connection_.strand_execute(
+			  functor
+			, std::bind(
+				  &treceiver::asio_readable_handler
+				, this
+				, std::placeholders::_1
+				, std::placeholders::_2));
+}
+
+template<class STREAM>
+void
+treceiver<STREAM>::asio_readable_handler(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(error) {
+		if(receive_handler_) {
+			receive_handler_(error, bytes_transferred, nullptr);
+		}
+		return;
+	}
+
+	input_buffer_.reset(new tstreambuf(
+			  std::numeric_limits<size_t>::max()
+			, lib::tallocator<char>(lib::thread_pool_resource())));
+	receive_data();
+}
+
+template<class STREAM>
+void
+treceiver<STREAM>::receive_data()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
 	switch(connection_.get_protocol()) {
 		case tprotocol::direct :
 			/*
@@ -111,7 +187,7 @@ treceiver<STREAM>::receive_until(const std::string& terminator)
 		{
 			boost::asio::async_read_until(
 					  stream_
-					, input_buffer_
+					, *input_buffer_
 					, terminator
 					, handler);
 		};
@@ -137,7 +213,7 @@ treceiver<STREAM>::receive(
 		{
 			boost::asio::async_read(
 					  stream_
-					, input_buffer_
+					, *input_buffer_
 					, boost::asio::transfer_exactly(bytes)
 					, handler);
 		};
@@ -162,16 +238,16 @@ treceiver<STREAM>::asio_receive_handler_read_length(
 		if(receive_handler_) {
 			receive_handler_(error, bytes_transferred, nullptr);
 		}
-		input_buffer_.consume(bytes_transferred);
+		input_buffer_->consume(bytes_transferred);
 		return;
 	}
 
 	VALIDATE(bytes_transferred == 4);
 
 	const uint32_t length = network_buffer_to_host(
-			boost::asio::buffer_cast<const char*>(input_buffer_.data()));
+			boost::asio::buffer_cast<const char*>(input_buffer_->data()));
 
-	input_buffer_.consume(bytes_transferred);
+	input_buffer_->consume(bytes_transferred);
 
 	receive(length, std::bind(
 			  &treceiver::asio_receive_handler
@@ -197,26 +273,65 @@ treceiver<STREAM>::asio_receive_handler(
 		if(receive_handler_) {
 			receive_handler_(error, bytes_transferred, nullptr);
 		}
-		input_buffer_.consume(bytes_transferred);
+		input_buffer_->consume(bytes_transferred);
 		return;
 	}
 
+	logging::recorder::record(
+			  logging::recorder::tevent::frame_received
+			, &connection_
+			, bytes_transferred);
+
 	/* decode message */
 	tmessage message(
 			  connection_.get_protocol()
-			, std::string(
-				  boost::asio::buffer_cast<const char*>(input_buffer_.data())
+			, lib::tstring_view(
+				  boost::asio::buffer_cast<const char*>(input_buffer_->data())
 				, bytes_transferred));
 
-	input_buffer_.consume(bytes_transferred);
+	input_buffer_->consume(bytes_transferred);
 
 	if(receive_handler_) {
 		receive_handler_(error, bytes_transferred, &message);
 	}
 
+	const std::chrono::nanoseconds pause = throttle_handler_
+			? throttle_handler_(bytes_transferred)
+			: std::chrono::nanoseconds(0);
+
+	if(pause.count() > 0) {
+		LOG_D("Receiving paused for »", pause.count(), "« ns.\n");
+
+		throttle_timer_.expires_from_now(
+				boost::posix_time::microseconds(pause.count() / 1000 + 1));
+
+		throttle_timer_.async_wait(std::bind(
+				  &treceiver::throttle_timer_handler
+				, std::weak_ptr<treceiver*>(self_)
+				, std::placeholders::_1));
+		return;
+	}
+
 	receive();
 }
 
+template<class STREAM>
+void
+treceiver<STREAM>::throttle_timer_handler(
+		  const std::weak_ptr<treceiver*>& self
+		, const boost::system::error_code& error)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(error == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	if(const std::shared_ptr<treceiver*> receiver = self.lock()) {
+		(*receiver)->receive();
+	}
+}
+
 template class treceiver<boost::asio::ip::tcp::socket>;
 template class treceiver<boost::asio::posix::stream_descriptor>;
 
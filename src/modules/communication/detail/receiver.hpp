@@ -15,16 +15,40 @@
 #ifndef MODULES_COMMUNICATION_DETAIL_RECEIVER_HPP_INCLUDED
 #define MODULES_COMMUNICATION_DETAIL_RECEIVER_HPP_INCLUDED
 
+#include "lib/memory/memory_resource.hpp"
 #include "modules/communication/detail/connection.hpp"
 
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/asio/streambuf.hpp>
 
+#include <memory>
+
 namespace communication {
 
 namespace detail {
 
+/**
+ * Returns whether a stream has received data not read yet.
+ *
+ * @tparam STREAM                 The stream type to use.
+ *
+ * @param stream                  The stream to test.
+ *
+ * @returns                       Whether data is pending, @c false upon
+ *                                failure.
+ */
+template<class STREAM>
+inline bool
+has_pending_data(STREAM& stream)
+{
+	typename STREAM::bytes_readable command(true);
+	boost::system::error_code error;
+	stream.io_control(command, error);
+	return !error && command.get() != 0;
+}
+
 /**
  * Class that receives data over a stream.
  *
@@ -72,12 +96,24 @@ public:
 	void
 	receive();
 
+	/**
+	 * Stops receiving.
+	 *
+	 * Cancels a pending pause, so receiving doesn't resume after the stream
+	 * is closed.
+	 */
+	void
+	close();
+
 
 	/***** ***** Setters, getters. ***** *****/
 
 	void
 	set_receive_handler(const treceive_handler& receive_handler__);
 
+	void
+	set_throttle_handler(const tthrottle_handler& throttle_handler__);
+
 private:
 
 	/***** ***** Types. ***** *****/
@@ -88,6 +124,14 @@ private:
 			)>
 			tasio_receive_handler;
 
+	/**
+	 * The buffer type of the @ref input_buffer_.
+	 *
+	 * The buffer is allocated for every message, so it uses the pools of
+	 * the io thread instead of the global allocator.
+	 */
+	typedef boost::asio::basic_streambuf<lib::tallocator<char>> tstreambuf;
+
 
 	/***** ***** Members. ***** *****/
 
@@ -100,21 +144,62 @@ private:
 	/** The user supplied functor to call after a message is received. */
 	treceive_handler receive_handler_{};
 
+	/**
+	 * The user supplied functor to throttle receiving.
+	 *
+	 * While receiving is paused the data stays in the kernel's buffers, so
+	 * TCP's flow control slows down the sender.
+	 */
+	tthrottle_handler throttle_handler_{};
+
+	/** The timer to resume receiving after a pause. */
+	boost::asio::deadline_timer throttle_timer_;
+
+	/**
+	 * The receiver shared with the handler of the @ref throttle_timer_.
+	 *
+	 * The receiver is a member of its socket, not owned by a shared
+	 * pointer, so it can't use @c shared_from_this(). Instead the handler
+	 * holds a weak pointer and only resumes receiving while the receiver
+	 * exists.
+	 */
+	std::shared_ptr<treceiver*> self_;
+
 	/** The total number of bytes received over the @ref stream_. */
 	size_t total_bytes_transferred_{0};
 
-	/** Buffer to store the incoming stream data. */
-	boost::asio::streambuf input_buffer_{};
+	/**
+	 * Buffer to store the incoming stream data.
+	 *
+	 * Most connections are idle most of the time, so the buffer is released
+	 * when it's empty after receiving a message and the stream has no
+	 * pending data. Before receiving the next message the receiver waits
+	 * until the stream is readable, only then the buffer is allocated
+	 * again. A busy connection keeps its buffer, so it doesn't wait nor
+	 * allocate for every message.
+	 */
+	std::unique_ptr<tstreambuf> input_buffer_{};
 
 	/**
 	 * Receives a message.
 	 *
 	 * Depending on the protocol it calls a helper function to receive the
-	 * stream data for the message.
+	 * stream data for the message. When the @ref input_buffer_ is empty and
+	 * no data is pending it first waits until the stream is readable.
 	 */
 	void
 	receive_message();
 
+	/** Receives the data of a message, the @ref input_buffer_ exists. */
+	void
+	receive_data();
+
+	/** The handler functor for the wait in @ref receive_message. */
+	void
+	asio_readable_handler(
+		  const boost::system::error_code& error
+		, const size_t bytes_transferred);
+
 	/**
 	 * Receive data until a terminator is found.
 	 *
@@ -162,6 +247,17 @@ private:
 	asio_receive_handler(
 		  const boost::system::error_code& error
 		, const size_t bytes_transferred);
+
+	/**
+	 * The handler for the @ref throttle_timer_.
+	 *
+	 * @param self                The receiver, see @ref self_.
+	 * @param error               The error of the wait.
+	 */
+	static void
+	throttle_timer_handler(
+			  const std::weak_ptr<treceiver*>& self
+			, const boost::system::error_code& error);
 };
 
 extern template class treceiver<boost::asio::ip::tcp::socket>;
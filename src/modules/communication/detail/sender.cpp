@@ -17,6 +17,7 @@
 #include "modules/communication/detail/sender.hpp"
 
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
 
 #include <boost/asio/write.hpp>
 
@@ -32,38 +33,44 @@ tsender<STREAM>::tsender(tconnection& connection__, STREAM& stream__)
 }
 
 template<class STREAM>
-tsender<STREAM>::~tsender() = default;
+tsender<STREAM>::~tsender()
+{
+	destroy(incoming_);
+	for(const tqueue& queue : queues_) {
+		destroy(queue.front);
+	}
+	destroy(current_);
+}
 
 template<class STREAM>
-uint32_t
-tsender<STREAM>::send_action(const std::string& message)
+void
+tsender<STREAM>::send_action(
+		  const std::string& message
+		, const tpriority priority
+		, const tconflation_key key)
 {
-	LOG_T(__PRETTY_FUNCTION__, ": message »", message, "«.\n");
-
-	uint32_t id__;
-	while((id__ = ++id_) == 0) { /* NOTHING */ }
-
-	connection_.strand_execute(std::bind(
-			  &tsender::send_message
-			, this
-			, tmessage(tmessage::ttype::action, id__, message)));
+	LOG_T(__PRETTY_FUNCTION__
+			, ": message »", message
+			, "« key »", key
+			, "«.\n");
 
-	return id__;
+	/* The id is set when the message is sent. */
+	send_message(tmessage::ttype::action, 0, message, priority, key);
 }
 
 template<class STREAM>
 void
-tsender<STREAM>::send_reply(const uint32_t id, const std::string& message)
+tsender<STREAM>::send_reply(
+		  const uint32_t id
+		, const std::string& message
+		, const tpriority priority)
 {
 	LOG_T(__PRETTY_FUNCTION__
 			, ": id »", id
 			, "« message »", message
 			, "«.\n");
 
-	connection_.strand_execute(std::bind(
-			  &tsender::send_message
-			, this
-			, tmessage(tmessage::ttype::reply, id, message)));
+	send_message(tmessage::ttype::reply, id, message, priority, 0);
 }
 
 template<class STREAM>
@@ -77,18 +84,94 @@ tsender<STREAM>::set_send_handler(const tsend_handler& send_handler__)
 
 template<class STREAM>
 void
-tsender<STREAM>::send_message(tmessage message)
+tsender<STREAM>::set_last_action_id(const uint32_t id)
 {
-	LOG_T(__PRETTY_FUNCTION__
-			, ": id »", message.id()
-			, "« message »", message.contents()
-			, "«.\n");
+	LOG_T(__PRETTY_FUNCTION__, ": id »", id, "«.\n");
 
-	const bool sending = !messages_.empty();
-	messages_.push_back(std::move(message));
+	id_ = id;
+}
 
-	if(!sending) {
-		send_queue_message();
+template<class STREAM>
+void
+tsender<STREAM>::send_message(
+		  const tmessage::ttype type
+		, const uint32_t id
+		, const std::string& message
+		, const tpriority priority
+		, const tconflation_key key)
+{
+	/*
+	 * The node is deallocated by the sender, in an io thread, the resource
+	 * returns it to the pools of this thread.
+	 */
+	void* memory = lib::thread_pool_resource()->allocate(
+			  sizeof(tnode)
+			, alignof(tnode));
+
+	tnode* node = new(memory) tnode{
+			  nullptr
+			, priority
+			, key
+			, tmessage(type, id, message)};
+
+	/* Once pushed the sender may take the node, so use a copy of the head. */
+	tnode* head = incoming_.load(std::memory_order_relaxed);
+	do {
+		node->next = head;
+	} while(!incoming_.compare_exchange_weak(
+			  head
+			, node
+			, std::memory_order_acq_rel
+			, std::memory_order_relaxed));
+
+	/* The producer only queues, the sender always runs in the strand. */
+	if(!head) {
+		connection_.strand_execute(
+				std::bind(&tsender::send_queue_message, this));
+	}
+}
+
+template<class STREAM>
+void
+tsender<STREAM>::take_incoming()
+{
+	/* Reverse the stack, so the oldest message is queued first. */
+	tnode* stack = incoming_.exchange(busy(), std::memory_order_acquire);
+	tnode* nodes = nullptr;
+	while(stack && stack != busy()) {
+		tnode* next = stack->next;
+		stack->next = nodes;
+		nodes = stack;
+		stack = next;
+	}
+
+	while(nodes) {
+		tnode* node = nodes;
+		nodes = node->next;
+		node->next = nullptr;
+
+		tqueue& queue = queues_[static_cast<size_t>(node->priority)];
+
+		tnode* queued = nullptr;
+		if(node->key != 0) {
+			queued = queue.front;
+			while(queued && queued->key != node->key) {
+				queued = queued->next;
+			}
+		}
+
+		if(queued) {
+			LOG_D("Conflated message with key »", node->key, "«.\n");
+
+			queued->message = std::move(node->message);
+			destroy(node);
+		} else if(queue.back) {
+			queue.back->next = node;
+			queue.back = node;
+		} else {
+			queue.front = node;
+			queue.back = node;
+		}
 	}
 }
 
@@ -105,12 +188,38 @@ tsender<STREAM>::send_queue_message_handler(
 
 	total_bytes_transferred_ += bytes_transferred;
 
+	logging::recorder::record(
+			  logging::recorder::tevent::frame_sent
+			, &connection_
+			, bytes_transferred);
+
 	if(send_handler_) {
-		send_handler_(error, bytes_transferred, messages_.front());
+		send_handler_(error, bytes_transferred, current_->message);
 	}
 
-	messages_.pop_front();
-	if(!messages_.empty()) {
+	destroy(current_);
+	current_ = nullptr;
+
+	for(const tqueue& queue : queues_) {
+		if(queue.front) {
+			send_queue_message();
+			return;
+		}
+	}
+
+	/*
+	 * Release the buffer before the sender becomes idle, after that a
+	 * producer may start sending again.
+	 */
+	std::string().swap(send_data_);
+
+	tnode* expected = busy();
+	if(!incoming_.compare_exchange_strong(
+			  expected
+			, nullptr
+			, std::memory_order_acq_rel
+			, std::memory_order_acquire)) {
+
 		send_queue_message();
 	}
 }
@@ -119,13 +228,32 @@ template<class STREAM>
 void
 tsender<STREAM>::send_queue_message()
 {
+	take_incoming();
+
+	for(tqueue& queue : queues_) {
+		if(queue.front) {
+			current_ = queue.front;
+			queue.front = current_->next;
+			if(!queue.front) {
+				queue.back = nullptr;
+			}
+			current_->next = nullptr;
+			break;
+		}
+	}
+
+	if(current_->message.type() == tmessage::ttype::action) {
+		uint32_t id;
+		while((id = ++id_) == 0) { /* NOTHING */ }
+		current_->message.set_id(id);
+	}
+
 	LOG_T(__PRETTY_FUNCTION__
-			, ": id »", messages_.front().id()
-			, "« data »", messages_.front().contents()
+			, ": id »", current_->message.id()
+			, "« data »", current_->message.contents()
 			, "«.\n");
 
-	std::ostream os(&send_buffer_);
-	os << messages_.front().encode(connection_.get_protocol());
+	current_->message.encode(connection_.get_protocol(), send_data_);
 
 	typedef std::function<void(
 				  const boost::system::error_code&
@@ -137,7 +265,7 @@ tsender<STREAM>::send_queue_message()
 		{
 			boost::asio::async_write(
 					  stream_
-					, send_buffer_
+					, boost::asio::buffer(send_data_)
 					, handler);
 		};
 
@@ -150,6 +278,31 @@ tsender<STREAM>::send_queue_message()
 				, std::placeholders::_2));
 }
 
+/** The object whose address marks a busy sender. */
+static char busy_marker;
+
+template<class STREAM>
+typename tsender<STREAM>::tnode*
+tsender<STREAM>::busy()
+{
+	return reinterpret_cast<tnode*>(&busy_marker);
+}
+
+template<class STREAM>
+void
+tsender<STREAM>::destroy(tnode* node)
+{
+	while(node && node != busy()) {
+		tnode* next = node->next;
+		node->~tnode();
+		lib::thread_pool_resource()->deallocate(
+				  node
+				, sizeof(tnode)
+				, alignof(tnode));
+		node = next;
+	}
+}
+
 template class tsender<boost::asio::ip::tcp::socket>;
 template class tsender<boost::asio::posix::stream_descriptor>;
 
@@ -15,13 +15,15 @@
 #ifndef MODULES_COMMUNICATION_DETAIL_SENDER_HPP_INCLUDED
 #define MODULES_COMMUNICATION_DETAIL_SENDER_HPP_INCLUDED
 
+#include "lib/memory/memory_resource.hpp"
 #include "modules/communication/detail/connection.hpp"
 
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/streambuf.hpp>
 
-#include <queue>
+#include <array>
+#include <atomic>
+#include <string>
 
 namespace communication {
 
@@ -69,27 +71,41 @@ public:
 	 *
 	 * Once the connector is done it calls its @ref send_handler_.
 	 *
-	 * Multiple send messages can be queued.
+	 * Multiple send messages can be queued, from any thread. A message
+	 * replaced by a message with the same conflation key is not sent and
+	 * its @ref send_handler_ isn't called.
 	 *
-	 * @param message             The data of the action message to send.
+	 * The message gets its id when it's taken from the queue to be sent,
+	 * so the ids on the stream are consecutive, regardless of the
+	 * priorities and conflation. The @ref send_handler_ gets the message
+	 * with its id.
 	 *
-	 * @returns                   The allocated message id.
+	 * @param message             The data of the action message to send.
+	 * @param priority            The priority of the message.
+	 * @param key                 The conflation key of the message.
 	 */
-	uint32_t
-	send_action(const std::string& message);
+	void
+	send_action(
+			  const std::string& message
+			, const tpriority priority = tpriority::interactive
+			, const tconflation_key key = 0);
 
 	/**
 	 * Sends an reply message.
 	 *
 	 * Once the connector is done it calls its @ref send_handler_.
 	 *
-	 * Multiple send messages can be queued.
+	 * Multiple send messages can be queued, from any thread.
 	 *
 	 * @param id                  The id of the message to send.
 	 * @param message             The data of the reply message to send.
+	 * @param priority            The priority of the message.
 	 */
 	void
-	send_reply(const uint32_t id, const std::string& message);
+	send_reply(
+			  const uint32_t id
+			, const std::string& message
+			, const tpriority priority = tpriority::control);
 
 
 	/***** ***** Setters, getters. ***** *****/
@@ -97,8 +113,48 @@ public:
 	void
 	set_send_handler(const tsend_handler& send_handler__);
 
+	/**
+	 * Sets the id of the last action message sent.
+	 *
+	 * The next action message gets the next id. This allows a resumed
+	 * connection to continue the ids of its previous connection.
+	 *
+	 * @param id                  The id of the last action message.
+	 */
+	void
+	set_last_action_id(const uint32_t id);
+
 private:
 
+	/***** ***** Types. ***** *****/
+
+	/** A queued message. */
+	struct tnode
+	{
+		/** The next node. */
+		tnode* next;
+
+		/** The priority of the message. */
+		tpriority priority;
+
+		/** The conflation key of the message. */
+		tconflation_key key;
+
+		/** The message to send. */
+		tmessage message;
+	};
+
+	/** A queue with the messages of one priority. */
+	struct tqueue
+	{
+		/** The first message, the next to send. */
+		tnode* front;
+
+		/** The last message. */
+		tnode* back;
+	};
+
+
 	/***** ***** Members. ***** *****/
 
 	/** The settings for the connection. */
@@ -107,21 +163,55 @@ private:
 	/** The stream used for the communication. */
 	STREAM& stream_;
 
-	/** The underlaying buffer used to send the data over the stream. */
-	boost::asio::streambuf send_buffer_{};
+	/**
+	 * The encoded @ref current_ message, which is being sent.
+	 *
+	 * The memory is reused for the next message in the queue and released
+	 * when the queue is empty, so idle connections don't keep their
+	 * largest message.
+	 */
+	std::string send_data_{};
+
+	/**
+	 * The messages queued by the producers.
+	 *
+	 * This is a lock-free stack, so the last queued message is the first
+	 * node. The producers push their messages from any thread, the sender
+	 * moves them to its @ref queues_. The value also holds the state of the
+	 * sender:
+	 * - @c nullptr, the sender is idle. The producer pushing on an idle
+	 *   sender posts the start of sending on the strand.
+	 * - @ref busy(), the sender is sending and the stack is empty.
+	 * - Else the stack, its last node links to @c nullptr or @ref busy().
+	 *
+	 * The sender only becomes idle when the stack is empty, so only one
+	 * message is sent at a time, without a lock or strand.
+	 */
+	std::atomic<tnode*> incoming_{nullptr};
 
 	/**
-	 * The queue with the messages.
+	 * The messages taken from the @ref incoming_ stack.
 	 *
-	 * The @c front() message is send an new messages are pushed at the
-	 * back.
+	 * There is a queue per @ref tpriority, indexed by its value. Only used
+	 * by the sender.
 	 */
-	std::deque<tmessage> messages_{};
+	std::array<tqueue, 3> queues_ {{
+			  {nullptr, nullptr}
+			, {nullptr, nullptr}
+			, {nullptr, nullptr}}};
+
+	/** The message being sent, @c nullptr if none. */
+	tnode* current_{nullptr};
 
 	/** The user supplied functor to call after a message is send. */
 	tsend_handler send_handler_{};
 
-	/** The counter for generating new message ids. */
+	/**
+	 * The counter for generating new message ids.
+	 *
+	 * Only used by the sender, but set by @ref set_last_action_id() from
+	 * any thread.
+	 */
 	std::atomic<uint32_t> id_{0};
 
 	/** The total number of bytes send over the @ref stream_. */
@@ -130,16 +220,42 @@ private:
 	/**
 	 * Message send function.
 	 *
-	 * This function queues the message and then calls
-	 * @ref send_queue_message (if not already sending).
+	 * This function queues the message and when the sender is idle posts
+	 * @ref send_queue_message on the strand of the connection. The function
+	 * may be called from any thread, the sending itself always runs in the
+	 * strand.
 	 *
-	 * @param message             The message to put in the @ref messages_
-	 *                            queue.
+	 * @param type                The type of the message.
+	 * @param id                  The id of the message.
+	 * @param message             The data of the message.
+	 * @param priority            The priority of the message.
+	 * @param key                 The conflation key of the message.
 	 */
 	void
-	send_message(tmessage message);
+	send_message(
+			  const tmessage::ttype type
+			, const uint32_t id
+			, const std::string& message
+			, const tpriority priority
+			, const tconflation_key key);
 
-	/** Sends the @c front() message in the @ref messages_ queue. */
+	/**
+	 * Moves the @ref incoming_ messages to the @ref queues_.
+	 *
+	 * A message with a conflation key replaces the queued message with the
+	 * same key, the replaced message keeps its place in the queue. Since
+	 * the queues hold at most one message per key finding the message is a
+	 * linear search.
+	 */
+	void
+	take_incoming();
+
+	/**
+	 * Sends the first message of the highest priority in the @ref queues_.
+	 *
+	 * @pre                       The @ref queues_ or @ref incoming_ contain
+	 *                            a message.
+	 */
 	void
 	send_queue_message();
 
@@ -148,6 +264,19 @@ private:
 	send_queue_message_handler(
 			  const boost::system::error_code& error
 			, const size_t bytes_transferred);
+
+	/** Returns the marker of the @ref incoming_ stack for a busy sender. */
+	static tnode*
+	busy();
+
+	/**
+	 * Deletes the nodes of a list.
+	 *
+	 * @param node                The first node of the list, the list ends
+	 *                            with @c nullptr or @ref busy().
+	 */
+	static void
+	destroy(tnode* node);
 };
 
 extern template class tsender<boost::asio::ip::tcp::socket>;
@@ -55,16 +55,22 @@ tfile::receive()
 	receiver_.receive();
 }
 
-uint32_t
-tfile::send_action(const std::string& message)
+void
+tfile::send_action(
+		  const std::string& message
+		, const tpriority priority
+		, const tconflation_key key)
 {
-	return sender_.send_action(message);
+	sender_.send_action(message, priority, key);
 }
 
 void
-tfile::send_reply(const uint32_t id__, const std::string& message)
+tfile::send_reply(
+		  const uint32_t id__
+		, const std::string& message
+		, const tpriority priority)
 {
-	sender_.send_reply(id__, message);
+	sender_.send_reply(id__, message, priority);
 }
 
 void
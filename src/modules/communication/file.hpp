@@ -15,6 +15,7 @@
 #ifndef MODULES_COMMUNICATION_FILE_HPP_INCLUDED
 #define MODULES_COMMUNICATION_FILE_HPP_INCLUDED
 
+#include "modules/communication/detail/coroutine_receiver.hpp"
 #include "modules/communication/detail/receiver.hpp"
 #include "modules/communication/detail/sender.hpp"
 
@@ -54,11 +55,17 @@ public:
 	void
 	receive();
 
-	uint32_t
-	send_action(const std::string& message);
+	void
+	send_action(
+			  const std::string& message
+			, const tpriority priority = tpriority::interactive
+			, const tconflation_key key = 0);
 
 	void
-	send_reply(const uint32_t id__, const std::string& message);
+	send_reply(
+			  const uint32_t id__
+			, const std::string& message
+			, const tpriority priority = tpriority::control);
 
 	/***** ***** Setters, getters. ***** *****/
 
@@ -82,7 +89,11 @@ private:
 
 	boost::asio::posix::stream_descriptor file_;
 
+#ifdef ENABLE_COROUTINE_RECEIVER
+	detail::tcoroutine_receiver_file receiver_;
+#else
 	detail::treceiver_file receiver_;
+#endif
 
 	detail::tsender_file sender_;
 };
@@ -17,13 +17,16 @@
 #include "modules/communication/message.hpp"
 
 #include "lib/exception/validate.tpp"
+#include "lib/string/string_view.tpp"
 #include "modules/logging/log.hpp"
 
 #include <arpa/inet.h>
 
 namespace communication {
 
-tmessage::tmessage(const tprotocol protocol, const std::string& encoded_message)
+tmessage::tmessage(
+		  const tprotocol protocol
+		, const lib::tstring_view& encoded_message)
 	: type_(ttype::reply) /* Notification. */
 	, id_(0)
 	, contents_()
@@ -32,15 +35,19 @@ tmessage::tmessage(const tprotocol protocol, const std::string& encoded_message)
 
 	switch(protocol) {
 		case tprotocol::direct :
-			contents_ = encoded_message;
+			contents_.assign(encoded_message.data(), encoded_message.size());
 			break;
 
 		case tprotocol::line :
-			contents_ = encoded_message.substr(0, encoded_message.size() - 1);
+			contents_.assign(
+					  encoded_message.data()
+					, encoded_message.size() - 1);
 			break;
 
 		case tprotocol::telnet :
-			contents_ = encoded_message.substr(0, encoded_message.size() - 2);
+			contents_.assign(
+					  encoded_message.data()
+					, encoded_message.size() - 2);
 			break;
 
 		case tprotocol::basic :
@@ -70,8 +77,10 @@ tmessage::tmessage(const tprotocol protocol, const std::string& encoded_message)
 								  , encoded_message[0]
 								  , "«"));
 			}
-			id_ = network_buffer_to_host(&encoded_message[1]);
-			contents_ = encoded_message.substr(5);
+			id_ = network_buffer_to_host(encoded_message.data() + 1);
+			contents_.assign(
+					  encoded_message.data() + 5
+					, encoded_message.size() - 5);
 			break;
 
 		case tprotocol::compressed :
@@ -92,45 +101,72 @@ tmessage::tmessage(
 
 std::string
 tmessage::encode(const tprotocol protocol) const
+{
+	std::string result;
+	encode(protocol, result);
+	return result;
+}
+
+/**
+ * Appends an uint32_t in network order to a string.
+ *
+ * @param buffer                  The string to append to.
+ * @param value                   The value to append.
+ */
+static void
+append_network(std::string& buffer, uint32_t value)
+{
+	value = htonl(value);
+	buffer.append(reinterpret_cast<char*>(&value), 4);
+}
+
+void
+tmessage::encode(const tprotocol protocol, std::string& result) const
 {
 	LOG_T(__PRETTY_FUNCTION__, ": protocol »", protocol, "«.\n");
 
-	std::string result;
+	result.clear();
 
 	switch(protocol) {
 		case tprotocol::direct :
 			break;
 
 		case tprotocol::line :
-			result = contents_ + '\n';
+			result.reserve(contents_.size() + 1);
+			result += contents_;
+			result += '\n';
 			break;
 
 		case tprotocol::telnet :
-			result = contents_ + "\r\n";
+			result.reserve(contents_.size() + 2);
+			result += contents_;
+			result += "\r\n";
 			break;
 
 		case tprotocol::basic :
+//			if(data.size() > max - 4) ..
+			result.reserve(contents_.size() + 9);
+			append_network(
+					  result
+					, static_cast<uint32_t>(contents_.size() + 5));
+
 			switch(type_) {
 				case tmessage::ttype::action :
-					result = "A" + host_to_network_string(id_) + contents_;
+					result += 'A';
 					break;
 
 				case tmessage::ttype::reply :
-					result = "R" + host_to_network_string(id_) + contents_;
+					result += 'R';
 					break;
 			}
-//			if(data.size() > max - 4) ..
-			result = host_to_network_string(
-						static_cast<uint32_t>(result.size()))
-					+ result;
+			append_network(result, id_);
+			result += contents_;
 			break;
 
 		case tprotocol::compressed :
 			NOT_IMPLEMENTED_YET;
 			break;
 	}
-
-	return result;
 }
 
 tmessage::ttype
@@ -145,6 +181,12 @@ tmessage::id() const
 	return id_;
 }
 
+void
+tmessage::set_id(const uint32_t id__)
+{
+	id_ = id__;
+}
+
 const std::string&
 tmessage::contents() const
 {
@@ -28,6 +28,12 @@
 
 #include <string>
 
+namespace lib {
+
+class tstring_view;
+
+} // namespace lib
+
 namespace communication {
 
 class tmessage final
@@ -59,7 +65,9 @@ public:
 	 *                               message.
 	 * @param encoded_message        The raw message to decode.
 	 */
-	tmessage(const tprotocol protocol, const std::string& encoded_message);
+	tmessage(
+			  const tprotocol protocol
+			, const lib::tstring_view& encoded_message);
 
 	tmessage(const ttype type__
 			, const uint32_t id__
@@ -92,6 +100,20 @@ public:
 	std::string
 	encode(const tprotocol protocol) const;
 
+	/**
+	 * Encodes the contents of a message.
+	 *
+	 * Unlike @ref encode(const tprotocol) const the encoded message is
+	 * stored in a buffer, so the caller can reuse its memory.
+	 *
+	 * @param protocol               The protocol, which shall be used to
+	 *                               encode the message.
+	 * @param result                 The buffer for the encoded message, its
+	 *                               original contents are replaced.
+	 */
+	void
+	encode(const tprotocol protocol, std::string& result) const;
+
 
 	/***** ***** Setters, getters. ***** *****/
 
@@ -101,6 +123,9 @@ public:
 	uint32_t
 	id() const;
 
+	void
+	set_id(const uint32_t id__);
+
 	const std::string&
 	contents() const;
 
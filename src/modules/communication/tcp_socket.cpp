@@ -22,7 +22,6 @@ ttcp_socket::ttcp_socket(boost::asio::io_service& io_service)
 	: connection_()
 	, socket_(io_service)
 	, acceptor_(connection_, socket_)
-	, connector_(connection_, socket_)
 	, receiver_(connection_, socket_)
 	, sender_(connection_, socket_)
 {
@@ -56,7 +55,7 @@ ttcp_socket::accept(boost::asio::ip::tcp::acceptor& acceptor)
 void
 ttcp_socket::connect(const std::string& hostname, const std::string& service)
 {
-	connector_.connect(hostname, service);
+	connector().connect(hostname, service);
 }
 
 void
@@ -65,23 +64,33 @@ ttcp_socket::receive()
 	receiver_.receive();
 }
 
-uint32_t
-ttcp_socket::send_action(const std::string& message)
+void
+ttcp_socket::send_action(
+		  const std::string& message
+		, const tpriority priority
+		, const tconflation_key key)
 {
-	return sender_.send_action(message);
+	sender_.send_action(message, priority, key);
 }
 
 void
-ttcp_socket::send_reply(const uint32_t id__, const std::string& message)
+ttcp_socket::send_reply(
+		  const uint32_t id__
+		, const std::string& message
+		, const tpriority priority)
 {
-	sender_.send_reply(id__, message);
+	sender_.send_reply(id__, message, priority);
 }
 
 void
 ttcp_socket::close()
 {
-	socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both);
-	socket_.close();
+	/* The peer may already have reset the connection, which is fine. */
+	boost::system::error_code error;
+	socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+	socket_.close(error);
+
+	receiver_.close();
 }
 
 void
@@ -96,6 +105,16 @@ ttcp_socket::get_protocol() const
 	return connection_.get_protocol();
 }
 
+boost::asio::ip::address
+ttcp_socket::get_remote_address() const
+{
+	boost::system::error_code error;
+	const boost::asio::ip::tcp::endpoint endpoint =
+			socket_.remote_endpoint(error);
+
+	return error ? boost::asio::ip::address() : endpoint.address();
+}
+
 void
 ttcp_socket::set_accept_handler(const taccept_handler& handler__)
 {
@@ -105,7 +124,7 @@ ttcp_socket::set_accept_handler(const taccept_handler& handler__)
 void
 ttcp_socket::set_connect_handler(const tconnect_handler& handler__)
 {
-	connector_.set_connect_handler(handler__);
+	connector().set_connect_handler(handler__);
 }
 
 void
@@ -120,5 +139,26 @@ ttcp_socket::set_send_handler(const tsend_handler& handler__)
 	sender_.set_send_handler(handler__);
 }
 
+void
+ttcp_socket::set_throttle_handler(const tthrottle_handler& handler__)
+{
+	receiver_.set_throttle_handler(handler__);
+}
+
+void
+ttcp_socket::set_last_action_id(const uint32_t id)
+{
+	sender_.set_last_action_id(id);
+}
+
+detail::tconnector_tcp_socket&
+ttcp_socket::connector()
+{
+	if(!connector_) {
+		connector_.reset(
+				new detail::tconnector_tcp_socket(connection_, socket_));
+	}
+	return *connector_;
+}
 
 } // namespace communication
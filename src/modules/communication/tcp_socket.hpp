@@ -17,9 +17,12 @@
 
 #include "modules/communication/detail/acceptor.hpp"
 #include "modules/communication/detail/connector.hpp"
+#include "modules/communication/detail/coroutine_receiver.hpp"
 #include "modules/communication/detail/receiver.hpp"
 #include "modules/communication/detail/sender.hpp"
 
+#include <memory>
+
 namespace communication {
 
 class ttcp_socket final
@@ -61,11 +64,17 @@ public:
 	void
 	receive();
 
-	uint32_t
-	send_action(const std::string& message);
+	void
+	send_action(
+			  const std::string& message
+			, const tpriority priority = tpriority::interactive
+			, const tconflation_key key = 0);
 
 	void
-	send_reply(const uint32_t id__, const std::string& message);
+	send_reply(
+			  const uint32_t id__
+			, const std::string& message
+			, const tpriority priority = tpriority::control);
 
 	void
 	close();
@@ -78,6 +87,15 @@ public:
 	tprotocol
 	get_protocol() const;
 
+	/**
+	 * Returns the address of the remote end of the connection.
+	 *
+	 * @returns                   The address, unspecified when the socket is
+	 *                            not connected.
+	 */
+	boost::asio::ip::address
+	get_remote_address() const;
+
 	void
 	set_accept_handler(const taccept_handler& handler__);
 
@@ -90,6 +108,14 @@ public:
 	void
 	set_send_handler(const tsend_handler& handler__);
 
+	/** See @ref detail::treceiver::throttle_handler_. */
+	void
+	set_throttle_handler(const tthrottle_handler& handler__);
+
+	/** See @ref detail::tsender::set_last_action_id(). */
+	void
+	set_last_action_id(const uint32_t id);
+
 private:
 
 	/***** ***** Operators. ***** *****/
@@ -100,11 +126,25 @@ private:
 
 	detail::tacceptor_tcp_socket acceptor_;
 
-	detail::tconnector_tcp_socket connector_;
-
+	/**
+	 * The connector, only used by clients.
+	 *
+	 * Most sockets are the connections accepted by the server, so the
+	 * connector, with its resolver, is only created when needed.
+	 */
+	std::unique_ptr<detail::tconnector_tcp_socket> connector_{};
+
+#ifdef ENABLE_COROUTINE_RECEIVER
+	detail::tcoroutine_receiver_socket receiver_;
+#else
 	detail::treceiver_socket receiver_;
+#endif
 
 	detail::tsender_tcp_socket sender_;
+
+	/** Returns the @ref connector_, creates it if needed. */
+	detail::tconnector_tcp_socket&
+	connector();
 };
 
 } // namespace communication
@@ -22,6 +22,8 @@
 
 #include <boost/system/error_code.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 
 namespace communication {
@@ -52,6 +54,33 @@ enum class tprotocol
 	, compressed
 };
 
+/**
+ * The priority of a message to send.
+ *
+ * The sender sends the queued messages of a higher priority first, the
+ * messages of the same priority are sent in order.
+ */
+enum class tpriority
+{
+	/** Replies to commands. */
+	  control
+
+	/** Messages the user waits for, the default. */
+	, interactive
+
+	/** Messages which may wait, e.g. game updates. */
+	, bulk
+};
+
+/**
+ * The conflation key of a message to send.
+ *
+ * A queued message replaces an older unsent message with the same key, so
+ * only the newest value is sent. The key @c 0 means the message is not
+ * conflated.
+ */
+typedef uint32_t tconflation_key;
+
 /**
  * The signature for a handler called after accepting a connection.
  *
@@ -101,6 +130,22 @@ typedef std::function<void(
 		)>
 		treceive_handler;
 
+/**
+ * The signature for a handler throttling the receiving of messages.
+ *
+ * The handler is called after a message is received, before receiving the
+ * next message.
+ *
+ * @param bytes_transferred       The number of bytes received.
+ *
+ * @returns                       The time to pause receiving, when zero the
+ *                                next message is received directly.
+ */
+typedef std::function<std::chrono::nanoseconds(
+			  const size_t bytes_transferred
+		)>
+		tthrottle_handler;
+
 } // namespace communication
 
 #include "lib/string/enumerate.tpp"
@@ -19,34 +19,230 @@
 #include "lib/exception/validate.tpp"
 #include "lib/string/concatenate.tpp"
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
 
 namespace game {
 
-tgame::tgame(lobby::tsession& session, const std::string& id__)
+tgame::tgame(
+		  boost::asio::io_service& io_service
+		, lobby::tsession& session
+		, const std::string& id__
+		, const unsigned tick_interval__
+		, tjournal* journal__)
 	: id_(id__)
+	, strand_(io_service)
+	, tick_interval_(tick_interval__)
+	, tick_timer_(io_service)
+	, journal_(journal__)
 {
+	add_commands();
+
 	/**
 	 * @todo @c emplace() doesn't seem to exist. Once there also look
 	 * whether the player can drop its move capabilities.
 	 */
 	players_.insert(std::make_pair(
-			  &session
+			  session.get_id()
 			, detail::tplayer(session.get_id(), detail::tplayer::trole::gm)));
 
+	session.acquire();
+	sessions_.insert(std::make_pair(&session, session.get_id()));
+
+	snapshot();
+
 	session.set_mode(lobby::tsession::tmode::creating_game);
+	session.set_game(id_);
 
 	session.send(lib::concatenate("OK\nCreated game '", id__, "'.\n"));
+}
 
-	/**
-	 * @todo We reset the receive_handler but never restore the original
-	 * handler.
-	 */
-	session.set_receive_handler(std::bind(
-			  &tgame::receive_handler
-			, this
-			, std::ref(session)
-			, std::placeholders::_1
-			, std::placeholders::_3));
+tgame::tgame(
+		  boost::asio::io_service& io_service
+		, const std::string& id__
+		, const unsigned tick_interval__
+		, tjournal* journal__
+		, const std::vector<tjournal::trecord>& records)
+	: id_(id__)
+	, strand_(io_service)
+	, tick_interval_(tick_interval__)
+	, tick_timer_(io_service)
+	, journal_(journal__)
+{
+	LOG_T(__PRETTY_FUNCTION__
+			, ": id »", id__
+			, "« records »", records.size()
+			, "«.\n");
+
+	add_commands();
+
+	for(const tjournal::trecord& record : records) {
+		if(record.size() >= 2 && record[0] == "snapshot") {
+			players_.clear();
+			for(size_t i = 2; i + 1 < record.size(); i += 2) {
+				detail::tplayer::trole role;
+				record[i + 1] >> role;
+				players_.insert(std::make_pair(
+						  record[i]
+						, detail::tplayer(record[i], role)));
+			}
+			journal_records_ = 0;
+
+		} else if(record.size() == 2 && record[0] == "join") {
+			add_player(record[1]);
+			++journal_records_;
+
+		} else if(record.size() == 3 && record[0] == "command") {
+			if(!apply(record[1], record[2])) {
+				LOG_W("Game »"
+						, id_
+						, "« ignores invalid journal command »"
+						, record[2]
+						, "«.\n");
+			}
+			++journal_records_;
+
+		} else {
+			LOG_W("Game »", id_, "« ignores an invalid journal record.\n");
+		}
+	}
+}
+
+tgame::~tgame()
+{
+	tick_timer_.cancel();
+
+	for(const auto& session : sessions_) {
+		session.first->release();
+	}
+
+	for(const tcommand& command : mailbox_) {
+		command.session->release();
+	}
+}
+
+void
+tgame::start()
+{
+	/* The creator of the game, the handler needs a shared_ptr to the game. */
+	for(const auto& session : sessions_) {
+		set_receive_handler(*session.first);
+	}
+
+	strand_.post(std::bind(&tgame::start_tick, shared_from_this()));
+}
+
+void
+tgame::broadcast(const std::string& update)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": update »", update, "«.\n");
+
+	updates_.emplace_back(
+			  update.data()
+			, update.size()
+			, lib::tallocator<char>(lib::thread_pool_resource()));
+}
+
+void
+tgame::join(lobby::tsession& session)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": player »", session.get_id(), "«.\n");
+
+	set_receive_handler(session);
+
+	session.set_mode(lobby::tsession::tmode::playing_game);
+	session.set_game(id_);
+
+	/* The reference is owned by the sessions_ once added. */
+	session.acquire();
+
+	auto self = shared_from_this();
+	strand_.post([this, self, &session]()
+		{
+			const std::string player = session.get_id();
+			if(add_player(player)) {
+				journal(tjournal::trecord{"join", player});
+			}
+
+			if(!sessions_.insert(std::make_pair(&session, player)).second) {
+				session.release();
+			}
+			last_activity_ = std::chrono::steady_clock::now();
+
+			session.send(lib::concatenate("OK\nJoined game '", id_, "'.\n"));
+
+			broadcast(lib::concatenate("player joined ", player, '\n'));
+			if(tick_interval_ == 0) {
+				send_updates();
+			}
+		});
+}
+
+void
+tgame::evict(const unsigned idle_time, const tevict_handler& handler)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": idle_time »", idle_time, "«.\n");
+
+	auto self = shared_from_this();
+	strand_.post([this, self, idle_time, handler]()
+		{
+			bool idle;
+			{
+				std::lock_guard<std::mutex> lock(mailbox_mutex_);
+				idle = mailbox_.empty();
+			}
+
+			const bool evicted = journal_
+					&& idle
+					&& sessions_.empty()
+					&& std::chrono::steady_clock::now() - last_activity_
+						>= std::chrono::seconds(idle_time);
+
+			if(evicted) {
+				LOG_D("Evict game »", id_, "«.\n");
+
+				tick_interval_ = 0;
+				tick_timer_.cancel();
+				updates_.clear();
+				snapshot();
+			}
+
+			handler(evicted);
+		});
+}
+
+tjournal::trecord
+tgame::serialize() const
+{
+	tjournal::trecord result{"snapshot", id_};
+	for(const auto& player : players_) {
+		std::string role;
+		role << player.second.get_role();
+
+		result.push_back(player.first);
+		result.push_back(role);
+	}
+	return result;
+}
+
+void
+tgame::serialize(trecord_writer& writer) const
+{
+	size_t size = trecord_writer::field_size("snapshot")
+			+ trecord_writer::field_size(id_);
+
+	for(const auto& player : players_) {
+		size += trecord_writer::field_size(player.first)
+				+ trecord_writer::field_size(
+					enum_to_string(player.second.get_role()));
+	}
+
+	writer.begin(size);
+	writer.field("snapshot");
+	writer.field(id_);
+	for(const auto& player : players_) {
+		writer.field(player.first);
+		writer.field(enum_to_string(player.second.get_role()));
+	}
 }
 
 const std::string&
@@ -55,6 +251,23 @@ tgame::id() const
 	return id_;
 }
 
+void
+tgame::set_tick_interval(const unsigned tick_interval__)
+{
+	LOG_T(__PRETTY_FUNCTION__
+			, ": tick_interval »", tick_interval__
+			, "«.\n");
+
+	auto self = shared_from_this();
+	strand_.post([this, self, tick_interval__]()
+		{
+			tick_interval_ = tick_interval__;
+			tick_timer_.cancel();
+			send_updates();
+			start_tick();
+		});
+}
+
 void
 tgame::receive_handler(
 		  lobby::tsession& session
@@ -66,39 +279,334 @@ tgame::receive_handler(
 			, "«.\n");
 
 	if(error) {
+		session.acquire();
+		strand_.post(std::bind(&tgame::leave, shared_from_this(), &session));
 		return;
 	}
 
 	VALIDATE(message);
 
-	switch(session.get_mode()) {
-		case lobby::tsession::tmode::connected :
-			/* FALL DOWN */
+	const std::string& contents = message->contents();
+	tcommand command{&session, lib::tstring(
+			  contents.data()
+			, contents.size()
+			, lib::tallocator<char>(lib::thread_pool_resource()))};
 
-		case lobby::tsession::tmode::lobby :
-			/*FAIL*/; throw 0;
+	session.acquire();
 
-		case lobby::tsession::tmode::creating_game :
-			execute_creating_game(session, message->contents());
+	bool idle;
+	{
+		std::lock_guard<std::mutex> lock(mailbox_mutex_);
+		idle = mailbox_.empty();
+		mailbox_.push_back(std::move(command));
 	}
+
+	if(idle) {
+		strand_.post(std::bind(&tgame::execute_mailbox, shared_from_this()));
+	}
+}
+
+void
+tgame::set_receive_handler(lobby::tsession& session)
+{
+	/**
+	 * @todo We reset the receive_handler but never restore the original
+	 * handler.
+	 */
+
+	/*
+	 * The session's handler only holds a weak reference, else the session
+	 * would keep an evicted game alive. The handler shares the ownership
+	 * while it posts work to the game.
+	 */
+	std::weak_ptr<tgame> game = shared_from_this();
+	session.set_receive_handler([game, &session](
+				  const boost::system::error_code& error
+				, const size_t
+				, const communication::tmessage* message)
+			{
+				if(std::shared_ptr<tgame> self = game.lock()) {
+					self->receive_handler(session, error, message);
+				}
+			});
 }
 
 void
-tgame::execute_creating_game(lobby::tsession& session, std::string command)
+tgame::leave(lobby::tsession* session)
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	/* Releases the reference of the caller and of the sessions_. */
+	session->release();
+
+	auto itor = sessions_.find(session);
+	if(itor == sessions_.end()) {
+		return;
+	}
+
+	broadcast(lib::concatenate("player disconnected ", itor->second, '\n'));
+	sessions_.erase(itor);
+	session->release();
+	last_activity_ = std::chrono::steady_clock::now();
+
+	if(tick_interval_ == 0) {
+		send_updates();
+	}
+}
+
+void
+tgame::execute_mailbox()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	std::vector<tcommand> commands;
+	{
+		std::lock_guard<std::mutex> lock(mailbox_mutex_);
+		std::swap(commands, mailbox_);
+	}
+
+	LOG_D("Execute a batch of »", commands.size(), "« commands.\n");
+
+	for(const tcommand& command : commands) {
+		/* The session may have left after queueing the command. */
+		if(sessions_.count(command.session) != 0) {
+			logging::recorder::record(
+					  logging::recorder::tevent::command_dispatched
+					, command.session
+					, static_cast<uint64_t>(command.session->get_mode()));
+
+			const auto start = std::chrono::steady_clock::now();
+
+			execute(*command.session, lib::tstring_view(
+					  command.command.data()
+					, command.command.size()));
+
+			logging::recorder::record(
+					  logging::recorder::tevent::handler_duration
+					, command.session
+					, std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count());
+		}
+
+		command.session->release();
+	}
+
+	last_activity_ = std::chrono::steady_clock::now();
+
+	if(tick_interval_ == 0) {
+		send_updates();
+	}
+}
+
+void
+tgame::add_commands()
+{
+	typedef lobby::tsession::tmode tmode;
+
+	dispatcher_.add("help", 1, {tmode::creating_game, tmode::playing_game}
+			, [](lobby::tsession& session, const lobby::targuments&)
+				-> lib::tresult
+			{
+				session.send("OK\nStill no help available.\n");
+				return lib::tresult();
+			});
+
+	/* Applied commands are acknowledged once durable, not in a batch. */
+	dispatcher_.set_fallback({tmode::creating_game, tmode::playing_game}
+			, std::bind(
+				  &tgame::execute_apply
+				, this
+				, std::placeholders::_1
+				, std::placeholders::_2)
+			, lobby::tdispatcher::tbatch::forbidden);
+}
+
+void
+tgame::execute(lobby::tsession& session, const lib::tstring_view& command)
 {
 	LOG_D("Execute »", command, "«.\n");
 
 	try {
-		if(command.empty()) {
-			/* Do nothing. */
-		} else if(command == "help") {
-			session.send("OK\nStill no help available.\n");
-		} else {
-			session.send("EINVAL\nUnknown command.\n");
+		const lib::tresult result = dispatcher_.dispatch(session, command);
+		if(!result) {
+			session.reply(result);
 		}
 	} catch(...) {
 		session.send("ERROR\n");
 	}
 }
 
+lib::tresult
+tgame::execute_apply(
+		  lobby::tsession& session
+		, const lobby::targuments& arguments)
+{
+	if(arguments.size() != 1) {
+		return lib::tresult(
+				  lib::texception::ttype::invalid_value
+				, "Invalid arguments");
+	}
+
+	const std::string contents = arguments[0].str();
+	const std::string& player = sessions_.at(&session);
+
+	const lib::tresult result = apply(player, contents);
+	if(!result) {
+		return result;
+	}
+
+	/*
+	 * Acknowledge the command once it's durable. The handler is called in
+	 * the journal's thread, the session is only used in the game's strand,
+	 * where it's known whether the session is still in the game.
+	 */
+	auto self = shared_from_this();
+	lobby::tsession* target = &session;
+	target->acquire();
+	journal(tjournal::trecord{"command", player, contents}
+			, [this, self, target](const bool durable)
+			{
+				strand_.post([this, self, target, durable]()
+					{
+						if(sessions_.count(target) == 0) {
+							/* Nothing to do. */
+						} else if(durable) {
+							target->send("OK\n");
+						} else {
+							target->reply(lib::tresult(
+									  lib::texception::ttype::no_access
+									, "Failed to store the command"));
+						}
+						target->release();
+					});
+			});
+
+	return result;
+}
+
+lib::tresult
+tgame::apply(const std::string& /*player*/, const std::string& command)
+{
+	/*
+	 * No commands change the state of the game yet, so the journal only
+	 * contains join and snapshot records.
+	 */
+	return lib::tresult(
+			  lib::texception::ttype::invalid_value
+			, "Unknown command"
+			, command);
+}
+
+bool
+tgame::add_player(const std::string& player)
+{
+	if(players_.count(player) != 0) {
+		return false;
+	}
+
+	players_.insert(std::make_pair(
+			  player
+			, detail::tplayer(player, detail::tplayer::trole::player)));
+
+	return true;
+}
+
+void
+tgame::journal(
+		  const tjournal::trecord& record
+		, const tjournal::tcommit_handler& handler)
+{
+	if(!journal_) {
+		if(handler) {
+			handler(true);
+		}
+		return;
+	}
+
+	journal_->append(id_, record, handler);
+
+	if(++journal_records_ >= journal_->get_snapshot_interval()) {
+		snapshot();
+	}
+}
+
+void
+tgame::snapshot()
+{
+	if(!journal_) {
+		return;
+	}
+
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	journal_->snapshot(id_, serialize());
+	journal_records_ = 0;
+}
+
+void
+tgame::send_updates()
+{
+	if(updates_.empty()) {
+		return;
+	}
+
+	LOG_T(__PRETTY_FUNCTION__, ": updates »", updates_.size(), "«.\n");
+
+	size_t size = 0;
+	for(const lib::tstring& update : updates_) {
+		size += update.size();
+	}
+
+	std::string message;
+	message.reserve(size);
+	for(const lib::tstring& update : updates_) {
+		message.append(update.data(), update.size());
+	}
+	updates_.clear();
+
+	for(auto& session : sessions_) {
+		session.first->send(message, communication::tpriority::bulk);
+	}
+}
+
+void
+tgame::start_tick()
+{
+	if(tick_interval_ == 0) {
+		return;
+	}
+
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	tick_timer_.expires_from_now(
+			boost::posix_time::milliseconds(tick_interval_));
+
+	tick_timer_.async_wait(strand_.wrap(std::bind(
+			  &tgame::tick_handler
+			, shared_from_this()
+			, std::placeholders::_1)));
+}
+
+void
+tgame::tick_handler(const boost::system::error_code& error)
+{
+	if(error == boost::asio::error::operation_aborted || tick_interval_ == 0) {
+		return;
+	}
+
+	send_updates();
+
+	/*
+	 * Use the previous expiry time instead of now, so the rate of the tick
+	 * doesn't drift with the time needed to send the updates.
+	 */
+	tick_timer_.expires_at(tick_timer_.expires_at()
+			+ boost::posix_time::milliseconds(tick_interval_));
+
+	tick_timer_.async_wait(strand_.wrap(std::bind(
+			  &tgame::tick_handler
+			, shared_from_this()
+			, std::placeholders::_1)));
+}
+
 } // namespace game
@@ -15,30 +15,204 @@
 #ifndef MODULES_GAME_GAME_HPP_INCLUDED
 #define MODULES_GAME_GAME_HPP_INCLUDED
 
+#include "lib/exception/result.hpp"
+#include "lib/memory/memory_resource.hpp"
 #include "modules/game/detail/player.hpp"
+#include "modules/game/journal.hpp"
+#include "modules/game/record_writer.hpp"
+#include "modules/lobby/dispatcher.hpp"
 #include "modules/lobby/session.hpp"
 
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace game {
 
+/**
+ * A game on the server.
+ *
+ * Every game is an actor. The commands of its players are queued in the
+ * mailbox of the game and executed in the game's own strand. This means the
+ * state of a game needs no locking and a busy game doesn't stall the other
+ * games. The commands are executed in batches, one batch contains all
+ * commands queued since the previous batch started.
+ *
+ * State changes are sent to the players with @ref broadcast(). These updates
+ * are not sent directly, but collected and every player receives all updates
+ * in a single message. Without a tick the updates are sent after every
+ * batch. A game can opt into a fixed-rate tick, see @ref tick_interval_, then
+ * the updates are sent once every tick. This bounds the number of messages
+ * sent by a game, regardless of the number of commands it executes.
+ *
+ * Games can outlive their players, when a @ref tjournal is used the state of
+ * the game is stored on disk. Every command changing the state of the game
+ * is executed by @ref apply() and appended to the journal, after
+ * @ref tjournal::get_snapshot_interval() commands a snapshot is written.
+ *
+ * A stored game without connected players can be evicted from memory, see
+ * @ref evict(). The lobby loads the game from the journal again when a player
+ * joins the game. Since the handlers of the game can outlive the lobby's
+ * reference to an evicted game, the game is owned by a @c std::shared_ptr.
+ */
 class tgame final
+	: public std::enable_shared_from_this<tgame>
 {
 public:
 
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The signature for a handler called after trying to evict a game.
+	 *
+	 * @param evicted             Whether the game is evicted.
+	 */
+	typedef std::function<void(
+				  const bool evicted
+			)>
+			tevict_handler;
+
+
 	/***** ***** Constructor, destructor, assignment. ***** *****/
 
-	tgame(lobby::tsession& session, const std::string& id__);
+	/**
+	 * Constructor.
+	 *
+	 * @pre                       lifetime(session) > lifetime(*this)
+	 *
+	 * @param io_service          The io_service to run the game's strand
+	 *                            and tick timer in.
+	 * @param session             The session creating the game, this
+	 *                            session becomes the GM of the game.
+	 * @param id__                The id of the game.
+	 * @param tick_interval__     The initial value of @ref tick_interval_.
+	 * @param journal__           The value of @ref journal_.
+	 */
+	tgame(boost::asio::io_service& io_service
+			, lobby::tsession& session
+			, const std::string& id__
+			, const unsigned tick_interval__
+			, tjournal* journal__);
+
+	/**
+	 * Constructor.
+	 *
+	 * Recovers a game from its journal.
+	 *
+	 * @param io_service          The io_service to run the game's strand
+	 *                            and tick timer in.
+	 * @param id__                The id of the game.
+	 * @param tick_interval__     The initial value of @ref tick_interval_.
+	 * @param journal__           The value of @ref journal_.
+	 * @param records             The records of the game as returned by
+	 *                            @ref tjournal::load().
+	 */
+	tgame(boost::asio::io_service& io_service
+			, const std::string& id__
+			, const unsigned tick_interval__
+			, tjournal* journal__
+			, const std::vector<tjournal::trecord>& records);
 
-	~tgame() = default;
+	~tgame();
 
 	tgame&
 	operator=(const tgame&) = delete;
 	tgame(const tgame&) = delete;
 
 	tgame&
-	operator=(tgame&&) = default;
-	tgame(tgame&&) = default;
+	operator=(tgame&&) = delete;
+	tgame(tgame&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Starts the game.
+	 *
+	 * Starts the tick and sets the receive handler of the creator of the
+	 * game, this is not done in the constructor since these handlers share
+	 * the ownership of the game.
+	 *
+	 * @pre                       The game is owned by a @c std::shared_ptr.
+	 */
+	void
+	start();
+
+	/**
+	 * Queues a state update for all players.
+	 *
+	 * The update is sent after the current batch or tick, together with the
+	 * other updates queued in the same batch or tick.
+	 *
+	 * @pre                       The function is called in the game's
+	 *                            strand.
+	 *
+	 * @param update              The update to send.
+	 */
+	void
+	broadcast(const std::string& update);
+
+	/**
+	 * Lets a session join the game.
+	 *
+	 * A player who already is in the game keeps its role, else the session
+	 * joins as a new player. The session's receive handler is set directly,
+	 * the join itself is executed in the game's strand.
+	 *
+	 * @pre                       lifetime(session) > lifetime(*this)
+	 *
+	 * @param session             The session joining the game.
+	 */
+	void
+	join(lobby::tsession& session);
+
+	/**
+	 * Tries to evict the game.
+	 *
+	 * A game can be evicted when it is stored in a journal, has no connected
+	 * players and has been idle for at least @p idle_time. An evicted game
+	 * writes a snapshot and stops its tick, after which the owner can drop
+	 * its reference to the game.
+	 *
+	 * @param idle_time           The minimum idle time in seconds.
+	 * @param handler             The handler to call with the result, the
+	 *                            handler is called in the game's strand.
+	 */
+	void
+	evict(const unsigned idle_time, const tevict_handler& handler);
+
+
+	/**
+	 * Serialises the state of the game.
+	 *
+	 * @pre                       The game's strand is not executing, e.g.
+	 *                            the io_service is quiesced.
+	 *
+	 * @returns                   The state as a snapshot record for the
+	 *                            @ref tjournal.
+	 */
+	tjournal::trecord
+	serialize() const;
+
+	/**
+	 * Writes the state of the game as a snapshot record.
+	 *
+	 * Writes the same record as @ref serialize() const, but doesn't
+	 * allocate memory, so it can be used in the child of a fork.
+	 *
+	 * @pre                       The game's strand is not executing, e.g.
+	 *                            the io_service is quiesced.
+	 *
+	 * @param writer              The writer to write the record with.
+	 */
+	void
+	serialize(trecord_writer& writer) const;
 
 
 	/***** ***** Setters, getters. ***** *****/
@@ -46,20 +220,117 @@ public:
 	const std::string&
 	id() const;
 
+	/**
+	 * Sets the tick interval.
+	 *
+	 * The new interval is applied in the game's strand, so the function can
+	 * be called from any thread.
+	 *
+	 * @param tick_interval__     The new value of @ref tick_interval_.
+	 */
+	void
+	set_tick_interval(const unsigned tick_interval__);
+
 private:
 
+	/***** ***** Types. ***** *****/
+
+	/** A command queued in the @ref mailbox_. */
+	struct tcommand
+	{
+		/** The session which sent the command. */
+		lobby::tsession* session;
+
+		/**
+		 * The command to execute.
+		 *
+		 * The command is allocated in the io thread of the session and
+		 * released in the thread executing the game, the pools of the
+		 * threads avoid the global allocator for both.
+		 */
+		lib::tstring command;
+	};
+
+
 	/***** ***** Members. ***** *****/
 
 	/** The id of the game. */
 	std::string id_;
 
-	/*
+	/**
 	 * Players and GM.
 	 *
-	 * Pointers are owned by the lobby.
+	 * The key is the name of the player. This list also contains the
+	 * players which are not connected.
 	 */
-	std::map<lobby::tsession*, detail::tplayer> players_{};
+	std::map<std::string, detail::tplayer> players_{};
 
+	/**
+	 * The sessions of the connected players.
+	 *
+	 * Pointers are owned by the lobby, the game holds a reference to them,
+	 * see @ref lobby::tsession::acquire(). The value is the name of the
+	 * player.
+	 */
+	std::map<lobby::tsession*, std::string> sessions_{};
+
+	/**
+	 * The strand to serialise the execution of the game.
+	 *
+	 * All game state is only accessed in this strand.
+	 */
+	boost::asio::io_service::strand strand_;
+
+	/** The dispatcher for the commands of the players. */
+	lobby::tdispatcher dispatcher_{};
+
+	/** Protects the @ref mailbox_. */
+	std::mutex mailbox_mutex_{};
+
+	/**
+	 * The commands waiting to be executed.
+	 *
+	 * The commands are added by the receive handlers of the players and
+	 * removed by @ref execute_mailbox(). Every command holds a reference
+	 * to its session.
+	 */
+	std::vector<tcommand> mailbox_{};
+
+	/** The updates queued by @ref broadcast(), not yet sent. */
+	std::vector<lib::tstring> updates_{};
+
+	/**
+	 * The interval between two ticks.
+	 *
+	 * The interval is in milliseconds. When @c 0 the game has no tick.
+	 */
+	unsigned tick_interval_;
+
+	/** The timer used to implement the tick. */
+	boost::asio::deadline_timer tick_timer_;
+
+	/**
+	 * The journal to store the game in.
+	 *
+	 * When @c nullptr the game is not stored.
+	 */
+	tjournal* journal_;
+
+	/** The number of records appended to the journal since the snapshot. */
+	unsigned journal_records_{0};
+
+	/** The time the last command or join was executed. */
+	std::chrono::steady_clock::time_point last_activity_{
+			std::chrono::steady_clock::now()};
+
+	/**
+	 * The receive handler for the players.
+	 *
+	 * This handler is executed in the session's context, it only queues the
+	 * command in the @ref mailbox_. When the mailbox was empty it also
+	 * schedules @ref execute_mailbox(). When the session is disconnected it
+	 * schedules @ref leave().
+	 */
 	void
 	receive_handler(
 			  lobby::tsession& session
@@ -67,13 +338,117 @@ private:
 			, const communication::tmessage* message);
 
 	/**
-	 * Execution handler when in the @ref creating_game mode.
+	 * Sets the @ref receive_handler() as receive handler of a session.
+	 *
+	 * @pre                       The game is owned by a @c std::shared_ptr.
+	 *
+	 * @param session             The session to set the handler for.
+	 */
+	void
+	set_receive_handler(lobby::tsession& session);
+
+	/**
+	 * Removes a disconnected session from the game.
+	 *
+	 * The player stays in the game.
+	 *
+	 * @param session             The session disconnected, the caller's
+	 *                            reference is released.
+	 */
+	void
+	leave(lobby::tsession* session);
+
+	/** Executes all commands in the @ref mailbox_. */
+	void
+	execute_mailbox();
+
+	/** Adds the commands of the game to the @ref dispatcher_. */
+	void
+	add_commands();
+
+	/**
+	 * Executes a command.
 	 *
 	 * @param session             The session sending the command.
 	 * @param command             The command to be executed.
 	 */
 	void
-	execute_creating_game(lobby::tsession& session, std::string command);
+	execute(lobby::tsession& session, const lib::tstring_view& command);
+
+	/**
+	 * Executes a command changing the state of the game.
+	 *
+	 * The fallback of the @ref dispatcher_, applies the command and appends
+	 * it to the journal. The command is acknowledged once the journal has
+	 * committed it.
+	 *
+	 * @param session             The session sending the command.
+	 * @param arguments           The command to be executed, as its only
+	 *                            argument.
+	 *
+	 * @returns                   The result of @ref apply().
+	 */
+	lib::tresult
+	execute_apply(
+			  lobby::tsession& session
+			, const lobby::targuments& arguments);
+
+	/**
+	 * Applies a command changing the state of the game.
+	 *
+	 * This function is used both for executing commands and for replaying
+	 * the journal, so it shall not send replies to the player.
+	 *
+	 * @param player              The name of the player executing the
+	 *                            command.
+	 * @param command             The command to be applied.
+	 *
+	 * @returns                   The result, fails when the command is not
+	 *                            a valid command.
+	 */
+	lib::tresult
+	apply(const std::string& player, const std::string& command);
+
+	/**
+	 * Adds a player to the game.
+	 *
+	 * Like @ref apply() this function is also used for replaying the
+	 * journal.
+	 *
+	 * @param player              The name of the player.
+	 *
+	 * @returns                   Whether the player is new.
+	 */
+	bool
+	add_player(const std::string& player);
+
+	/**
+	 * Appends a record to the @ref journal_.
+	 *
+	 * @param record              The record of the state change applied.
+	 * @param handler             The handler to call after the record is
+	 *                            committed, called directly when the game
+	 *                            has no journal.
+	 */
+	void
+	journal(const tjournal::trecord& record
+			, const tjournal::tcommit_handler& handler = nullptr);
+
+	/** Writes a snapshot of the game to the @ref journal_. */
+	void
+	snapshot();
+
+	/** Sends the queued @ref updates_ to all players. */
+	void
+	send_updates();
+
+	/** Starts the tick, if @ref tick_interval_ is not @c 0. */
+	void
+	start_tick();
+
+	/** The handler functor for the @ref tick_timer_. */
+	void
+	tick_handler(const boost::system::error_code& error);
 };
 
 } // namespace game
@@ -0,0 +1,583 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "game"
+
+#include "modules/game/journal.hpp"
+
+#include "lib/exception/validate.tpp"
+#include "modules/logging/log.hpp"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace game {
+
+/** The extension of a journal file. */
+static const std::string extension = ".journal";
+
+static void
+encode_length(std::string& result, const size_t length)
+{
+	const uint32_t value = htonl(static_cast<uint32_t>(length));
+	result.append(reinterpret_cast<const char*>(&value), 4);
+}
+
+static bool
+decode_length(
+		  const std::string& data
+		, size_t& offset
+		, const size_t end
+		, size_t& length)
+{
+	if(end - offset < 4) {
+		return false;
+	}
+
+	uint32_t value;
+	std::memcpy(&value, &data[offset], 4);
+	offset += 4;
+	length = ntohl(value);
+	return true;
+}
+
+static int
+decode_digit(const char c)
+{
+	if(c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if(c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+static bool
+write_all(const int fd, const std::string& data)
+{
+	size_t offset = 0;
+	while(offset != data.size()) {
+		const ssize_t written =
+				::write(fd, &data[offset], data.size() - offset);
+
+		if(written < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		offset += static_cast<size_t>(written);
+	}
+	return true;
+}
+
+tjournal::tjournal(
+		  const std::string& directory__
+		, const unsigned snapshot_interval__)
+	: directory_(directory__)
+	, snapshot_interval_(snapshot_interval__)
+	, thread_(&tjournal::run, this)
+{
+}
+
+tjournal::~tjournal()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	condition_.notify_one();
+	thread_.join();
+
+	for(const auto& file : files_) {
+		::close(file.second);
+	}
+}
+
+void
+tjournal::append(
+		  const std::string& game
+		, const trecord& record
+		, const tcommit_handler& handler)
+{
+	queue(trequest{
+			  trequest::ttype::append
+			, game
+			, encode(record)
+			, nullptr
+			, handler});
+}
+
+void
+tjournal::snapshot(const std::string& game, const trecord& record)
+{
+	queue(trequest{
+			  trequest::ttype::snapshot
+			, game
+			, encode(record)
+			, nullptr
+			, nullptr});
+}
+
+std::vector<std::string>
+tjournal::games() const
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	std::vector<std::string> result;
+
+	DIR* directory = ::opendir(directory_.c_str());
+	if(!directory) {
+		throw lib::texception(
+				  lib::texception::ttype::no_access
+				, lib::concatenate(
+					  "Failed to open the journal directory »"
+					, directory_
+					, "« message »"
+					, std::strerror(errno)
+					, "«"));
+	}
+
+	while(const dirent* entry = ::readdir(directory)) {
+		const std::string name = entry->d_name;
+		if(name.size() <= extension.size()
+				|| name.compare(
+					  name.size() - extension.size()
+					, extension.size()
+					, extension) != 0) {
+
+			continue;
+		}
+
+		std::string game;
+		if(!decode_filename(
+				  name.substr(0, name.size() - extension.size())
+				, game)) {
+
+			LOG_W("Ignoring journal file »", name, "«.\n");
+			continue;
+		}
+
+		result.push_back(game);
+	}
+
+	::closedir(directory);
+
+	return result;
+}
+
+void
+tjournal::load(const std::string& game, const tload_handler& handler)
+{
+	queue(trequest{
+			  trequest::ttype::load
+			, game
+			, std::string()
+			, handler
+			, nullptr});
+}
+
+std::string
+tjournal::encode(const trecord& record)
+{
+	std::string payload;
+	for(const std::string& field : record) {
+		encode_length(payload, field.size());
+		payload += field;
+	}
+
+	std::string result;
+	encode_length(result, payload.size());
+	result += payload;
+	return result;
+}
+
+size_t
+tjournal::decode(const std::string& data, std::vector<trecord>& records)
+{
+	size_t offset = 0;
+	while(offset != data.size()) {
+		const size_t begin = offset;
+
+		size_t length;
+		if(!decode_length(data, offset, data.size(), length)
+				|| data.size() - offset < length) {
+
+			return begin;
+		}
+
+		const size_t end = offset + length;
+		trecord record;
+		while(offset != end) {
+			size_t size;
+			if(!decode_length(data, offset, end, size) || end - offset < size) {
+				return begin;
+			}
+			record.push_back(data.substr(offset, size));
+			offset += size;
+		}
+		records.push_back(std::move(record));
+	}
+
+	return offset;
+}
+
+std::string
+tjournal::encode_filename(const std::string& game)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	std::string result;
+	for(const unsigned char c : game) {
+		result += digits[c >> 4];
+		result += digits[c & 0x0f];
+	}
+	return result;
+}
+
+bool
+tjournal::decode_filename(const std::string& filename, std::string& game)
+{
+	if(filename.size() % 2 != 0) {
+		return false;
+	}
+
+	game.clear();
+	for(size_t i = 0; i < filename.size(); i += 2) {
+		const int high = decode_digit(filename[i]);
+		const int low = decode_digit(filename[i + 1]);
+		if(high == -1 || low == -1) {
+			return false;
+		}
+		game += static_cast<char>(high << 4 | low);
+	}
+	return true;
+}
+
+unsigned
+tjournal::get_snapshot_interval() const
+{
+	return snapshot_interval_;
+}
+
+void
+tjournal::queue(trequest&& request)
+{
+	bool idle;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		idle = requests_.empty();
+		requests_.push_back(std::move(request));
+	}
+
+	if(idle) {
+		condition_.notify_one();
+	}
+}
+
+void
+tjournal::run()
+{
+	while(true) {
+		std::vector<trequest> requests;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]()
+				{
+					return stop_ || !requests_.empty();
+				});
+
+			if(requests_.empty()) {
+				return;
+			}
+			std::swap(requests, requests_);
+		}
+
+		commit(requests);
+	}
+}
+
+void
+tjournal::commit(const std::vector<trequest>& requests)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	/*
+	 * The appends to the same game are gathered so they can be written with
+	 * a single write. A snapshot contains the effects of all records before
+	 * it, so these records can be discarded. Their handlers are called once
+	 * the snapshot is durable.
+	 */
+	std::map<std::string, tappend> appends;
+	size_t records = 0;
+	size_t bytes = 0;
+	for(const trequest& request : requests) {
+		switch(request.type) {
+			case trequest::ttype::append : {
+				++records;
+				bytes += request.data.size();
+				tappend& append = appends[request.game];
+				append.data += request.data;
+				if(request.commit_handler) {
+					append.handlers.push_back(request.commit_handler);
+				}
+				break;
+			}
+
+			case trequest::ttype::snapshot : {
+				++records;
+				bytes += request.data.size();
+				std::vector<tcommit_handler> handlers;
+				auto itor = appends.find(request.game);
+				if(itor != appends.end()) {
+					std::swap(handlers, itor->second.handlers);
+					appends.erase(itor);
+				}
+				const bool durable = replace(request.game, request.data);
+				for(const tcommit_handler& handler : handlers) {
+					handler(durable);
+				}
+				break;
+			}
+
+			case trequest::ttype::load :
+				/* The load needs to see the records queued before it. */
+				if(appends.count(request.game) != 0) {
+					write(appends);
+					appends.clear();
+				}
+				request.handler(read(request.game));
+				break;
+		}
+	}
+
+	write(appends);
+
+	LOG_D("Committed a group of »"
+			, records
+			, "« records, »"
+			, bytes
+			, "« bytes in »"
+			, std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count()
+			, "« µs.\n");
+}
+
+void
+tjournal::write(const std::map<std::string, tappend>& appends)
+{
+	std::map<std::string, bool> durable;
+
+	for(const auto& append : appends) {
+		const int fd = file(append.first);
+		if(fd == -1) {
+			durable[append.first] = false;
+			continue;
+		}
+
+		const off_t size = ::lseek(fd, 0, SEEK_END);
+		if(size != -1 && write_all(fd, append.second.data)) {
+			durable[append.first] = true;
+			continue;
+		}
+
+		durable[append.first] = false;
+
+		LOG_E("Failed to write the journal of game »"
+				, append.first
+				, "« message »"
+				, std::strerror(errno)
+				, "«.\n");
+
+		/* Remove the partially written records. */
+		if(size == -1 || ::ftruncate(fd, size) != 0) {
+			LOG_E("Failed to truncate the journal of game »"
+					, append.first
+					, "«, closing the journal.\n");
+
+			::close(fd);
+			files_.erase(append.first);
+		}
+	}
+
+	for(const auto& append : appends) {
+		bool& result = durable[append.first];
+		if(result && ::fdatasync(file(append.first)) != 0) {
+			result = false;
+
+			LOG_E("Failed to sync the journal of game »"
+					, append.first
+					, "« message »"
+					, std::strerror(errno)
+					, "«.\n");
+		}
+
+		for(const tcommit_handler& handler : append.second.handlers) {
+			handler(result);
+		}
+	}
+}
+
+int
+tjournal::file(const std::string& game)
+{
+	auto itor = files_.find(game);
+	if(itor != files_.end()) {
+		return itor->second;
+	}
+
+	const int fd = ::open(
+			  filename(game).c_str()
+			, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC
+			, 0600);
+
+	if(fd == -1) {
+		LOG_E("Failed to open the journal of game »"
+				, game
+				, "« message »"
+				, std::strerror(errno)
+				, "«.\n");
+		return -1;
+	}
+
+	/* Records appended after a torn record would be lost, remove it. */
+	const std::string data = contents(game);
+	std::vector<trecord> records;
+	const size_t size = decode(data, records);
+	if(size != data.size()) {
+		LOG_W("Journal of game »"
+				, game
+				, "« is torn at offset »"
+				, size
+				, "«, truncating »"
+				, data.size() - size
+				, "« bytes.\n");
+
+		if(::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			LOG_E("Failed to truncate the journal of game »"
+					, game
+					, "« message »"
+					, std::strerror(errno)
+					, "«.\n");
+			::close(fd);
+			return -1;
+		}
+	}
+
+	files_.insert(std::make_pair(game, fd));
+	return fd;
+}
+
+bool
+tjournal::replace(const std::string& game, const std::string& data)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": game »", game, "«.\n");
+
+	auto itor = files_.find(game);
+	if(itor != files_.end()) {
+		::close(itor->second);
+		files_.erase(itor);
+	}
+
+	/*
+	 * Write the snapshot to a temporary file and rename it, this way there
+	 * is always a valid journal on disk.
+	 */
+	const std::string name = filename(game);
+	const std::string temporary = name + ".tmp";
+
+	const int fd = ::open(
+			  temporary.c_str()
+			, O_WRONLY | O_TRUNC | O_CREAT | O_CLOEXEC
+			, 0600);
+
+	bool result = true;
+	if(fd == -1
+			|| !write_all(fd, data)
+			|| ::fdatasync(fd) != 0
+			|| ::rename(temporary.c_str(), name.c_str()) != 0) {
+
+		LOG_E("Failed to write a snapshot of game »"
+				, game
+				, "« message »"
+				, std::strerror(errno)
+				, "«.\n");
+		result = false;
+	}
+
+	if(fd != -1) {
+		::close(fd);
+	}
+
+	/* Make the rename durable. */
+	const int directory = ::open(directory_.c_str(), O_RDONLY | O_CLOEXEC);
+	if(directory == -1 || ::fsync(directory) != 0) {
+		result = false;
+	}
+	if(directory != -1) {
+		::close(directory);
+	}
+
+	return result;
+}
+
+std::vector<tjournal::trecord>
+tjournal::read(const std::string& game) const
+{
+	LOG_T(__PRETTY_FUNCTION__, ": game »", game, "«.\n");
+
+	const std::string data = contents(game);
+
+	std::vector<trecord> result;
+	const size_t size = decode(data, result);
+	if(size != data.size()) {
+		LOG_E("Journal of game »"
+				, game
+				, "« is torn at offset »"
+				, size
+				, "«, ignoring »"
+				, data.size() - size
+				, "« bytes after record »"
+				, result.size()
+				, "«.\n");
+	}
+
+	return result;
+}
+
+std::string
+tjournal::contents(const std::string& game) const
+{
+	std::ifstream file(filename(game), std::ios_base::binary);
+	return std::string{
+			  std::istreambuf_iterator<char>(file)
+			, std::istreambuf_iterator<char>()};
+}
+
+std::string
+tjournal::filename(const std::string& game) const
+{
+	return directory_ + '/' + encode_filename(game) + extension;
+}
+
+} // namespace game
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the journal to store the games on disk.
+ */
+
+#ifndef MODULES_GAME_JOURNAL_HPP_INCLUDED
+#define MODULES_GAME_JOURNAL_HPP_INCLUDED
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace game {
+
+/**
+ * The journal of the games.
+ *
+ * Every game has an append-only journal file in the journal directory. The
+ * file starts with a snapshot of the game followed by the records appended
+ * after the snapshot. Writing a new snapshot replaces the file, this keeps
+ * the time needed to recover a game bounded.
+ *
+ * The records are written by a dedicated thread using group commit. All
+ * records queued while the thread is busy are written in the next group,
+ * which needs only one @c fdatasync per file, regardless of the number of
+ * records in the group. This means the records are not yet durable when
+ * @ref append() returns, the optional commit handler is called once the
+ * record is durable.
+ *
+ * A record is a list of fields. On disk a record is stored as a 4-byte
+ * length in network order followed by its fields, every field is stored as
+ * a 4-byte length in network order followed by its contents.
+ *
+ * A failed write is truncated, so no record is appended after a partially
+ * written record. A partially written record at the end of a journal, e.g.
+ * due to a crash, is truncated when the journal is opened for writing.
+ */
+class tjournal final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/** A record in the journal. */
+	typedef std::vector<std::string> trecord;
+
+	/**
+	 * The signature for a handler called after loading a game.
+	 *
+	 * @param records             The records of the game.
+	 */
+	typedef std::function<void(
+				  const std::vector<trecord>& records
+			)>
+			tload_handler;
+
+	/**
+	 * The signature for a handler called after committing a record.
+	 *
+	 * @param durable             Whether the record is durable, when
+	 *                            @c false writing the record failed.
+	 */
+	typedef std::function<void(
+				  const bool durable
+			)>
+			tcommit_handler;
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @param directory__         The directory to store the journal files.
+	 * @param snapshot_interval__ The value of @ref snapshot_interval_.
+	 */
+	tjournal(const std::string& directory__
+			, const unsigned snapshot_interval__);
+
+	/**
+	 * Destructor.
+	 *
+	 * Commits the queued records before returning.
+	 */
+	~tjournal();
+
+	tjournal&
+	operator=(const tjournal&) = delete;
+	tjournal(const tjournal&) = delete;
+
+	tjournal&
+	operator=(tjournal&&) = delete;
+	tjournal(tjournal&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Appends a record to the journal of a game.
+	 *
+	 * @param game                The id of the game.
+	 * @param record              The record to append.
+	 * @param handler             The handler to call after the group
+	 *                            containing the record is committed. The
+	 *                            handler is called in the journal's thread.
+	 */
+	void
+	append(const std::string& game
+			, const trecord& record
+			, const tcommit_handler& handler = nullptr);
+
+	/**
+	 * Replaces the journal of a game with a snapshot.
+	 *
+	 * The records appended before the snapshot are no longer needed, the
+	 * snapshot shall contain their effects.
+	 *
+	 * @param game                The id of the game.
+	 * @param record              The snapshot record.
+	 */
+	void
+	snapshot(const std::string& game, const trecord& record);
+
+	/**
+	 * Returns the ids of all games with a journal.
+	 *
+	 * @returns                   The ids of the games.
+	 */
+	std::vector<std::string>
+	games() const;
+
+	/**
+	 * Loads a game from its journal.
+	 *
+	 * The journal is read in the journal's thread, after the records queued
+	 * before the call are written. A record which is not completely written,
+	 * e.g. due to a crash while writing, is logged as an error and ignored.
+	 *
+	 * @param game                The id of the game.
+	 * @param handler             The handler to call with the records of the
+	 *                            game. The handler is called in the
+	 *                            journal's thread.
+	 */
+	void
+	load(const std::string& game, const tload_handler& handler);
+
+
+	/**
+	 * Encodes a record in the on-disk format of the journal.
+	 *
+	 * @param record              The record to encode.
+	 *
+	 * @returns                   The encoded record.
+	 */
+	static std::string
+	encode(const trecord& record);
+
+	/**
+	 * Decodes the records of a journal in the on-disk format.
+	 *
+	 * @param data                The contents of the journal.
+	 * @param records             The decoded records are appended to this
+	 *                            list.
+	 *
+	 * @returns                   The number of bytes of the complete
+	 *                            records. When not the size of @p data, the
+	 *                            record at the returned offset is torn.
+	 */
+	static size_t
+	decode(const std::string& data, std::vector<trecord>& records);
+
+	/**
+	 * Converts a game id to a string usable as filename.
+	 *
+	 * The id is supplied by a client, so it's hex encoded to avoid special
+	 * characters like @c '/'.
+	 *
+	 * @param game                The id of the game.
+	 *
+	 * @returns                   The encoded id.
+	 */
+	static std::string
+	encode_filename(const std::string& game);
+
+	/**
+	 * Converts a filename back to a game id.
+	 *
+	 * @param filename            The filename as returned by
+	 *                            @ref encode_filename().
+	 * @param game                The decoded game id.
+	 *
+	 * @returns                   Whether the @p filename is valid.
+	 */
+	static bool
+	decode_filename(const std::string& filename, std::string& game);
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	unsigned
+	get_snapshot_interval() const;
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/** A queued request for the @ref thread_. */
+	struct trequest
+	{
+		/** The type of the request. */
+		enum class ttype
+		{
+			  append
+			, snapshot
+			, load
+		};
+
+		/** The type of the request. */
+		ttype type;
+
+		/** The id of the game. */
+		std::string game;
+
+		/** The encoded record, not used for loading. */
+		std::string data;
+
+		/** The handler for loading, only used for loading. */
+		tload_handler handler;
+
+		/** The handler for committing, not used for loading. */
+		tcommit_handler commit_handler;
+	};
+
+	/** The appends of a game gathered in a group. */
+	struct tappend
+	{
+		/** The encoded records. */
+		std::string data{};
+
+		/** The handlers of the records. */
+		std::vector<tcommit_handler> handlers{};
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The directory containing the journal files. */
+	std::string directory_;
+
+	/**
+	 * The number of records after which a game writes a new snapshot.
+	 *
+	 * The journal itself doesn't use the value, but it is stored here since
+	 * the games using the journal need it.
+	 */
+	unsigned snapshot_interval_;
+
+	/** Protects @ref requests_ and @ref stop_. */
+	std::mutex mutex_{};
+
+	/** Signals the @ref thread_ new work is available. */
+	std::condition_variable condition_{};
+
+	/** The requests waiting for the next group. */
+	std::vector<trequest> requests_{};
+
+	/** Should the @ref thread_ stop after the current group? */
+	bool stop_{false};
+
+	/**
+	 * The open journal files.
+	 *
+	 * The key is the id of the game, the value the file descriptor. This
+	 * member is only used by the @ref thread_.
+	 */
+	std::map<std::string, int> files_{};
+
+	/** The thread writing the groups. */
+	std::thread thread_;
+
+	/** Queues a request for the @ref thread_. */
+	void
+	queue(trequest&& request);
+
+	/** The main loop of the @ref thread_. */
+	void
+	run();
+
+	/**
+	 * Executes a group of requests.
+	 *
+	 * @param requests            The requests in the group.
+	 */
+	void
+	commit(const std::vector<trequest>& requests);
+
+	/**
+	 * Writes the appended records.
+	 *
+	 * Calls the commit handlers of the records.
+	 *
+	 * @param appends             The appended records, indexed by the id of
+	 *                            their game.
+	 */
+	void
+	write(const std::map<std::string, tappend>& appends);
+
+	/**
+	 * Returns the file descriptor of the journal of a game.
+	 *
+	 * Opens the journal if it's not yet open, a torn record at the end of
+	 * the journal is truncated.
+	 *
+	 * @param game                The id of the game.
+	 *
+	 * @returns                   The file descriptor or @c -1 upon failure.
+	 */
+	int
+	file(const std::string& game);
+
+	/**
+	 * Replaces the journal of a game.
+	 *
+	 * @param game                The id of the game.
+	 * @param data                The new contents of the journal.
+	 *
+	 * @returns                   Whether the new journal is durable.
+	 */
+	bool
+	replace(const std::string& game, const std::string& data);
+
+	/**
+	 * Reads the journal of a game.
+	 *
+	 * @param game                The id of the game.
+	 *
+	 * @returns                   The records of the game.
+	 */
+	std::vector<trecord>
+	read(const std::string& game) const;
+
+	/** Returns the contents of the journal of a game. */
+	std::string
+	contents(const std::string& game) const;
+
+	/** Returns the filename of the journal of a game. */
+	std::string
+	filename(const std::string& game) const;
+};
+
+} // namespace game
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/game/record_writer.hpp"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace game {
+
+trecord_writer::trecord_writer(const int fd__)
+	: fd_(fd__)
+	, buffer_()
+	, size_(0)
+	, records_(0)
+	, failed_(false)
+{
+}
+
+void
+trecord_writer::record(std::initializer_list<lib::tstring_view> fields)
+{
+	size_t size = 0;
+	for(const lib::tstring_view& field__ : fields) {
+		size += field_size(field__);
+	}
+
+	begin(size);
+	for(const lib::tstring_view& field__ : fields) {
+		field(field__);
+	}
+}
+
+void
+trecord_writer::begin(const size_t size)
+{
+	append_length(size);
+	++records_;
+}
+
+void
+trecord_writer::field(const lib::tstring_view& field)
+{
+	append_length(field.size());
+	append(field.data(), field.size());
+}
+
+bool
+trecord_writer::flush()
+{
+	size_t offset = 0;
+	while(!failed_ && offset != size_) {
+		const ssize_t written =
+				::write(fd_, &buffer_[offset], size_ - offset);
+
+		if(written < 0) {
+			if(errno != EINTR) {
+				failed_ = true;
+			}
+		} else {
+			offset += static_cast<size_t>(written);
+		}
+	}
+
+	size_ = 0;
+	return !failed_;
+}
+
+size_t
+trecord_writer::field_size(const lib::tstring_view& field)
+{
+	return 4 + field.size();
+}
+
+lib::tstring_view
+trecord_writer::format(uint32_t value, tnumber& buffer)
+{
+	size_t offset = buffer.size();
+	do {
+		buffer[--offset] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while(value != 0);
+
+	return lib::tstring_view(&buffer[offset], buffer.size() - offset);
+}
+
+size_t
+trecord_writer::records() const
+{
+	return records_;
+}
+
+void
+trecord_writer::append(const char* data, size_t size)
+{
+	while(size != 0) {
+		if(size_ == buffer_.size()) {
+			flush();
+		}
+
+		const size_t chunk = std::min(size, buffer_.size() - size_);
+		std::memcpy(&buffer_[size_], data, chunk);
+		size_ += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+void
+trecord_writer::append_length(const size_t length)
+{
+	const uint32_t value = htonl(static_cast<uint32_t>(length));
+	append(reinterpret_cast<const char*>(&value), 4);
+}
+
+} // namespace game
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains a writer for records without memory allocation.
+ */
+
+#ifndef MODULES_GAME_RECORD_WRITER_HPP_INCLUDED
+#define MODULES_GAME_RECORD_WRITER_HPP_INCLUDED
+
+#include "lib/string/string_view.tpp"
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+namespace game {
+
+/**
+ * Writes records to a file descriptor.
+ *
+ * The records use the encoding of @ref tjournal::encode(). Unlike the
+ * journal the writer doesn't allocate memory, lock or log; it only uses its
+ * own buffer and system calls. So it can be used in the child of a fork in
+ * a multi-threaded process, e.g. to write a snapshot of the server.
+ *
+ * A record is written with @ref record(), or with @ref begin() followed by
+ * its fields when the number of fields isn't fixed.
+ */
+class trecord_writer final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/** A buffer to format a number in, see @ref format(). */
+	typedef std::array<char, 10> tnumber;
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @param fd__                The file descriptor to write to, the
+	 *                            caller keeps its ownership.
+	 */
+	explicit trecord_writer(const int fd__);
+
+	~trecord_writer() = default;
+
+	trecord_writer&
+	operator=(const trecord_writer&) = delete;
+	trecord_writer(const trecord_writer&) = delete;
+
+	trecord_writer&
+	operator=(trecord_writer&&) = delete;
+	trecord_writer(trecord_writer&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Writes a record.
+	 *
+	 * @param fields              The fields of the record.
+	 */
+	void
+	record(std::initializer_list<lib::tstring_view> fields);
+
+	/**
+	 * Starts a record.
+	 *
+	 * The fields of the record are written with @ref field().
+	 *
+	 * @param size                The size of the fields of the record, the
+	 *                            sum of their @ref field_size().
+	 */
+	void
+	begin(const size_t size);
+
+	/**
+	 * Writes a field of the record started with @ref begin().
+	 *
+	 * @param field               The field to write.
+	 */
+	void
+	field(const lib::tstring_view& field);
+
+	/**
+	 * Writes the buffered data.
+	 *
+	 * @returns                   Whether all data is written.
+	 */
+	bool
+	flush();
+
+	/**
+	 * Returns the size of a field in a record.
+	 *
+	 * @param field               The field.
+	 */
+	static size_t
+	field_size(const lib::tstring_view& field);
+
+	/**
+	 * Formats a number in decimal.
+	 *
+	 * @param value               The number to format.
+	 * @param buffer              The buffer to format the number in.
+	 *
+	 * @returns                   The formatted number, a view on @p buffer.
+	 */
+	static lib::tstring_view
+	format(uint32_t value, tnumber& buffer);
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	/** Returns the number of records written. */
+	size_t
+	records() const;
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The file descriptor to write to. */
+	int fd_;
+
+	/** The buffer for the data not yet written. */
+	std::array<char, 65536> buffer_;
+
+	/** The number of bytes used in the @ref buffer_. */
+	size_t size_;
+
+	/** The number of records written. */
+	size_t records_;
+
+	/** Whether writing failed, further data is discarded. */
+	bool failed_;
+
+	/**
+	 * Appends data to the @ref buffer_.
+	 *
+	 * When the buffer is full it's written to the @ref fd_.
+	 *
+	 * @param data                The data to append.
+	 * @param size                The size of the @p data.
+	 */
+	void
+	append(const char* data, size_t size);
+
+	/**
+	 * Appends a length to the @ref buffer_.
+	 *
+	 * @param length              The length to append.
+	 */
+	void
+	append_length(const size_t length);
+};
+
+} // namespace game
+
+#endif
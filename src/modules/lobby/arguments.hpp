@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the arguments of a command.
+ */
+
+#ifndef MODULES_LOBBY_ARGUMENTS_HPP_INCLUDED
+#define MODULES_LOBBY_ARGUMENTS_HPP_INCLUDED
+
+#include "lib/string/string_view.tpp"
+
+#include <array>
+
+namespace lobby {
+
+/**
+ * The arguments of a command.
+ *
+ * The arguments are views on the received command. In the text encoding
+ * they are separated by a single space, in the binary encoding every
+ * argument has its own size, see binary.hpp. Both encodings decode to the
+ * same arguments, so they share their handlers.
+ *
+ * The number of arguments is limited, so decoding doesn't allocate memory.
+ */
+class targuments final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/** The maximum number of arguments. */
+	static const size_t capacity = 16;
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	targuments()
+		: arguments_()
+		, size_(0)
+	{
+	}
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Adds an argument.
+	 *
+	 * @param argument            The argument to add.
+	 *
+	 * @returns                   Whether the argument is added, fails when
+	 *                            there are @ref capacity arguments.
+	 */
+	bool
+	push_back(const lib::tstring_view& argument)
+	{
+		if(size_ == capacity) {
+			return false;
+		}
+
+		arguments_[size_++] = argument;
+		return true;
+	}
+
+	const lib::tstring_view&
+	operator[](const size_t index) const
+	{
+		return arguments_[index];
+	}
+
+	const lib::tstring_view*
+	begin() const
+	{
+		return arguments_.data();
+	}
+
+	const lib::tstring_view*
+	end() const
+	{
+		return arguments_.data() + size_;
+	}
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	size_t
+	size() const
+	{
+		return size_;
+	}
+
+	bool
+	empty() const
+	{
+		return size_ == 0;
+	}
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The arguments, only the first @ref size_ are used. */
+	std::array<lib::tstring_view, capacity> arguments_;
+
+	/** The number of arguments. */
+	size_t size_;
+};
+
+} // namespace lobby
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/binary.hpp"
+
+namespace lobby {
+
+namespace binary {
+
+void
+append_varint(std::string& buffer, uint32_t value)
+{
+	while(value >= 0x80) {
+		buffer += static_cast<char>((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	buffer += static_cast<char>(value);
+}
+
+bool
+read_varint(lib::tstring_view& buffer, uint32_t& value)
+{
+	uint32_t result = 0;
+
+	/* An uint32_t needs at most 5 groups of 7 bits. */
+	for(size_t i = 0; i < buffer.size() && i < 5; ++i) {
+		const uint32_t byte = static_cast<unsigned char>(buffer[i]);
+		if(i == 4 && byte > 0x0f) {
+			return false;
+		}
+
+		result |= (byte & 0x7f) << (7 * i);
+		if((byte & 0x80) == 0) {
+			value = result;
+			buffer = buffer.substr(i + 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+decode_arguments(const lib::tstring_view& encoded, targuments& arguments)
+{
+	lib::tstring_view input = encoded;
+
+	while(!input.empty()) {
+		uint32_t size;
+		if(!read_varint(input, size) || size > input.size()) {
+			return false;
+		}
+
+		if(!arguments.push_back(input.substr(0, size))) {
+			return false;
+		}
+		input = input.substr(size);
+	}
+
+	return true;
+}
+
+std::string
+encode_command(
+		  const uint8_t opcode
+		, std::initializer_list<lib::tstring_view> arguments)
+{
+	std::string result(1, static_cast<char>(opcode));
+	for(const lib::tstring_view& argument : arguments) {
+		append_varint(result, static_cast<uint32_t>(argument.size()));
+		result.append(argument.data(), argument.size());
+	}
+	return result;
+}
+
+/**
+ * Converts a reply code of the text encoding.
+ *
+ * @param code                    The reply code.
+ * @param reply                   The converted reply code, only modified
+ *                                upon success.
+ *
+ * @returns                       Whether @p code is a reply code.
+ */
+static bool
+to_reply(const lib::tstring_view& code, treply& reply)
+{
+	static const std::pair<const char*, treply> codes[] {
+		  {"OK", treply::ok}
+		, {"EINVAL", treply::einval}
+		, {"EBUSY", treply::ebusy}
+		, {"EACCES", treply::eacces}
+		, {"EPROTO", treply::eproto}
+		, {"EIO", treply::eio}
+		, {"ENOSYS", treply::enosys}
+		, {"ERROR", treply::error}
+	};
+
+	for(const auto& entry : codes) {
+		if(code == entry.first) {
+			reply = entry.second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string
+encode_reply(const std::string& reply)
+{
+	const lib::tstring_view text(reply);
+	const size_t separator = text.find('\n');
+
+	treply code = treply::notification;
+	if(separator == lib::tstring_view::npos
+			|| !to_reply(text.substr(0, separator), code)) {
+
+		std::string result(1, static_cast<char>(treply::notification));
+		result += reply;
+		return result;
+	}
+
+	std::string result(1, static_cast<char>(code));
+	result.append(reply, separator + 1, std::string::npos);
+	return result;
+}
+
+} // namespace binary
+
+} // namespace lobby
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the binary encoding of the commands and replies.
+ *
+ * A session using the @ref communication::tprotocol::basic protocol can
+ * switch to the binary encoding with the @c encoding @c binary command.
+ * Since these messages are already framed by the protocol the encoding
+ * doesn't need terminators.
+ *
+ * A command is encoded as:
+ * - The opcode of the command, one byte, see @ref tdispatcher::add(). The
+ *   opcode @c 0 is the command without a verb, e.g. a game action.
+ * - The arguments, each argument is its size as varint followed by its
+ *   characters.
+ *
+ * A reply is encoded as:
+ * - The @ref treply code, one byte.
+ * - The body of the reply, this is the text after the reply code of the
+ *   text encoding.
+ *
+ * A varint stores 7 bits per byte, least significant group first, the high
+ * bit of a byte is set when more bytes follow.
+ */
+
+#ifndef MODULES_LOBBY_BINARY_HPP_INCLUDED
+#define MODULES_LOBBY_BINARY_HPP_INCLUDED
+
+#include "lib/string/string_view.tpp"
+#include "modules/lobby/arguments.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+namespace lobby {
+
+namespace binary {
+
+/** The reply codes of the binary encoding. */
+enum class treply : uint8_t
+{
+	  ok = 0
+	, einval = 1
+	, ebusy = 2
+	, eacces = 3
+	, eproto = 4
+	, eio = 5
+	, enosys = 6
+	, error = 7
+
+	/** A message without a reply code, e.g. an update of a game. */
+	, notification = 0xff
+};
+
+/**
+ * Appends a varint.
+ *
+ * @param buffer                  The buffer to append to.
+ * @param value                   The value to append.
+ */
+void
+append_varint(std::string& buffer, uint32_t value);
+
+/**
+ * Reads a varint.
+ *
+ * @param buffer                  The buffer to read from, upon success the
+ *                                varint is removed from the buffer.
+ * @param value                   The value read, only modified upon
+ *                                success.
+ *
+ * @returns                       Whether the buffer starts with a valid
+ *                                varint.
+ */
+bool
+read_varint(lib::tstring_view& buffer, uint32_t& value);
+
+/**
+ * Decodes the arguments of a command.
+ *
+ * The arguments are views on the @p encoded arguments, unlike the text
+ * encoding an argument may contain spaces.
+ *
+ * @param encoded                 The encoded arguments, the command without
+ *                                its opcode.
+ * @param arguments               The decoded arguments, appended to.
+ *
+ * @returns                       Whether the arguments are valid, fails
+ *                                when an argument is truncated or there are
+ *                                too many arguments.
+ */
+bool
+decode_arguments(const lib::tstring_view& encoded, targuments& arguments);
+
+/**
+ * Encodes a command.
+ *
+ * The inverse of the decoding by the dispatcher, used by the clients.
+ *
+ * @param opcode                  The opcode of the command.
+ * @param arguments               The arguments of the command.
+ *
+ * @returns                       The encoded command.
+ */
+std::string
+encode_command(
+		  const uint8_t opcode
+		, std::initializer_list<lib::tstring_view> arguments);
+
+/**
+ * Encodes a reply.
+ *
+ * The first line of a text reply is its reply code, see
+ * @ref lib::reply_code(). A message not starting with a reply code is
+ * encoded as a @ref treply::notification with the entire message as body.
+ *
+ * @param reply                   The reply in the text encoding.
+ *
+ * @returns                       The encoded reply.
+ */
+std::string
+encode_reply(const std::string& reply);
+
+} // namespace binary
+
+} // namespace lobby
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "lobby"
+
+#include "modules/lobby/detail/admission.hpp"
+
+#include "modules/logging/log.hpp"
+
+#include <chrono>
+
+namespace lobby {
+
+namespace detail {
+
+/** The number of slots probed for an address. */
+static const size_t probes = 16;
+
+/**
+ * Returns the initial size of the table.
+ *
+ * @param max_connections         The maximum number of connections.
+ * @param max_per_address         The maximum connections per address.
+ * @param rate_per_address        The maximum new connections per address
+ *                                per second.
+ *
+ * @returns                       A power of two, at least twice the number
+ *                                of connections, @c 0 when the addresses
+ *                                aren't tracked.
+ */
+static size_t
+table_size(
+		  const unsigned max_connections
+		, const unsigned max_per_address
+		, const unsigned rate_per_address)
+{
+	if(max_per_address == 0 && rate_per_address == 0) {
+		return 0;
+	}
+
+	size_t result = 1024;
+	while(result < 2 * static_cast<size_t>(max_connections)) {
+		result *= 2;
+	}
+	return result;
+}
+
+/**
+ * Returns the current second.
+ *
+ * The second is offset by one, so @c 0 is never the current second.
+ */
+static uint32_t
+now()
+{
+	return static_cast<uint32_t>(
+			std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count()
+			+ 1);
+}
+
+tadmission::tkey
+tadmission::to_key(const boost::asio::ip::address& address)
+{
+	if(address.is_v4()) {
+		return boost::asio::ip::address_v6::v4_mapped(
+				address.to_v4()).to_bytes();
+	}
+	return address.to_v6().to_bytes();
+}
+
+tadmission::tadmission(
+		  const unsigned max_connections__
+		, const unsigned max_per_address__
+		, const unsigned rate_per_address__)
+	: max_connections_(max_connections__)
+	, max_per_address_(max_per_address__)
+	, rate_per_address_(rate_per_address__)
+	, table_(
+		  table_size(
+			  max_connections__
+			, max_per_address__
+			, rate_per_address__)
+		, tentry{tkey(), 0, 0, 0})
+{
+}
+
+bool
+tadmission::admit(const boost::asio::ip::address& address)
+{
+	const tkey key = to_key(address);
+	const uint32_t second = now();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	const char* reason = nullptr;
+	tentry* entry = nullptr;
+
+	if(max_connections_ != 0 && connections_ >= max_connections_) {
+		reason = "server full";
+	} else if(!table_.empty()) {
+		entry = find(key, second, true);
+		if(entry->second != second) {
+			entry->second = second;
+			entry->created = 0;
+		}
+
+		if(max_per_address_ != 0 && entry->connections >= max_per_address_) {
+			reason = "too many connections";
+		} else if(rate_per_address_ != 0
+				&& entry->created >= rate_per_address_) {
+
+			reason = "too many new connections";
+		}
+
+		/* A refused connection also counts for the rate. */
+		++entry->created;
+	}
+
+	if(reason) {
+		++refused_;
+		LOG_D("Refused connection from »"
+				, address.to_string()
+				, "« reason »"
+				, reason
+				, "«.\n");
+		return false;
+	}
+
+	if(entry) {
+		++entry->connections;
+	}
+	++connections_;
+	return true;
+}
+
+void
+tadmission::release(const boost::asio::ip::address& address)
+{
+	const tkey key = to_key(address);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	tentry* entry = table_.empty() ? nullptr : find(key, now(), false);
+	const bool admitted = table_.empty()
+			? connections_ != 0
+			: entry && entry->connections != 0;
+
+	if(!admitted) {
+		LOG_E("Released connection from »"
+				, address.to_string()
+				, "« was not admitted.\n");
+		return;
+	}
+
+	if(entry) {
+		--entry->connections;
+	}
+	--connections_;
+}
+
+uint64_t
+tadmission::get_refused() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return refused_;
+}
+
+tadmission::tentry*
+tadmission::find(const tkey& key, const uint32_t second, const bool create)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ull;
+	for(const unsigned char byte : key) {
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+
+	for(;;) {
+		const size_t mask = table_.size() - 1;
+		tentry* free = nullptr;
+
+		for(size_t i = 0; i < probes; ++i) {
+			tentry& entry = table_[(static_cast<size_t>(hash) + i) & mask];
+			if(entry.key == key) {
+				return &entry;
+			}
+
+			if(!free && entry.connections == 0 && entry.second != second) {
+				free = &entry;
+			}
+		}
+
+		if(!create) {
+			return nullptr;
+		}
+
+		if(free) {
+			*free = tentry{key, 0, second, 0};
+			return free;
+		}
+
+		grow(second);
+	}
+}
+
+void
+tadmission::grow(const uint32_t second)
+{
+	std::vector<tentry> table(2 * table_.size(), tentry{tkey(), 0, 0, 0});
+	table_.swap(table);
+
+	LOG_D("Admission table grown to »", table_.size(), "« entries.\n");
+
+	for(const tentry& entry : table) {
+		if(entry.connections != 0 || entry.second == second) {
+			*find(entry.key, second, true) = entry;
+		}
+	}
+}
+
+} // namespace detail
+
+} // namespace lobby
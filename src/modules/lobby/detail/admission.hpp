@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#ifndef MODULES_LOBBY_DETAIL_ADMISSION_HPP_INCLUDED
+#define MODULES_LOBBY_DETAIL_ADMISSION_HPP_INCLUDED
+
+#include <boost/asio/ip/address.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lobby {
+
+namespace detail {
+
+/**
+ * Admission control for new connections.
+ *
+ * Before a session is created for a new connection the connection needs to
+ * be admitted. This limits:
+ * - The number of connections of the server.
+ * - The number of concurrent connections per address.
+ * - The number of new connections per address per second.
+ *
+ * The counters per address are stored in an open addressing hash table.
+ * An entry without connections expires at the end of its second, so the
+ * table only holds the addresses which are connected or recently
+ * connected. The table is probed a fixed number of slots; when all these
+ * slots are in use the table doubles its size. The initial size is based
+ * on the maximum number of connections, so a limited server normally never
+ * grows its table.
+ *
+ * When neither the connections per address nor the new connections per
+ * address are limited the addresses aren't tracked and the table isn't
+ * used.
+ */
+class tadmission final
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @param max_connections__   The value of @ref max_connections_.
+	 * @param max_per_address__   The value of @ref max_per_address_.
+	 * @param rate_per_address__  The value of @ref rate_per_address_.
+	 */
+	tadmission(const unsigned max_connections__
+			, const unsigned max_per_address__
+			, const unsigned rate_per_address__);
+
+	~tadmission() = default;
+
+	tadmission&
+	operator=(const tadmission&) = delete;
+	tadmission(const tadmission&) = delete;
+
+	tadmission&
+	operator=(tadmission&&) = delete;
+	tadmission(tadmission&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Admits a new connection.
+	 *
+	 * @param address             The remote address of the connection.
+	 *
+	 * @returns                   Whether the connection is admitted, if
+	 *                            admitted it shall be released with
+	 *                            @ref release().
+	 */
+	bool
+	admit(const boost::asio::ip::address& address);
+
+	/**
+	 * Releases an admitted connection.
+	 *
+	 * @param address             The remote address of the connection.
+	 */
+	void
+	release(const boost::asio::ip::address& address);
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	/** Returns the number of connections refused since the start. */
+	uint64_t
+	get_refused() const;
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/** An address, IPv4 addresses are stored as IPv4-mapped IPv6 address. */
+	typedef std::array<unsigned char, 16> tkey;
+
+	/** An entry in the @ref table_. */
+	struct tentry
+	{
+		/** The address of the entry. */
+		tkey key;
+
+		/** The number of connections of the address. */
+		uint32_t connections;
+
+		/** The second of the @ref created counter. */
+		uint32_t second;
+
+		/** The number of connections created in the @ref second. */
+		uint32_t created;
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The maximum number of connections, when @c 0 unlimited. */
+	const unsigned max_connections_;
+
+	/** The maximum connections per address, when @c 0 unlimited. */
+	const unsigned max_per_address_;
+
+	/** The maximum new connections per address per second, @c 0 unlimited. */
+	const unsigned rate_per_address_;
+
+	/** Protects the members, connections are released in the io threads. */
+	mutable std::mutex mutex_{};
+
+	/**
+	 * The counters per address.
+	 *
+	 * The size is a power of two, empty when the addresses aren't tracked.
+	 */
+	std::vector<tentry> table_;
+
+	/** The number of admitted connections. */
+	unsigned connections_{0};
+
+	/** The number of refused connections. */
+	uint64_t refused_{0};
+
+	/** Converts an address to its key. */
+	static tkey
+	to_key(const boost::asio::ip::address& address);
+
+	/**
+	 * Finds the entry of an address.
+	 *
+	 * @param key                 The address to find.
+	 * @param second              The current second.
+	 * @param create              Whether to create the entry when not found.
+	 *
+	 * @returns                   The entry, @c nullptr when not found and
+	 *                            not @p create.
+	 */
+	tentry*
+	find(const tkey& key, const uint32_t second, const bool create);
+
+	/**
+	 * Doubles the size of the @ref table_.
+	 *
+	 * The expired entries are removed.
+	 *
+	 * @param second              The current second.
+	 */
+	void
+	grow(const uint32_t second);
+};
+
+} // namespace detail
+
+} // namespace lobby
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/detail/quota.hpp"
+
+#include <algorithm>
+
+namespace lobby {
+
+namespace detail {
+
+int64_t
+charge(int64_t& arrival
+		, const uint64_t amount
+		, const unsigned rate
+		, const unsigned burst
+		, const int64_t now)
+{
+	if(rate == 0) {
+		return 0;
+	}
+
+	const int64_t interval = 1000000000 / rate;
+	const int64_t tolerance = interval * std::max(1u, burst);
+
+	arrival = std::max(arrival, now)
+			+ static_cast<int64_t>(amount) * interval;
+
+	return std::max(arrival - now - tolerance, int64_t(0));
+}
+
+} // namespace detail
+
+} // namespace lobby
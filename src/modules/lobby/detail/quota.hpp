@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the rate limiting of the session quotas.
+ */
+
+#ifndef MODULES_LOBBY_DETAIL_QUOTA_HPP_INCLUDED
+#define MODULES_LOBBY_DETAIL_QUOTA_HPP_INCLUDED
+
+#include <cstdint>
+
+namespace lobby {
+
+namespace detail {
+
+/**
+ * Charges a token bucket.
+ *
+ * The bucket uses the generic cell rate algorithm, it only stores the
+ * theoretical arrival time of the next token. A bucket is within its limit
+ * while the arrival time is at most @p burst tokens in the future.
+ *
+ * @param arrival                 The theoretical arrival time of the
+ *                                bucket, in nanoseconds.
+ * @param amount                  The number of tokens to charge.
+ * @param rate                    The number of tokens per second, when
+ *                                @c 0 the bucket is unlimited.
+ * @param burst                   The size of the bucket.
+ * @param now                     The current time, in nanoseconds.
+ *
+ * @returns                       The time in nanoseconds until the bucket
+ *                                is within its limit again.
+ */
+int64_t
+charge(int64_t& arrival
+		, const uint64_t amount
+		, const unsigned rate
+		, const unsigned burst
+		, const int64_t now);
+
+} // namespace detail
+
+} // namespace lobby
+
+#endif
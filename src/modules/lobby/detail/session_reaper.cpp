@@ -25,8 +25,10 @@ namespace detail {
 
 tsession_reaper::tsession_reaper(
 		  boost::asio::io_service& io_service
-		, std::list<tsession>& sessions__)
+		, std::list<tsession>& sessions__
+		, std::mutex& sessions_mutex__)
 	: sessions_(sessions__)
+	, sessions_mutex_(sessions_mutex__)
 	, timer_(io_service)
 {
 }
@@ -50,9 +52,15 @@ tsession_reaper::reap()
 {
 	LOG_T(__PRETTY_FUNCTION__, ".\n");
 
+	std::lock_guard<std::mutex> lock(sessions_mutex_);
+
 	auto itor = sessions_.begin();
 	while(itor != sessions_.end()) {
-		if(itor->get_status() == tsession::tstatus::reapable) {
+		if(!itor->is_referenced()
+				&& (itor->get_status() == tsession::tstatus::reapable
+					|| (itor->get_status() == tsession::tstatus::disconnected
+						&& !itor->is_resumable()))) {
+
 			LOG_D("Session reaper: reaping.\n");
 			itor = sessions_.erase(itor);
 		} else {
@@ -67,7 +75,11 @@ tsession_reaper::wait_handler(const boost::system::error_code& error)
 	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
 
 	if(error != boost::asio::error::operation_aborted) {
-		LOG_I("Session reaper: run.\n");
+		LOG_I("Session reaper: run, receiving paused »"
+				, tsession::get_total_throttle_pauses()
+				, "« times for »"
+				, tsession::get_total_throttle_time() / 1000000
+				, "« ms.\n");
 		reap();
 		run();
 	}
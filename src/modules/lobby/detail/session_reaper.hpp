@@ -20,6 +20,7 @@
 #include <boost/asio/deadline_timer.hpp>
 
 #include <list>
+#include <mutex>
 
 namespace lobby {
 
@@ -33,7 +34,8 @@ public:
 
 	tsession_reaper(
 			  boost::asio::io_service& io_service
-			, std::list<tsession>& sessions__);
+			, std::list<tsession>& sessions__
+			, std::mutex& sessions_mutex__);
 
 	~tsession_reaper() = default;
 
@@ -64,10 +66,19 @@ private:
 	 */
 	std::list<tsession>& sessions_;
 
+	/** Protects the @ref sessions_. */
+	std::mutex& sessions_mutex_;
+
 	/** The timer used to implement the periodically reaping. */
 	boost::asio::deadline_timer timer_;
 
-	/** Reapse the session which are in the state @ref reapable. */
+	/**
+	 * Reapse the session which are in the state @ref reapable.
+	 *
+	 * Also reaps the disconnected sessions whose grace period expired. The
+	 * sessions still referenced, see @ref tsession::acquire(), are reaped
+	 * in a later run.
+	 */
 	void
 	reap();
 
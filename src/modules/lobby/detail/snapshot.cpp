@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#define LOGGER_DEFINE_MODULE_LOGGER_MACROS "lobby"
+
+#include "modules/lobby/detail/snapshot.hpp"
+
+#include "modules/logging/log.hpp"
+
+#include <boost/asio/read_until.hpp>
+
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <istream>
+
+namespace lobby {
+
+namespace detail {
+
+tsnapshot::tsnapshot(
+		  boost::asio::io_service& io_service
+		, const pid_t pid__
+		, const int fd)
+	: pid_(pid__)
+	, descriptor_(io_service, fd)
+{
+}
+
+void
+tsnapshot::run()
+{
+	LOG_T(__PRETTY_FUNCTION__, ": pid »", pid_, "«.\n");
+
+	read();
+}
+
+bool
+tsnapshot::is_running() const
+{
+	return running_;
+}
+
+void
+tsnapshot::read()
+{
+	boost::asio::async_read_until(
+			  descriptor_
+			, buffer_
+			, '\n'
+			, std::bind(
+				  &tsnapshot::read_handler
+				, this
+				, std::placeholders::_1));
+}
+
+void
+tsnapshot::read_handler(const boost::system::error_code& error)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(!error) {
+		std::istream stream(&buffer_);
+		std::string line;
+		std::getline(stream, line);
+
+		LOG_I("Snapshot: ", line, ".\n");
+
+		read();
+		return;
+	}
+
+	/* The child closed the pipe, so it's finished. */
+	int status = -1;
+	while(::waitpid(pid_, &status, 0) == -1 && errno == EINTR) {
+		/* Do nothing. */
+	}
+
+	const auto duration =
+			std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start_).count();
+
+	if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+		LOG_I("Snapshot: finished in »", duration, "« ms.\n");
+	} else {
+		LOG_E("Snapshot: process »"
+				, pid_
+				, "« failed after »"
+				, duration
+				, "« ms.\n");
+	}
+
+	descriptor_.close();
+	running_ = false;
+}
+
+} // namespace detail
+
+} // namespace lobby
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#ifndef MODULES_LOBBY_DETAIL_SNAPSHOT_HPP_INCLUDED
+#define MODULES_LOBBY_DETAIL_SNAPSHOT_HPP_INCLUDED
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/streambuf.hpp>
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace lobby {
+
+namespace detail {
+
+/**
+ * Monitors a snapshot of the server state.
+ *
+ * The snapshot is written by a forked child process. The child reports its
+ * progress as lines of text over a pipe, these lines are logged by this
+ * class. When the child closes the pipe it is reaped.
+ */
+class tsnapshot final
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * @param io_service          The io_service to read the pipe in.
+	 * @param pid__               The process id of the child.
+	 * @param fd                  The read end of the progress pipe, the
+	 *                            object takes ownership of the descriptor.
+	 */
+	tsnapshot(boost::asio::io_service& io_service
+			, const pid_t pid__
+			, const int fd);
+
+	~tsnapshot() = default;
+
+	tsnapshot&
+	operator=(const tsnapshot&) = delete;
+	tsnapshot(const tsnapshot&) = delete;
+
+	tsnapshot&
+	operator=(tsnapshot&&) = delete;
+	tsnapshot(tsnapshot&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/** Starts monitoring the child. */
+	void
+	run();
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	bool
+	is_running() const;
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The process id of the child. */
+	pid_t pid_;
+
+	/** The read end of the progress pipe. */
+	boost::asio::posix::stream_descriptor descriptor_;
+
+	/** The buffer for the progress lines. */
+	boost::asio::streambuf buffer_{};
+
+	/** The time the child was started. */
+	std::chrono::steady_clock::time_point start_{
+			std::chrono::steady_clock::now()};
+
+	/**
+	 * Is the child still running?
+	 *
+	 * Once @c false the object is no longer used and can be destroyed.
+	 */
+	std::atomic<bool> running_{true};
+
+	/** Reads the next line of progress. */
+	void
+	read();
+
+	/** The handler functor for @ref read(). */
+	void
+	read_handler(const boost::system::error_code& error);
+};
+
+} // namespace detail
+
+} // namespace lobby
+
+#endif
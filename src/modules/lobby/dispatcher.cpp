@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/dispatcher.hpp"
+
+#include "lib/exception/validate.tpp"
+#include "modules/lobby/binary.hpp"
+
+namespace lobby {
+
+/** The first line of a batch. */
+static const lib::tstring_view batch_header("batch\n");
+
+/** Returns the result of a command with too many arguments. */
+static lib::tresult
+too_many_arguments()
+{
+	return lib::tresult(
+			  lib::texception::ttype::invalid_value
+			, "Too many arguments");
+}
+
+/**
+ * Splits the arguments of the text encoding.
+ *
+ * @param text                    The arguments, separated by a single space.
+ * @param arguments               The arguments, appended to.
+ *
+ * @returns                       Whether all arguments fit.
+ */
+static bool
+split(const lib::tstring_view& text, targuments& arguments)
+{
+	if(text.empty()) {
+		return true;
+	}
+
+	size_t begin = 0;
+	while(true) {
+		const size_t end = text.find(' ', begin);
+		if(!arguments.push_back(text.substr(begin, end - begin))) {
+			return false;
+		}
+		if(end == lib::tstring_view::npos) {
+			return true;
+		}
+		begin = end + 1;
+	}
+}
+
+tdispatcher::tdispatcher()
+	: nodes_(1)
+	, commands_(1, tcommand{0, thandler(), tbatch::allowed})
+	, opcodes_()
+{
+	opcodes_.fill(0);
+}
+
+tdispatcher&
+tdispatcher::add(
+		  const lib::tstring_view& verb
+		, const uint8_t opcode
+		, const tmodes& modes
+		, const thandler& handler
+		, const tbatch batch)
+{
+	VALIDATE(!verb.empty());
+	VALIDATE(opcode != 0 && opcodes_[opcode] == 0);
+
+	unsigned node = 0;
+	for(size_t i = 0; i < verb.size(); ++i) {
+		unsigned child = 0;
+		for(const auto& entry : nodes_[node].children) {
+			if(entry.first == verb[i]) {
+				child = entry.second;
+				break;
+			}
+		}
+
+		if(child == 0) {
+			child = static_cast<unsigned>(nodes_.size());
+			nodes_[node].children.push_back(std::make_pair(verb[i], child));
+			nodes_.push_back(tnode());
+		}
+		node = child;
+	}
+
+	VALIDATE(nodes_[node].command == 0);
+
+	nodes_[node].command = static_cast<unsigned>(commands_.size());
+	opcodes_[opcode] = nodes_[node].command;
+	commands_.push_back(tcommand{mask(modes), handler, batch});
+
+	return *this;
+}
+
+tdispatcher&
+tdispatcher::set_fallback(
+		  const tmodes& modes
+		, const thandler& handler
+		, const tbatch batch)
+{
+	commands_[0] = tcommand{mask(modes), handler, batch};
+	return *this;
+}
+
+lib::tresult
+tdispatcher::dispatch(tsession& session, const lib::tstring_view& command) const
+{
+	if(command.empty()) {
+		return lib::tresult();
+	}
+
+	if(session.get_encoding() == tsession::tencoding::binary) {
+		return dispatch_binary(session, command);
+	}
+	if(command.substr(0, batch_header.size()) == batch_header) {
+		return dispatch_batch(session, command.substr(batch_header.size()));
+	}
+	if(command[command.size() - 1] == '\n') {
+		return dispatch_text(
+				  session
+				, command.substr(0, command.size() - 1)
+				, false);
+	}
+	return dispatch_text(session, command, false);
+}
+
+lib::tresult
+tdispatcher::dispatch_text(
+		  tsession& session
+		, const lib::tstring_view& command
+		, const bool batch) const
+{
+	/*
+	 * Walk the trie, a verb matches when it's followed by a space or the
+	 * end of the command. The longest matching verb is used.
+	 */
+	unsigned match = 0;
+	size_t match_size = 0;
+
+	unsigned node = 0;
+	for(size_t i = 0; ; ++i) {
+		if(nodes_[node].command != 0
+				&& (i == command.size() || command[i] == ' ')) {
+
+			match = nodes_[node].command;
+			match_size = i;
+		}
+
+		if(i == command.size()) {
+			break;
+		}
+
+		unsigned child = 0;
+		for(const auto& entry : nodes_[node].children) {
+			if(entry.first == command[i]) {
+				child = entry.second;
+				break;
+			}
+		}
+
+		if(child == 0) {
+			break;
+		}
+		node = child;
+	}
+
+	targuments arguments;
+	if(match == 0) {
+		arguments.push_back(command);
+	} else if(!split(command.substr(match_size + 1), arguments)) {
+		return too_many_arguments();
+	}
+
+	return call(match, session, arguments, batch);
+}
+
+lib::tresult
+tdispatcher::dispatch_batch(
+		  tsession& session
+		, const lib::tstring_view& batch) const
+{
+	std::string replies;
+	unsigned count = 0;
+
+	/* Reused for every command, so the memory is only allocated once. */
+	std::string reply;
+
+	size_t begin = 0;
+	while(begin < batch.size()) {
+		size_t end = batch.find('\n', begin);
+		if(end == lib::tstring_view::npos) {
+			end = batch.size();
+		}
+
+		const lib::tstring_view command = batch.substr(begin, end - begin);
+		begin = end + 1;
+
+		if(command.empty()) {
+			continue;
+		}
+
+		reply.clear();
+		{
+			const tsession::tcapture capture(session, reply);
+			try {
+				const lib::tresult result =
+						dispatch_text(session, command, true);
+				if(!result) {
+					session.reply(result);
+				}
+			} catch(...) {
+				session.send("ERROR\n");
+			}
+		}
+
+		lib::append(replies, reply.size(), '\n', reply);
+		++count;
+	}
+
+	session.send(lib::concatenate("OK\n", count, '\n', replies));
+	return lib::tresult();
+}
+
+lib::tresult
+tdispatcher::dispatch_binary(
+		  tsession& session
+		, const lib::tstring_view& command) const
+{
+	const uint8_t opcode = static_cast<uint8_t>(command[0]);
+	if(opcode != 0 && opcodes_[opcode] == 0) {
+		return lib::tresult(
+				  lib::texception::ttype::invalid_value
+				, "Unknown command");
+	}
+
+	targuments arguments;
+	if(!binary::decode_arguments(command.substr(1), arguments)) {
+		return lib::tresult(
+				  lib::texception::ttype::protocol_error
+				, "Malformed binary command");
+	}
+
+	return call(opcodes_[opcode], session, arguments, false);
+}
+
+unsigned
+tdispatcher::mask(const tmodes& modes)
+{
+	unsigned result = 0;
+	for(const tsession::tmode mode : modes) {
+		result |= 1u << static_cast<unsigned>(mode);
+	}
+	return result;
+}
+
+lib::tresult
+tdispatcher::call(
+		  const unsigned index
+		, tsession& session
+		, const targuments& arguments
+		, const bool batch) const
+{
+	const tcommand& command = commands_[index];
+	const unsigned mode = 1u << static_cast<unsigned>(session.get_mode());
+
+	if(!command.handler || (command.modes & mode) == 0) {
+		return lib::tresult(
+				  lib::texception::ttype::invalid_value
+				, "Unknown command");
+	}
+
+	if(batch && command.batch == tbatch::forbidden) {
+		return lib::tresult(
+				  lib::texception::ttype::invalid_value
+				, "The command can't be part of a batch");
+	}
+
+	return command.handler(session, arguments);
+}
+
+} // namespace lobby
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the command dispatcher of the lobby and the games.
+ */
+
+#ifndef MODULES_LOBBY_DISPATCHER_HPP_INCLUDED
+#define MODULES_LOBBY_DISPATCHER_HPP_INCLUDED
+
+#include "lib/exception/result.hpp"
+#include "lib/string/string_view.tpp"
+#include "modules/lobby/arguments.hpp"
+#include "modules/lobby/session.hpp"
+
+#include <array>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+namespace lobby {
+
+/**
+ * Dispatches the commands of a session to their handlers.
+ *
+ * A command starts with its verb, one or more words, followed by its
+ * arguments, e.g. @c game @c create @c my_game. The verbs are stored in a
+ * trie, so finding the handler of a command only walks the characters of
+ * its verb, regardless of the number of commands. The arguments are
+ * views on the received message, dispatching doesn't allocate memory.
+ *
+ * Every command is only available in some modes of the session. A command
+ * not available in the session's current mode is treated as an unknown
+ * command.
+ *
+ * Every command also has an opcode, used when the session uses the binary
+ * encoding, see binary.hpp. Both encodings use the same handlers, so they
+ * can't get out of sync.
+ */
+class tdispatcher final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The handler of a command.
+	 *
+	 * Upon success the handler sends its own reply.
+	 *
+	 * @param session             The session sending the command.
+	 * @param arguments           The arguments of the command.
+	 *
+	 * @returns                   The result, upon failure the dispatcher's
+	 *                            caller sends the reply.
+	 */
+	typedef std::function<lib::tresult(
+				  tsession& session
+				, const targuments& arguments
+			)>
+			thandler;
+
+	/** The modes in which a command is available. */
+	typedef std::initializer_list<tsession::tmode> tmodes;
+
+	/**
+	 * Whether a command may be part of a batch.
+	 *
+	 * The replies of a batch are collected while its commands are
+	 * executed. A command replying later, e.g. after another thread
+	 * executed it, or changing how the replies are encoded can't be part of
+	 * a batch.
+	 */
+	enum class tbatch
+	{
+		  allowed
+		, forbidden
+	};
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	tdispatcher();
+
+	tdispatcher&
+	operator=(const tdispatcher&) = delete;
+	tdispatcher(const tdispatcher&) = delete;
+
+	tdispatcher&
+	operator=(tdispatcher&&) = delete;
+	tdispatcher(tdispatcher&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Adds a command.
+	 *
+	 * @param verb                The verb of the command, the words are
+	 *                            separated by a single space.
+	 * @param opcode              The opcode of the command in the binary
+	 *                            encoding, shall not be @c 0.
+	 * @param modes               The modes in which the command is
+	 *                            available.
+	 * @param handler             The handler of the command.
+	 * @param batch               Whether the command may be part of a
+	 *                            batch.
+	 *
+	 * @returns                   The dispatcher, so the commands can be
+	 *                            chained.
+	 */
+	tdispatcher&
+	add(const lib::tstring_view& verb
+			, const uint8_t opcode
+			, const tmodes& modes
+			, const thandler& handler
+			, const tbatch batch = tbatch::allowed);
+
+	/**
+	 * Sets the handler for the commands without a verb.
+	 *
+	 * @param modes               The modes in which the handler is
+	 *                            available.
+	 * @param handler             The handler of the commands, in the text
+	 *                            encoding its only argument is the entire
+	 *                            command.
+	 * @param batch               Whether the commands may be part of a
+	 *                            batch.
+	 *
+	 * @returns                   The dispatcher.
+	 */
+	tdispatcher&
+	set_fallback(
+			  const tmodes& modes
+			, const thandler& handler
+			, const tbatch batch = tbatch::allowed);
+
+	/**
+	 * Dispatches a command.
+	 *
+	 * An empty command is ignored. The command is decoded in the encoding
+	 * of the session.
+	 *
+	 * A text command whose first line is @c batch is a batch, every other
+	 * line is a command. The commands are executed in order and their
+	 * replies are combined in one reply: @c OK, the number of commands and
+	 * for every command the size of its reply followed by the reply, e.g.
+	 * @c "OK\n2\n3\nOK\n16\nEINVAL\nUnknown.\n". A command with
+	 * @ref tbatch::forbidden fails. The commands of a batch are executed by
+	 * this dispatcher, so after a command moves the session to a game the
+	 * remaining commands are unknown commands.
+	 *
+	 * A trailing newline of a text command that isn't a batch is ignored.
+	 *
+	 * @param session             The session sending the command.
+	 * @param command             The command.
+	 *
+	 * @returns                   The result of the handler, fails when the
+	 *                            command is unknown.
+	 */
+	lib::tresult
+	dispatch(tsession& session, const lib::tstring_view& command) const;
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/** A node in the trie. */
+	struct tnode
+	{
+		/** The children of the node, the character and the child's index. */
+		std::vector<std::pair<char, unsigned>> children{};
+
+		/** The index of the command in @ref commands_, @c 0 if none. */
+		unsigned command{0};
+	};
+
+	/** A command. */
+	struct tcommand
+	{
+		/** The modes as bitmask, see @ref mask(). */
+		unsigned modes;
+
+		/** The handler of the command. */
+		thandler handler;
+
+		/** Whether the command may be part of a batch. */
+		tbatch batch;
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The nodes of the trie, the first node is the root. */
+	std::vector<tnode> nodes_;
+
+	/** The commands, the first command is the fallback. */
+	std::vector<tcommand> commands_;
+
+	/** The index in @ref commands_ of every opcode, @c 0 if none. */
+	std::array<unsigned, 256> opcodes_;
+
+	/**
+	 * Dispatches a command in the text encoding.
+	 *
+	 * @param session             The session sending the command.
+	 * @param command             The command.
+	 * @param batch               Whether the command is part of a batch.
+	 */
+	lib::tresult
+	dispatch_text(
+			  tsession& session
+			, const lib::tstring_view& command
+			, const bool batch) const;
+
+	/** Dispatches a batch of commands in the text encoding. */
+	lib::tresult
+	dispatch_batch(tsession& session, const lib::tstring_view& batch) const;
+
+	/** Dispatches a command in the binary encoding. */
+	lib::tresult
+	dispatch_binary(
+			  tsession& session
+			, const lib::tstring_view& command) const;
+
+	/** Converts modes to a bitmask. */
+	static unsigned
+	mask(const tmodes& modes);
+
+	/**
+	 * Calls a command, if available in the mode of the session.
+	 *
+	 * @param index               The index of the command.
+	 * @param session             The session sending the command.
+	 * @param arguments           The arguments of the command.
+	 * @param batch               Whether the command is part of a batch.
+	 */
+	lib::tresult
+	call(const unsigned index
+			, tsession& session
+			, const targuments& arguments
+			, const bool batch) const;
+};
+
+} // namespace lobby
+
+#endif
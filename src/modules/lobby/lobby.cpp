@@ -18,10 +18,30 @@
 
 #include "lib/exception/validate.tpp"
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
 #include "zard/configuration.hpp"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+
 namespace lobby {
 
+/** Returns the result of a command with invalid arguments. */
+static lib::tresult
+invalid_arguments()
+{
+	return lib::tresult(
+			  lib::texception::ttype::invalid_value
+			, "Invalid arguments");
+}
+
 tlobby::tlobby()
 	  /*
 	   * Port number and protocol should be a setting.
@@ -32,56 +52,184 @@ tlobby::tlobby()
 		, boost::asio::ip::tcp::endpoint(
 			  boost::asio::ip::tcp::v4()
 			, tconfiguration::configuration().port))
+	, evict_timer_(io_service_)
+	, admission_(
+		  tconfiguration::configuration().max_connections
+		, tconfiguration::configuration().max_connections_per_address
+		, tconfiguration::configuration().connection_rate_per_address)
+	, snapshot_signal_(io_service_, SIGUSR1)
+	, recorder_signal_(io_service_, SIGUSR2)
 {
+	add_commands();
+
+	const tconfiguration& configuration = tconfiguration::configuration();
+	if(!configuration.journal_directory.empty()) {
+		journal_.reset(new game::tjournal(
+				  configuration.journal_directory
+				, configuration.journal_snapshot_interval));
+
+		recover();
+	}
+
 	run();
 }
 
-void
+lib::tresult
 tlobby::user(tsession& session, const std::string& id)
 {
 	LOG_T(__PRETTY_FUNCTION__, ": id »", id, "«.\n");
 
-	for(const tsession& s : sessions_) {
-		if(s.get_id() == id) {
-			throw lib::texception(
+	std::lock_guard<std::mutex> lock(sessions_mutex_);
+
+	for(tsession& s : sessions_) {
+		if(&s == &session || s.get_id() != id) {
+			continue;
+		}
+
+		if(s.get_status() == tsession::tstatus::connected) {
+			return lib::tresult(
 					  lib::texception::ttype::busy
-					, lib::concatenate(
-						  "A user with id »"
-						, id
-						, "« already logged in"));
+					, "The user is already logged in"
+					, id);
+		}
+
+		/*
+		 * Logging in again without resuming takes over the user, so only
+		 * one session of the user can be resumed.
+		 */
+		if(s.is_resumable()) {
+			s.expire();
 		}
 	}
 
 	session.set_id(id);
 	session.set_mode(tsession::tmode::lobby);
-	session.send("OK\n");
+	session.send(lib::concatenate("OK\n", session.create_token(), '\n'));
+
+	return lib::tresult();
 }
 
 void
+tlobby::resume(
+		  tsession& session
+		, const std::string& token
+		, const uint32_t last_seen)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": last_seen »", last_seen, "«.\n");
+
+	bool found = false;
+	bool resumed = false;
+	uint32_t last_received = 0;
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex_);
+
+		for(tsession& previous : sessions_) {
+			if(&previous == &session
+					|| previous.get_token() != token
+					|| !previous.is_resumable()) {
+
+				continue;
+			}
+
+			found = true;
+			last_received = previous.get_last_received_id();
+			resumed = session.resume(previous, last_seen);
+			break;
+		}
+	}
+
+	if(!found) {
+		session.send("EINVAL\nNo session to resume.\n");
+		return;
+	}
+
+	if(!resumed) {
+		session.send("EINVAL\nThe missed messages are no longer available.\n");
+		return;
+	}
+
+	/*
+	 * The actions of the new connection are numbered from the start, the
+	 * client sends the actions after the last one received again.
+	 */
+	session.send(lib::concatenate("OK\n", last_received, '\n'));
+
+	const std::string game = session.get_game();
+	if(!game.empty()) {
+		const lib::tresult result = game_join(session, game);
+		if(!result) {
+			session.reply(result);
+		}
+	}
+}
+
+lib::tresult
 tlobby::game_create(tsession& session, const std::string& id)
 {
 	LOG_T(__PRETTY_FUNCTION__, ": id »", id, "«.\n");
 
-	for(const game::tgame& game : games_) {
-		if(game.id() == id) {
-			throw lib::texception(
-					  lib::texception::ttype::busy
-					, lib::concatenate(
-						  "A game with id »"
-						, id
-						, "« is already created"));
-		}
+	std::lock_guard<std::mutex> lock(games_mutex_);
+
+	if(games_.count(id) != 0) {
+		return lib::tresult(
+				  lib::texception::ttype::busy
+				, "The game is already created"
+				, id);
+	}
+
+	tgame_entry& entry = games_[id];
+	entry.game = std::make_shared<game::tgame>(
+			  io_service_
+			, session
+			, id
+			, tconfiguration::configuration().game_tick_interval
+			, journal_.get());
+
+	entry.game->start();
+
+	return lib::tresult();
+}
+
+lib::tresult
+tlobby::game_join(tsession& session, const std::string& id)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": id »", id, "«.\n");
+
+	std::lock_guard<std::mutex> lock(games_mutex_);
+
+	auto itor = games_.find(id);
+	if(itor == games_.end()) {
+		return lib::tresult(
+				  lib::texception::ttype::invalid_value
+				, "The game doesn't exist"
+				, id);
+	}
+
+	tgame_entry& entry = itor->second;
+	if(entry.game && !entry.busy) {
+		entry.game->join(session);
+		return lib::tresult();
+	}
+
+	session.set_mode(tsession::tmode::joining_game);
+	session.acquire();
+	entry.joining.push_back(&session);
+
+	if(!entry.game && !entry.busy) {
+		load(id, entry);
 	}
 
-	games_.push_back(game::tgame(session, id));
+	return lib::tresult();
 }
 
 std::vector<std::string>
 tlobby::game_list() const
 {
+	std::lock_guard<std::mutex> lock(games_mutex_);
+
 	std::vector<std::string> result;
-	for(const game::tgame& game : games_) {
-		result.push_back(game.id());
+	for(const auto& game : games_) {
+		result.push_back(game.first);
 	}
 	return result;
 }
@@ -92,13 +240,415 @@ tlobby::game_list(tsession& session) const
 	LOG_T(__PRETTY_FUNCTION__, ".\n");
 
 	std::string result = "OK\n";
-	for(const game::tgame& game : games_) {
-		result += game.id();
+	for(const std::string& id : game_list()) {
+		result += id;
 		result += '\n';
 	}
 	session.send(result);
 }
 
+void
+tlobby::recover()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for(const std::string& id : journal_->games()) {
+		games_[id];
+	}
+
+	LOG_I("Recovered »"
+			, games_.size()
+			, "« games in »"
+			, std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count()
+			, "« ms.\n");
+}
+
+void
+tlobby::load(const std::string& id, tgame_entry& entry)
+{
+	LOG_D("Load game »", id, "«.\n");
+
+	entry.busy = true;
+
+	journal_->load(id, std::bind(
+			  &tlobby::load_handler
+			, this
+			, id
+			, std::chrono::steady_clock::now()
+			, std::placeholders::_1));
+}
+
+void
+tlobby::load_handler(
+		  const std::string& id
+		, const std::chrono::steady_clock::time_point start
+		, const std::vector<game::tjournal::trecord>& records)
+{
+	std::shared_ptr<game::tgame> game = std::make_shared<game::tgame>(
+			  io_service_
+			, id
+			, tconfiguration::configuration().game_tick_interval
+			, journal_.get()
+			, records);
+
+	game->start();
+
+	LOG_I("Loaded game »"
+			, id
+			, "« with »"
+			, records.size()
+			, "« journal records in »"
+			, std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count()
+			, "« ms.\n");
+
+	std::lock_guard<std::mutex> lock(games_mutex_);
+
+	tgame_entry& entry = games_.at(id);
+	entry.game = game;
+	entry.busy = false;
+
+	for(tsession* session : entry.joining) {
+		game->join(*session);
+		session->release();
+	}
+	entry.joining.clear();
+}
+
+void
+tlobby::start_evict_timer()
+{
+	evict_timer_.expires_from_now(boost::posix_time::seconds(
+			tconfiguration::configuration().reap_interval));
+
+	evict_timer_.async_wait(std::bind(
+			  &tlobby::evict
+			, this
+			, std::placeholders::_1));
+}
+
+void
+tlobby::evict(const boost::system::error_code& error)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(error == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(games_mutex_);
+
+		for(auto& game : games_) {
+			tgame_entry& entry = game.second;
+			if(!entry.game || entry.busy) {
+				continue;
+			}
+
+			entry.busy = true;
+			entry.game->evict(
+					  tconfiguration::configuration().game_evict_time
+					, std::bind(
+						  &tlobby::evict_handler
+						, this
+						, game.first
+						, std::placeholders::_1));
+		}
+	}
+
+	start_evict_timer();
+}
+
+void
+tlobby::evict_handler(const std::string& id, const bool evicted)
+{
+	std::lock_guard<std::mutex> lock(games_mutex_);
+
+	tgame_entry& entry = games_.at(id);
+	entry.busy = false;
+
+	if(evicted) {
+		LOG_D("Evicted game »", id, "«.\n");
+		entry.game.reset();
+	}
+
+	if(entry.joining.empty()) {
+		return;
+	}
+
+	if(entry.game) {
+		for(tsession* session : entry.joining) {
+			entry.game->join(*session);
+			session->release();
+		}
+		entry.joining.clear();
+	} else {
+		load(id, entry);
+	}
+}
+
+void
+tlobby::start_snapshot_signal()
+{
+	snapshot_signal_.async_wait(std::bind(
+			  &tlobby::snapshot_signal_handler
+			, this
+			, std::placeholders::_1));
+}
+
+void
+tlobby::snapshot_signal_handler(const boost::system::error_code& error)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(error == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	snapshot();
+	start_snapshot_signal();
+}
+
+void
+tlobby::start_recorder_signal()
+{
+	recorder_signal_.async_wait(std::bind(
+			  &tlobby::recorder_signal_handler
+			, this
+			, std::placeholders::_1));
+}
+
+void
+tlobby::recorder_signal_handler(const boost::system::error_code& error)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
+
+	if(error == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	if(logging::recorder::dump()) {
+		LOG_I("Dumped the flight recorder.\n");
+	} else {
+		LOG_E("Failed to dump the flight recorder.\n");
+	}
+
+	start_recorder_signal();
+}
+
+/*
+ * The functions executed in the child of the snapshot.
+ *
+ * The child is a copy of a multi-threaded process, so these functions only
+ * use system calls. They shall not allocate memory, use the logger, the
+ * io_service or any lock.
+ */
+
+/** The number of records between two progress reports of the child. */
+static const size_t snapshot_progress_interval = 65536;
+
+/**
+ * Reports the progress of the snapshot.
+ *
+ * Executed in the child, so it doesn't log, but writes to the parent.
+ *
+ * @param progress                The write end of the progress pipe.
+ * @param prefix                  The text before the number of records.
+ * @param records                 The number of records written.
+ * @param suffix                  The text after the number of records,
+ *                                ending the line.
+ */
+static void
+report(const int progress
+		, const lib::tstring_view& prefix
+		, const size_t records
+		, const lib::tstring_view& suffix)
+{
+	game::trecord_writer::tnumber buffer;
+	const lib::tstring_view number = game::trecord_writer::format(
+			static_cast<uint32_t>(records), buffer);
+
+	for(const lib::tstring_view& text : {prefix, number, suffix}) {
+		if(::write(progress, text.data(), text.size()) == -1) {
+			/* The parent no longer listens, nothing to report to. */
+			return;
+		}
+	}
+}
+
+void
+tlobby::snapshot()
+{
+	LOG_T(__PRETTY_FUNCTION__, ".\n");
+
+	if(snapshot_ && snapshot_->is_running()) {
+		LOG_W("Snapshot: the previous snapshot is still running, "
+				"request ignored.\n");
+		return;
+	}
+
+	int progress[2];
+	if(::pipe(progress) != 0) {
+		LOG_E("Snapshot: failed to create a pipe message »"
+				, std::strerror(errno)
+				, "«.\n");
+		return;
+	}
+
+	/* The child doesn't allocate memory, so its texts are prepared here. */
+	const std::string filename =
+			tconfiguration::configuration().snapshot_directory
+			+ "/zard.snapshot";
+	const std::string temporary = filename + ".tmp";
+	const std::string suffix = "« records to »" + filename + "«\n";
+
+	const auto start = std::chrono::steady_clock::now();
+
+	/*
+	 * Only the forking thread exists in the child, so the other io threads
+	 * are parked to make sure they don't hold locks or are halfway a
+	 * handler when forking.
+	 */
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t parked = 0;
+	bool released = false;
+
+	for(size_t i = 0; i < threads_.size(); ++i) {
+		io_service_.post([&]()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				++parked;
+				condition.notify_all();
+				condition.wait(lock, [&]() { return released; });
+				--parked;
+				condition.notify_all();
+			});
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [&]() { return parked == threads_.size(); });
+	}
+
+	const auto quiesced = std::chrono::steady_clock::now();
+
+	/*
+	 * The lists are locked while forking, so the journal's thread doesn't
+	 * modify them halfway. The child inherits the locks, but doesn't use
+	 * them.
+	 */
+	pid_t pid;
+	{
+		std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+		std::lock_guard<std::mutex> games_lock(games_mutex_);
+		pid = ::fork();
+	}
+
+	if(pid == 0) {
+		::close(progress[0]);
+		::_exit(write_snapshot(filename, temporary, suffix, progress[1])
+				? EXIT_SUCCESS
+				: EXIT_FAILURE);
+	}
+
+	const auto forked = std::chrono::steady_clock::now();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		released = true;
+		condition.notify_all();
+		condition.wait(lock, [&]() { return parked == 0; });
+	}
+
+	::close(progress[1]);
+
+	if(pid == -1) {
+		LOG_E("Snapshot: failed to fork message »"
+				, std::strerror(errno)
+				, "«.\n");
+		::close(progress[0]);
+		return;
+	}
+
+	LOG_I("Snapshot: started process »"
+			, pid
+			, "«, quiescing »"
+			, std::chrono::duration_cast<std::chrono::microseconds>(
+				quiesced - start).count()
+			, "« µs, forking »"
+			, std::chrono::duration_cast<std::chrono::microseconds>(
+				forked - quiesced).count()
+			, "« µs, total pause »"
+			, std::chrono::duration_cast<std::chrono::microseconds>(
+				forked - start).count()
+			, "« µs.\n");
+
+	snapshot_.reset(new detail::tsnapshot(io_service_, pid, progress[0]));
+	snapshot_->run();
+}
+
+bool
+tlobby::write_snapshot(
+		  const std::string& filename
+		, const std::string& temporary
+		, const std::string& suffix
+		, const int progress) const
+{
+	const int fd = ::open(
+			  temporary.c_str()
+			, O_WRONLY | O_TRUNC | O_CREAT | O_CLOEXEC
+			, 0600);
+
+	if(fd == -1) {
+		report(progress, "failed after »", 0, suffix);
+		return false;
+	}
+
+	game::trecord_writer writer(fd);
+	serialize(writer, progress);
+
+	bool result = writer.flush() && ::fdatasync(fd) == 0;
+	result = ::close(fd) == 0 && result;
+	result = result && ::rename(temporary.c_str(), filename.c_str()) == 0;
+
+	report(progress
+			, result ? "written »" : "failed after »"
+			, writer.records()
+			, suffix);
+
+	return result;
+}
+
+void
+tlobby::serialize(game::trecord_writer& writer, const int progress) const
+{
+	writer.record({"zard", "1"});
+
+	for(const tsession& session : sessions_) {
+		session.serialize(writer);
+
+		if(writer.records() % snapshot_progress_interval == 0) {
+			report(progress, "serialised »", writer.records(), "« records\n");
+		}
+	}
+
+	for(const auto& game : games_) {
+		if(game.second.game) {
+			game.second.game->serialize(writer);
+		} else {
+			writer.record({"evicted", game.first});
+		}
+
+		if(writer.records() % snapshot_progress_interval == 0) {
+			report(progress, "serialised »", writer.records(), "« records\n");
+		}
+	}
+}
+
 static void
 loop(boost::asio::io_service& io_service)
 {
@@ -117,18 +667,38 @@ tlobby::run()
 {
 	LOG_T(__PRETTY_FUNCTION__, ".\n");
 
-	logging::module::set_async_mode(io_service_);
+	if(tconfiguration::configuration().log_ring_size != 0) {
+		logging::module::set_backend_mode(
+				  tconfiguration::configuration().log_ring_size
+				, tconfiguration::configuration().log_full_policy
+				, tconfiguration::configuration().log_deferred);
+	} else {
+		logging::module::set_async_mode(io_service_);
+	}
 
 	create_session();
 	listen();
 
 	session_reaper_.run();
 
+	if(journal_ && tconfiguration::configuration().game_evict_time != 0) {
+		start_evict_timer();
+	}
+
 	/* Start at thread 1 since the main appliction is the first thread. */
 	for(unsigned i = 1; i < tconfiguration::configuration().threads; ++i) {
 		threads_.push_back(std::thread(loop, std::ref(io_service_)));
 	}
 
+	/*
+	 * The snapshot parks the other threads, so only start waiting after all
+	 * threads are created.
+	 */
+	if(!tconfiguration::configuration().snapshot_directory.empty()) {
+		start_snapshot_signal();
+	}
+	start_recorder_signal();
+
 	loop(io_service_);
 }
 
@@ -150,6 +720,7 @@ tlobby::listen()
 {
 	LOG_T(__PRETTY_FUNCTION__, ".\n");
 
+	std::lock_guard<std::mutex> lock(sessions_mutex_);
 	sessions_.back().accept(acceptor_);
 }
 
@@ -158,13 +729,28 @@ tlobby::accept_handler(const boost::system::error_code& error)
 {
 	LOG_T(__PRETTY_FUNCTION__, ": error »", error.message(), "«.\n");
 
-	if(!error) {
-		LOG_D("Session: starting.\n");
-		sessions_.back().set_status(tsession::tstatus::connected);
-		sessions_.back().send("Zard\n1");
-		sessions_.back().receive();
+	{
+		/*
+		 * The accepting session is the last session, the reaper doesn't
+		 * reap it since it isn't connected yet.
+		 */
+		std::lock_guard<std::mutex> lock(sessions_mutex_);
+		tsession& session = sessions_.back();
+
+		if(!error && session.admit(admission_)) {
+			LOG_D("Session: starting.\n");
+			logging::recorder::record(
+					  logging::recorder::tevent::session_accept
+					, &session);
+
+			session.set_status(tsession::tstatus::connected);
+			session.send("Zard\n1");
+			session.receive();
+
+			create_session();
+		}
 
-		create_session();
+		/* Else reuse the session, a refused connection is already closed. */
 	}
 
 	listen();
@@ -188,63 +774,138 @@ tlobby::receive_handler(
 
 	VALIDATE(message);
 
-	switch(session.get_mode()) {
-		case tsession::tmode::connected :
-			execute_connected(session, message->contents());
-			break;
+	logging::recorder::record(
+			  logging::recorder::tevent::command_dispatched
+			, &session
+			, static_cast<uint64_t>(session.get_mode()));
 
-		case tsession::tmode::lobby :
-			execute_lobby(session, message->contents());
-			break;
+	const auto start = std::chrono::steady_clock::now();
 
-		case tsession::tmode::creating_game :
-			/*FAIL*/;
+	if(session.get_mode() == tsession::tmode::joining_game) {
+		session.send("EBUSY\nJoining a game.\n");
+	} else {
+		execute(session, message->contents());
 	}
+
+	logging::recorder::record(
+			  logging::recorder::tevent::handler_duration
+			, &session
+			, std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
 }
 
 void
-tlobby::execute_connected(tsession& session, std::string command)
+tlobby::add_commands()
 {
-	LOG_D("Connected: Execute '", command, "'\n");
-
-	static const std::string cmd_user = "user ";
-
-	try {
-		if(command.empty()) {
-			/* Do nothing. */
-		} else if(command == "help") {
-			session.send("OK\nNo help available.\n");
-		} else if(command.substr(0, cmd_user.length()) == cmd_user) {
-			user(session, command.substr(cmd_user.length()));
-		} else {
-			session.send("EINVAL\nUnknown command.\n");
-		}
-	} catch(...) {
-		session.send("ERROR\n");
-	}
+	typedef tsession::tmode tmode;
+	typedef tdispatcher::tbatch tbatch;
+
+	dispatcher_.add("help", 1, {tmode::connected, tmode::lobby}
+			, [](tsession& session, const targuments&)
+				-> lib::tresult
+			{
+				session.send("OK\nNo help available.\n");
+				return lib::tresult();
+			});
+
+	dispatcher_.add("encoding", 2, {tmode::connected, tmode::lobby}
+			, [](tsession& session, const targuments& arguments)
+				-> lib::tresult
+			{
+				tsession::tencoding encoding;
+				if(arguments.size() != 1) {
+					return invalid_arguments();
+				} else if(arguments[0] == "text") {
+					encoding = tsession::tencoding::text;
+				} else if(arguments[0] == "binary") {
+					encoding = tsession::tencoding::binary;
+				} else {
+					return invalid_arguments();
+				}
+
+				/* The message framing of the other protocols is text. */
+				if(encoding == tsession::tencoding::binary
+						&& session.get_protocol()
+							!= communication::tprotocol::basic) {
+
+					return lib::tresult(
+							  lib::texception::ttype::protocol_error
+							, "The binary encoding needs the basic protocol");
+				}
+
+				/* The reply is still in the old encoding. */
+				session.send("OK\n");
+				session.set_encoding(encoding);
+				return lib::tresult();
+			}
+			, tbatch::forbidden);
+
+	dispatcher_.add("user", 3, {tmode::connected}
+			, [this](tsession& session, const targuments& arguments)
+				-> lib::tresult
+			{
+				if(arguments.size() != 1 || arguments[0].empty()) {
+					return invalid_arguments();
+				}
+				return user(session, arguments[0].str());
+			});
+
+	dispatcher_.add("resume", 4, {tmode::connected}
+			, [this](tsession& session, const targuments& arguments)
+				-> lib::tresult
+			{
+				uint32_t last_seen;
+				if(arguments.size() != 2
+						|| !lib::parse(arguments[1], last_seen)) {
+
+					return invalid_arguments();
+				}
+
+				resume(session, arguments[0].str(), last_seen);
+				return lib::tresult();
+			}
+			, tbatch::forbidden);
+
+	dispatcher_.add("game create", 5, {tmode::lobby}
+			, [this](tsession& session, const targuments& arguments)
+				-> lib::tresult
+			{
+				if(arguments.size() != 1 || arguments[0].empty()) {
+					return invalid_arguments();
+				}
+				return game_create(session, arguments[0].str());
+			});
+
+	dispatcher_.add("game join", 6, {tmode::lobby}
+			, [this](tsession& session, const targuments& arguments)
+				-> lib::tresult
+			{
+				if(arguments.size() != 1 || arguments[0].empty()) {
+					return invalid_arguments();
+				}
+				return game_join(session, arguments[0].str());
+			}
+			, tbatch::forbidden);
+
+	dispatcher_.add("game list", 7, {tmode::lobby}
+			, [this](tsession& session, const targuments&)
+				-> lib::tresult
+			{
+				game_list(session);
+				return lib::tresult();
+			});
 }
 
 void
-tlobby::execute_lobby(tsession& session, std::string command)
+tlobby::execute(tsession& session, const lib::tstring_view& command)
 {
-	LOG_D("Lobby: Execute '", command, "'\n");
-
-	static const std::string cmd_game_create = "game create ";
-	static const std::string cmd_game_list = "game list";
-
+	LOG_D("Execute »", command, "« mode »"
+			, static_cast<unsigned>(session.get_mode()), "«.\n");
 
 	try {
-		if(command.empty()) {
-			/* Do nothing. */
-		} else if(command == "help") {
-			session.send("OK\nNo help available.\n");
-		} else if(command.substr(0, cmd_game_create.length())
-				== cmd_game_create) {
-			game_create(session, command.substr(cmd_game_create.length()));
-		} else if(command == cmd_game_list) {
-			game_list(session);
-		} else {
-			session.send("EINVAL\nUnknown command.\n");
+		const lib::tresult result = dispatcher_.dispatch(session, command);
+		if(!result) {
+			session.reply(result);
 		}
 	} catch(...) {
 		session.send("ERROR\n");
@@ -254,6 +915,7 @@ tlobby::execute_lobby(tsession& session, std::string command)
 void
 tlobby::create_session()
 {
+	/* The caller holds the lock, unless no other thread runs yet. */
 	sessions_.emplace_back(io_service_);
 
 	sessions_.back().set_accept_handler(std::bind(
@@ -15,12 +15,23 @@
 #ifndef MODULES_LOBBY_LOBBY_HPP_INCLUDED
 #define MODULES_LOBBY_LOBBY_HPP_INCLUDED
 
+#include "lib/exception/result.hpp"
 #include "modules/game/game.hpp"
+#include "modules/lobby/dispatcher.hpp"
 #include "modules/lobby/session.hpp"
+#include "modules/lobby/detail/admission.hpp"
 #include "modules/lobby/detail/session_reaper.hpp"
+#include "modules/lobby/detail/snapshot.hpp"
 
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/signal_set.hpp>
 
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -46,12 +57,61 @@ public:
 
 	/***** ***** Operators. ***** *****/
 
-	void
+	/**
+	 * Logs in a user.
+	 *
+	 * @param session             The session of the user.
+	 * @param id                  The id of the user.
+	 *
+	 * @returns                   The result, fails when the user is already
+	 *                            logged in.
+	 */
+	lib::tresult
 	user(tsession& session, const std::string& id);
 
+	/**
+	 * Resumes a disconnected session.
+	 *
+	 * Replies with the id of the last action received in the session, so
+	 * the client knows which actions to send again.
+	 *
+	 * @param session             The new session of the client.
+	 * @param token               The resumption token of the session.
+	 * @param last_seen           The id of the last message the client
+	 *                            received.
+	 */
 	void
+	resume(tsession& session
+			, const std::string& token
+			, const uint32_t last_seen);
+
+	/**
+	 * Creates a game.
+	 *
+	 * @param session             The session creating the game.
+	 * @param id                  The id of the game to create.
+	 *
+	 * @returns                   The result, fails when the game already
+	 *                            exists.
+	 */
+	lib::tresult
 	game_create(tsession& session, const std::string& id);
 
+	/**
+	 * Lets a session join a game.
+	 *
+	 * When the game is evicted the session waits in the
+	 * @ref tsession::tmode::joining_game mode until the game is loaded.
+	 *
+	 * @param session             The session joining the game.
+	 * @param id                  The id of the game to join.
+	 *
+	 * @returns                   The result, fails when the game doesn't
+	 *                            exist.
+	 */
+	lib::tresult
+	game_join(tsession& session, const std::string& id);
+
 	std::vector<std::string>
 	game_list() const;
 
@@ -73,14 +133,195 @@ private:
 
 	boost::asio::ip::tcp::acceptor acceptor_;
 
-	std::vector<game::tgame> games_{};
+	/**
+	 * The journal to store the games in.
+	 *
+	 * When @c nullptr the games are not stored.
+	 */
+	std::unique_ptr<game::tjournal> journal_{};
+
+	/** A game in the @ref games_ directory. */
+	struct tgame_entry
+	{
+		/**
+		 * The game.
+		 *
+		 * When @c nullptr the game is evicted and only this stub remains in
+		 * the directory.
+		 */
+		std::shared_ptr<game::tgame> game{};
+
+		/** Is the game being evicted or loaded? */
+		bool busy{false};
+
+		/**
+		 * The sessions waiting to join while the game is busy.
+		 *
+		 * The sessions are referenced, see @ref tsession::acquire().
+		 */
+		std::vector<tsession*> joining{};
+	};
+
+	/** Protects the @ref games_. */
+	mutable std::mutex games_mutex_{};
+
+	/**
+	 * The directory of the games on the server.
+	 *
+	 * The key is the id of the game. Only the games recently used are kept
+	 * in memory, the others are evicted to the @ref journal_ and loaded
+	 * again when a player joins.
+	 */
+	std::map<std::string, tgame_entry> games_{};
+
+	/** The dispatcher for the commands of the sessions in the lobby. */
+	tdispatcher dispatcher_{};
+
+	/** The timer to periodically evict the idle games. */
+	boost::asio::deadline_timer evict_timer_;
+
+	/**
+	 * The admission control of the new connections.
+	 *
+	 * Declared before the @ref sessions_, which refer to it.
+	 */
+	detail::tadmission admission_;
+
+	/**
+	 * Protects the @ref sessions_.
+	 *
+	 * When both are locked it's locked before the @ref games_mutex_.
+	 */
+	mutable std::mutex sessions_mutex_{};
 
 	std::list<tsession> sessions_{};
 
-	detail::tsession_reaper session_reaper_{io_service_, sessions_};
+	detail::tsession_reaper session_reaper_{
+			  io_service_
+			, sessions_
+			, sessions_mutex_};
 
 	std::vector<std::thread> threads_{};
 
+	/** The signal to request a snapshot of the server state. */
+	boost::asio::signal_set snapshot_signal_;
+
+	/** The last snapshot started, if any. */
+	std::unique_ptr<detail::tsnapshot> snapshot_{};
+
+	/** The signal to request a dump of the @ref logging::recorder. */
+	boost::asio::signal_set recorder_signal_;
+
+	/**
+	 * Recovers the games stored in the @ref journal_.
+	 *
+	 * Only a stub is added for every game, the games are loaded when a
+	 * player joins them.
+	 */
+	void
+	recover();
+
+	/**
+	 * Loads an evicted game from the @ref journal_.
+	 *
+	 * The journal is read and the game is recreated in the journal's thread,
+	 * so loading doesn't block the io_service. After loading the waiting
+	 * sessions join the game.
+	 *
+	 * @pre                       The @ref games_mutex_ is locked.
+	 *
+	 * @param id                  The id of the game to load.
+	 * @param entry               The entry of the game in @ref games_.
+	 */
+	void
+	load(const std::string& id, tgame_entry& entry);
+
+	/** The handler called after loading a game. */
+	void
+	load_handler(
+			  const std::string& id
+			, const std::chrono::steady_clock::time_point start
+			, const std::vector<game::tjournal::trecord>& records);
+
+	/** Starts the @ref evict_timer_. */
+	void
+	start_evict_timer();
+
+	/**
+	 * Tries to evict all games in memory.
+	 *
+	 * See @ref tconfiguration::game_evict_time.
+	 */
+	void
+	evict(const boost::system::error_code& error);
+
+	/** The handler called after trying to evict a game. */
+	void
+	evict_handler(const std::string& id, const bool evicted);
+
+	/** Waits for the next @ref snapshot_signal_. */
+	void
+	start_snapshot_signal();
+
+	/** The handler functor for the @ref snapshot_signal_. */
+	void
+	snapshot_signal_handler(const boost::system::error_code& error);
+
+	/** Waits for the next @ref recorder_signal_. */
+	void
+	start_recorder_signal();
+
+	/** The handler functor for the @ref recorder_signal_. */
+	void
+	recorder_signal_handler(const boost::system::error_code& error);
+
+	/**
+	 * Writes a snapshot of the server state.
+	 *
+	 * The other io threads are parked and the process forks. The child
+	 * serialises its copy-on-write image of the state to disk while the
+	 * parent continues serving. So the server only pauses for the time
+	 * needed to park the threads and to fork. This pause is logged.
+	 *
+	 * @pre                       The function is executed in an io thread.
+	 */
+	void
+	snapshot();
+
+	/**
+	 * Writes the snapshot to disk.
+	 *
+	 * Executed in the child of the snapshot, so it only uses system calls
+	 * and the memory on its stack.
+	 *
+	 * @param filename            The name of the snapshot.
+	 * @param temporary           The file to write the snapshot to, it's
+	 *                            renamed to @p filename after writing.
+	 * @param suffix              The text after the number of records in
+	 *                            the result reported.
+	 * @param progress            The write end of the progress pipe.
+	 *
+	 * @returns                   Whether the snapshot is written.
+	 */
+	bool
+	write_snapshot(
+			  const std::string& filename
+			, const std::string& temporary
+			, const std::string& suffix
+			, const int progress) const;
+
+	/**
+	 * Serialises the state of the server.
+	 *
+	 * @pre                       The process is the child of the snapshot,
+	 *                            so no other thread modifies the state.
+	 *
+	 * @param writer              The writer to write the records with.
+	 * @param progress            The write end of the progress pipe.
+	 */
+	void
+	serialize(game::trecord_writer& writer, const int progress) const;
+
 	void
 	run();
 
@@ -99,11 +340,18 @@ private:
 			, const boost::system::error_code& error
 			, const communication::tmessage* message);
 
+	/** Adds the commands of the lobby to the @ref dispatcher_. */
 	void
-	execute_connected(tsession& session, std::string command);
+	add_commands();
 
+	/**
+	 * Executes a command.
+	 *
+	 * @param session             The session sending the command.
+	 * @param command             The command to be executed.
+	 */
 	void
-	execute_lobby(tsession& session, std::string command);
+	execute(tsession& session, const lib::tstring_view& command);
 
 	void
 	create_session();
@@ -16,7 +16,17 @@
 
 #include "modules/lobby/session.hpp"
 
+#include "lib/exception/validate.tpp"
+#include "modules/communication/message.hpp"
+#include "modules/game/record_writer.hpp"
+#include "modules/lobby/binary.hpp"
+#include "modules/lobby/detail/quota.hpp"
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
+#include "zard/configuration.hpp"
+
+#include <algorithm>
+#include <random>
 
 namespace lobby {
 
@@ -42,6 +52,11 @@ tsession::tsession(boost::asio::io_service& io_service)
 			, std::placeholders::_2
 			, std::placeholders::_3));
 
+	socket_.set_throttle_handler(std::bind(
+			  &tsession::session_throttle_handler
+			, this
+			, std::placeholders::_1));
+
 	socket_.strand_enable(io_service);
 }
 
@@ -51,10 +66,86 @@ tsession::accept(boost::asio::ip::tcp::acceptor& acceptor)
 	socket_.accept(acceptor);
 }
 
+/** The number of pauses of all sessions. */
+static std::atomic<uint64_t> total_throttle_pauses{0};
+
+/** The total pause time of all sessions, in nanoseconds. */
+static std::atomic<uint64_t> total_throttle_time{0};
+
+/** The capture of the messages, sent by the current thread. */
+static __thread tsession::tcapture* active_capture = nullptr;
+
+tsession::tcapture::tcapture(const tsession& session, std::string& buffer)
+	: session_(session)
+	, buffer_(buffer)
+	, previous_(active_capture)
+{
+	active_capture = this;
+}
+
+tsession::tcapture::~tcapture()
+{
+	active_capture = previous_;
+}
+
+bool
+tsession::tcapture::capture(const tsession& session, const std::string& data)
+{
+	if(!active_capture || &active_capture->session_ != &session) {
+		return false;
+	}
+
+	active_capture->buffer_ += data;
+	return true;
+}
+
 void
-tsession::send(const std::string& data)
+tsession::send(
+		  const std::string& data
+		, const communication::tpriority priority
+		, const communication::tconflation_key key)
 {
-	socket_.send_action(data);
+	if(tcapture::capture(*this, data)) {
+		return;
+	}
+
+	if(encoding_ == tencoding::binary) {
+		send_encoded(binary::encode_reply(data), priority, key);
+	} else {
+		send_encoded(data, priority, key);
+	}
+}
+
+void
+tsession::send_encoded(
+		  const std::string& data
+		, const communication::tpriority priority
+		, const communication::tconflation_key key)
+{
+	/* The message is stored in the replay ring when it's sent. */
+	socket_.send_action(data, priority, key);
+}
+
+void
+tsession::reply(const lib::tresult& result)
+{
+	LOG_D("Command failed »", result.detail(), "«.\n");
+
+	send(result.reply());
+}
+
+bool
+tsession::admit(detail::tadmission& admission)
+{
+	address_ = socket_.get_remote_address();
+
+	if(!admission.admit(address_)) {
+		socket_.close();
+		return false;
+	}
+
+	admission_ = &admission;
+	return true;
 }
 
 void
@@ -63,6 +154,148 @@ tsession::receive()
 	socket_.receive();
 }
 
+std::string
+tsession::create_token()
+{
+	static const char digits[] = "0123456789abcdef";
+
+	std::random_device random;
+
+	std::string token;
+	for(int i = 0; i < 4; ++i) {
+		uint32_t value = random();
+		for(int j = 0; j < 8; ++j) {
+			token += digits[value & 0x0f];
+			value >>= 4;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(state_mutex_);
+	token_ = token;
+	return token;
+}
+
+bool
+tsession::is_resumable() const
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+
+	return status_ == tstatus::disconnected
+			&& !token_.empty()
+			&& std::chrono::steady_clock::now() - disconnected_at_
+				< std::chrono::seconds(
+					tconfiguration::configuration().session_grace_time);
+}
+
+void
+tsession::expire()
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+
+	LOG_D("Session »", id_, "« expired.\n");
+
+	token_.clear();
+	game_.clear();
+	status_ = tstatus::reapable;
+}
+
+bool
+tsession::resume(tsession& previous, const uint32_t last_seen)
+{
+	LOG_T(__PRETTY_FUNCTION__, ": last_seen »", last_seen, "«.\n");
+
+	std::lock_guard<std::mutex> lock(replay_mutex_);
+	std::lock_guard<std::mutex> previous_lock(previous.replay_mutex_);
+	std::lock_guard<std::mutex> state_lock(state_mutex_);
+	std::lock_guard<std::mutex> previous_state_lock(previous.state_mutex_);
+
+	/* Another session can resume or expire the session concurrently. */
+	if(previous.status_ != tstatus::disconnected || previous.token_.empty()) {
+		return false;
+	}
+
+	std::deque<std::pair<uint32_t, std::string>>& replay = previous.replay_;
+	if(replay.empty()
+			|| last_seen + 1 < replay.front().first
+			|| last_seen > replay.back().first) {
+
+		return false;
+	}
+
+	id_ = previous.id_;
+	token_ = previous.token_;
+	game_ = previous.game_;
+	mode_ = tmode::lobby;
+
+	/* The replayed messages are in the encoding of the previous session. */
+	encoding_ = previous.encoding_.load();
+
+	previous.token_.clear();
+	previous.game_.clear();
+	previous.status_ = tstatus::reapable;
+
+	/*
+	 * Continue the ids so the replayed messages keep their original id.
+	 * The replayed messages are stored in the ring again when they're sent,
+	 * the send handler waits for the lock held here.
+	 */
+	socket_.set_last_action_id(last_seen);
+
+	replay_.clear();
+	size_t replayed = 0;
+	for(const auto& message : replay) {
+		if(message.first > last_seen) {
+			socket_.send_action(message.second);
+			++replayed;
+		} else {
+			replay_.push_back(message);
+		}
+	}
+
+	replay.clear();
+
+	LOG_D("Resumed session »"
+			, id_
+			, "« replayed »"
+			, replayed
+			, "« messages.\n");
+
+	return true;
+}
+
+void
+tsession::acquire()
+{
+	++references_;
+}
+
+void
+tsession::release()
+{
+	--references_;
+}
+
+bool
+tsession::is_referenced() const
+{
+	return references_ != 0;
+}
+
+void
+tsession::serialize(game::trecord_writer& writer) const
+{
+	game::trecord_writer::tnumber status;
+	game::trecord_writer::tnumber mode;
+
+	writer.record({
+			  "session"
+			, id_
+			, game::trecord_writer::format(
+				static_cast<uint32_t>(status_.load()), status)
+			, game::trecord_writer::format(
+				static_cast<uint32_t>(mode_.load()), mode)});
+}
+
 tsession::tstatus
 tsession::get_status() const
 {
@@ -88,18 +321,96 @@ tsession::get_mode() const
 	return mode_;
 }
 
+void
+tsession::set_encoding(const tencoding encoding__)
+{
+	encoding_ = encoding__;
+}
+
+tsession::tencoding
+tsession::get_encoding() const
+{
+	return encoding_;
+}
+
+communication::tprotocol
+tsession::get_protocol() const
+{
+	return socket_.get_protocol();
+}
+
+uint64_t
+tsession::get_throttle_pauses() const
+{
+	return throttle_pauses_;
+}
+
+uint64_t
+tsession::get_throttle_time() const
+{
+	return throttle_time_;
+}
+
+uint64_t
+tsession::get_total_throttle_pauses()
+{
+	return total_throttle_pauses;
+}
+
+uint64_t
+tsession::get_total_throttle_time()
+{
+	return total_throttle_time;
+}
+
 std::string
 tsession::get_id() const
 {
+	std::lock_guard<std::mutex> lock(state_mutex_);
 	return id_;
 }
 
 void
 tsession::set_id(const std::string& id__)
 {
+	std::lock_guard<std::mutex> lock(state_mutex_);
 	id_ = id__;
 }
 
+std::string
+tsession::get_token() const
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+	return token_;
+}
+
+std::chrono::steady_clock::time_point
+tsession::get_disconnected_at() const
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+	return disconnected_at_;
+}
+
+uint32_t
+tsession::get_last_received_id() const
+{
+	return last_received_id_;
+}
+
+std::string
+tsession::get_game() const
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+	return game_;
+}
+
+void
+tsession::set_game(const std::string& game__)
+{
+	std::lock_guard<std::mutex> lock(state_mutex_);
+	game_ = game__;
+}
+
 void
 tsession::set_accept_handler(communication::taccept_handler accept_handler__)
 {
@@ -115,9 +426,29 @@ tsession::set_send_handler(communication::tsend_handler send_handler__)
 void
 tsession::set_receive_handler(communication::treceive_handler receiv_handler__)
 {
+	std::lock_guard<std::mutex> lock(receive_handler_mutex_);
 	receive_handler_ = receiv_handler__;
 }
 
+void
+tsession::disconnect()
+{
+	logging::recorder::record(
+			  logging::recorder::tevent::session_close
+			, this);
+
+	{
+		std::lock_guard<std::mutex> lock(state_mutex_);
+		disconnected_at_ = std::chrono::steady_clock::now();
+		status_ = token_.empty() ? tstatus::reapable : tstatus::disconnected;
+	}
+
+	if(admission_) {
+		admission_->release(address_);
+		admission_ = nullptr;
+	}
+}
+
 void
 tsession::session_accept_handler(const boost::system::error_code& error)
 {
@@ -147,24 +478,103 @@ tsession::session_receive_handler(
 			, "« message.data »", message ? message->contents() : "NULL"
 			, "«.\n");
 
-	if(receive_handler_) {
-		receive_handler_(error, bytes_transferred, message);
+	if(!error
+			&& message->type() == communication::tmessage::ttype::action
+			&& message->id() != 0) {
+
+		if(message->id() <= last_received_id_) {
+			LOG_D("Ignoring duplicate message »", message->id(), "«.\n");
+			return;
+		}
+		last_received_id_ = message->id();
+	}
+
+	communication::treceive_handler receive_handler;
+	{
+		std::lock_guard<std::mutex> lock(receive_handler_mutex_);
+		receive_handler = receive_handler_;
+	}
+
+	if(receive_handler) {
+		receive_handler(error, bytes_transferred, message);
 	}
 
 	if(error) {
 		if(error == boost::asio::error::eof) {
 			LOG_I("Client disconnected.\n");
-			status_ = tstatus::disconnected;
+			disconnect();
 		} else if(error) {
 			LOG_E("Error »"
 					, error.message()
 					, "« while receiving data, connection closed.\n");
-			status_ = tstatus::disconnected;
+			disconnect();
 		}
 		return;
 	}
 }
 
+/**
+ * Returns the quota of a mode.
+ *
+ * @param mode                    The mode of the session.
+ *
+ * @returns                       The quota.
+ */
+static const tconfiguration::tquota&
+quota(const tsession::tmode mode)
+{
+	const tconfiguration& configuration = tconfiguration::configuration();
+
+	switch(mode) {
+		case tsession::tmode::connected :
+			return configuration.quota_connected;
+
+		case tsession::tmode::lobby :
+			return configuration.quota_lobby;
+
+		case tsession::tmode::creating_game :
+		case tsession::tmode::joining_game :
+		case tsession::tmode::playing_game :
+			return configuration.quota_game;
+	}
+
+	ENUM_FAIL_OUTPUT(mode);
+}
+
+std::chrono::nanoseconds
+tsession::session_throttle_handler(const size_t bytes_transferred)
+{
+	const tconfiguration::tquota& limit = quota(mode_);
+	const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	const int64_t pause = std::max(
+			  detail::charge(message_arrival_
+				, 1
+				, limit.message_rate
+				, limit.message_burst
+				, now)
+			, detail::charge(byte_arrival_
+				, bytes_transferred
+				, limit.byte_rate
+				, limit.byte_burst
+				, now));
+
+	if(pause != 0) {
+		logging::recorder::record(
+				  logging::recorder::tevent::session_throttled
+				, this
+				, static_cast<uint64_t>(pause));
+
+		++throttle_pauses_;
+		throttle_time_ += static_cast<uint64_t>(pause);
+		++total_throttle_pauses;
+		total_throttle_time += static_cast<uint64_t>(pause);
+	}
+
+	return std::chrono::nanoseconds(pause);
+}
+
 void
 tsession::session_send_handler(
 		  const boost::system::error_code& error
@@ -178,10 +588,27 @@ tsession::session_send_handler(
 			, "« message.data »", message.contents()
 			, "«.\n");
 
+	/*
+	 * The id of an action message is assigned when it's sent, so the ring
+	 * stores it here. Messages that failed to be sent are stored as well,
+	 * so a resumed session sends them again.
+	 */
+	if(message.type() == communication::tmessage::ttype::action) {
+		std::lock_guard<std::mutex> lock(replay_mutex_);
+
+		const size_t size
+				= tconfiguration::configuration().session_replay_size;
+
+		replay_.push_back(std::make_pair(message.id(), message.contents()));
+		while(replay_.size() > size) {
+			replay_.pop_front();
+		}
+	}
+
 	if(error) {
 //		LOG_E(); eof or is it pipe???
 		socket_.close();
-		status_ = tstatus::reapable;
+		disconnect();
 		return;
 	}
 
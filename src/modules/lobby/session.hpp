@@ -15,10 +15,47 @@
 #ifndef MODULES_LOBBY_SESSION_HPP_INCLUDED
 #define MODULES_LOBBY_SESSION_HPP_INCLUDED
 
+#include "lib/exception/result.hpp"
 #include "modules/communication/tcp_socket.hpp"
+#include "modules/lobby/detail/admission.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace game {
+
+class trecord_writer;
+
+} // namespace game
 
 namespace lobby {
 
+/**
+ * A session of a user on the server.
+ *
+ * When a user logs in the session gets a resumption token. The last
+ * @ref tconfiguration::session_replay_size messages sent are kept in a
+ * replay ring; a message is stored when it's sent, since its id is assigned
+ * then. After the connection drops the session is kept for
+ * @ref tconfiguration::session_grace_time seconds, during which a new
+ * connection can take over the session with @ref resume(). The new
+ * connection then only receives the messages the client missed.
+ *
+ * The ids of the actions received are tracked and duplicates are ignored.
+ * The ids are per connection, so a resumed session starts tracking again;
+ * the reply to the resume contains the id of the last action received in
+ * the previous connection, so the client knows which actions to send
+ * again.
+ *
+ * Other objects, e.g. a game, can keep a pointer to the session. They add
+ * a reference with @ref acquire(), a referenced session is not reaped.
+ *
+ * The messages received are limited by the quota of the session's mode, see
+ * @ref tconfiguration::tquota. When the session is over its quota receiving
+ * is paused until the session is within its quota again.
+ */
 class tsession final
 {
 public:
@@ -38,8 +75,70 @@ public:
 		  connected /* Directly after connecting. */
 		, lobby /* After logging in */
 		, creating_game /* creator */
-//		, joining_game /* others */
-//		, playing_game
+		, joining_game /* others, while the game is loaded */
+		, playing_game
+	};
+
+	/** The encoding of the commands and replies, see binary.hpp. */
+	enum class tencoding
+	{
+		  text
+		, binary
+	};
+
+	/**
+	 * Captures the messages sent to a session.
+	 *
+	 * While the capture exists the messages the current thread sends to the
+	 * session are appended to a buffer instead of being sent. Messages sent
+	 * by other threads, e.g. the updates of a game, are sent as usual. This
+	 * allows a batch of commands to combine their replies, see
+	 * @ref tdispatcher::dispatch().
+	 */
+	class tcapture final
+	{
+	public:
+
+		/**
+		 * Constructor.
+		 *
+		 * @param session         The session whose messages to capture.
+		 * @param buffer          The buffer to append the messages to, in
+		 *                        the text encoding.
+		 */
+		tcapture(const tsession& session, std::string& buffer);
+
+		~tcapture();
+
+		tcapture&
+		operator=(const tcapture&) = delete;
+		tcapture(const tcapture&) = delete;
+
+		tcapture&
+		operator=(tcapture&&) = delete;
+		tcapture(tcapture&&) = delete;
+
+		/**
+		 * Captures a message, if captured by the current thread.
+		 *
+		 * @param session         The session sending the message.
+		 * @param data            The message to send.
+		 *
+		 * @returns               Whether the message is captured.
+		 */
+		static bool
+		capture(const tsession& session, const std::string& data);
+
+	private:
+
+		/** The session whose messages are captured. */
+		const tsession& session_;
+
+		/** The buffer receiving the messages. */
+		std::string& buffer_;
+
+		/** The capture active in the thread when this one was created. */
+		tcapture* previous_;
 	};
 
 
@@ -63,12 +162,129 @@ public:
 	void
 	accept(boost::asio::ip::tcp::acceptor& acceptor);
 
+	/**
+	 * Sends a message.
+	 *
+	 * @param data                The message in the text encoding, it's
+	 *                            converted to the @ref encoding_ of the
+	 *                            session.
+	 * @param priority            The priority of the message, by default a
+	 *                            reply to a command.
+	 * @param key                 The conflation key of the message, a
+	 *                            queued message with the same key isn't
+	 *                            sent. Only for messages which contain the
+	 *                            entire state, not for changes.
+	 */
 	void
-	send(const std::string& data);
+	send(
+			  const std::string& data
+			, const communication::tpriority priority
+				= communication::tpriority::control
+			, const communication::tconflation_key key = 0);
+
+	/**
+	 * Admits the accepted connection.
+	 *
+	 * When admitted the connection is released when the session
+	 * disconnects, else the connection is closed.
+	 *
+	 * @param admission           The admission control of the server.
+	 *
+	 * @returns                   Whether the connection is admitted.
+	 */
+	bool
+	admit(detail::tadmission& admission);
+
+	/**
+	 * Replies with a failed result.
+	 *
+	 * The detail of the failure is only logged at the debug level.
+	 *
+	 * @param result              The failed result.
+	 */
+	void
+	reply(const lib::tresult& result);
 
 	void
 	receive();
 
+	/**
+	 * Creates a new resumption token for the session.
+	 *
+	 * @returns                   The token.
+	 */
+	std::string
+	create_token();
+
+	/**
+	 * Can the session be resumed?
+	 *
+	 * @returns                   Whether the session is disconnected and
+	 *                            still in its grace period.
+	 */
+	bool
+	is_resumable() const;
+
+	/**
+	 * Ends the grace period of a disconnected session.
+	 *
+	 * Used when the user logs in again without resuming. Afterwards the
+	 * session can no longer be resumed and is reapable.
+	 */
+	void
+	expire();
+
+	/**
+	 * Takes over a disconnected session.
+	 *
+	 * The state of @p previous is moved to this session and the messages
+	 * after @p last_seen in its replay ring are sent again. Afterwards
+	 * @p previous is reapable.
+	 *
+	 * The id of the last action received is not taken over, the actions
+	 * of the new connection are numbered from the start again.
+	 *
+	 * @param previous            The session to resume.
+	 * @param last_seen           The id of the last message the client
+	 *                            received in the previous session.
+	 *
+	 * @returns                   Whether the session is resumed. This fails
+	 *                            when the missed messages are no longer in
+	 *                            the replay ring.
+	 */
+	bool
+	resume(tsession& previous, const uint32_t last_seen);
+
+	/**
+	 * Adds a reference to the session.
+	 *
+	 * A referenced session is not reaped, so a pointer to the session stays
+	 * valid until the reference is released.
+	 */
+	void
+	acquire();
+
+	/** Releases a reference added by @ref acquire(). */
+	void
+	release();
+
+	/** Returns whether the session has references. */
+	bool
+	is_referenced() const;
+
+	/**
+	 * Writes the session as a record of a snapshot.
+	 *
+	 * The session is read without locking, so it can be written in the
+	 * child of a fork, see @ref game::trecord_writer.
+	 *
+	 * @pre                       No other thread modifies the session.
+	 *
+	 * @param writer              The writer to write the record with.
+	 */
+	void
+	serialize(game::trecord_writer& writer) const;
+
 	/***** ***** Setters, getters. ***** *****/
 
 	tstatus
@@ -83,12 +299,52 @@ public:
 	tmode
 	get_mode() const;
 
+	void
+	set_encoding(const tencoding encoding__);
+
+	tencoding
+	get_encoding() const;
+
+	communication::tprotocol
+	get_protocol() const;
+
+	/** Returns the number of times receiving was paused. */
+	uint64_t
+	get_throttle_pauses() const;
+
+	/** Returns the total time receiving was paused, in nanoseconds. */
+	uint64_t
+	get_throttle_time() const;
+
+	/** Returns the number of pauses of all sessions since the start. */
+	static uint64_t
+	get_total_throttle_pauses();
+
+	/** Returns the total pause time of all sessions, in nanoseconds. */
+	static uint64_t
+	get_total_throttle_time();
+
 	std::string
 	get_id() const;
 
 	void
 	set_id(const std::string& id__);
 
+	std::string
+	get_token() const;
+
+	std::chrono::steady_clock::time_point
+	get_disconnected_at() const;
+
+	uint32_t
+	get_last_received_id() const;
+
+	std::string
+	get_game() const;
+
+	void
+	set_game(const std::string& game__);
+
 	void
 	set_accept_handler(communication::taccept_handler accept_handler__);
 
@@ -104,14 +360,83 @@ private:
 
 	/***** Status. *****/
 
-	tstatus status_{tstatus::wait_for_connection};
+	/**
+	 * The status of the session.
+	 *
+	 * The status is read by the reaper and the sessions resuming or logging
+	 * in, in another thread than the one executing the session.
+	 */
+	std::atomic<tstatus> status_{tstatus::wait_for_connection};
 
 	unsigned protocol_version{1};
 
-	tmode mode_{tmode::connected};
+	/**
+	 * The mode of the session.
+	 *
+	 * The mode is changed by the game when a join is completed, which may
+	 * happen in another thread than the one executing the session.
+	 */
+	std::atomic<tmode> mode_{tmode::connected};
+
+	/**
+	 * The encoding of the commands and replies.
+	 *
+	 * Like the @ref mode_ it's read by the game executing the commands of
+	 * the session.
+	 */
+	std::atomic<tencoding> encoding_{tencoding::text};
+
+	/**
+	 * Protects the @ref id_, @ref token_, @ref disconnected_at_ and
+	 * @ref game_.
+	 *
+	 * They are used by other sessions, e.g. when resuming, and by the games.
+	 */
+	mutable std::mutex state_mutex_{};
 
 	std::string id_{};
 
+	/** The resumption token, empty when not logged in. */
+	std::string token_{};
+
+	/** The time the connection dropped. */
+	std::chrono::steady_clock::time_point disconnected_at_{};
+
+	/** The id of the game the session plays in, empty if none. */
+	std::string game_{};
+
+	/** The number of references, see @ref acquire(). */
+	std::atomic<unsigned> references_{0};
+
+
+	/***** Quota. *****/
+
+	/**
+	 * The theoretical arrival time of the next message.
+	 *
+	 * The quota are implemented as a generic cell rate algorithm, which is
+	 * equivalent to a token bucket but only needs to store one time per
+	 * bucket. The time is in nanoseconds since the epoch of the
+	 * @c std::chrono::steady_clock.
+	 */
+	int64_t message_arrival_{0};
+
+	/** The theoretical arrival time of the next byte. */
+	int64_t byte_arrival_{0};
+
+	/** The number of times receiving was paused. */
+	std::atomic<uint64_t> throttle_pauses_{0};
+
+	/** The total time receiving was paused, in nanoseconds. */
+	std::atomic<uint64_t> throttle_time_{0};
+
+
+	/** The admission of the connection, @c nullptr if not admitted. */
+	detail::tadmission* admission_{nullptr};
+
+	/** The remote address of the connection. */
+	boost::asio::ip::address address_{};
+
 
 	/***** Data transmission. *****/
 
@@ -123,9 +448,60 @@ private:
 	/** The send handler for the user of this class .*/
 	communication::tsend_handler send_handler_{};
 
-	/** The receive handler for the user of this class .*/
+	/** Protects the @ref receive_handler_. */
+	std::mutex receive_handler_mutex_{};
+
+	/**
+	 * The receive handler for the user of this class .
+	 *
+	 * The handler is replaced when joining a game, which may happen in
+	 * another thread than the one receiving the messages.
+	 */
 	communication::treceive_handler receive_handler_{};
 
+	/** Protects the @ref replay_. */
+	mutable std::mutex replay_mutex_{};
+
+	/**
+	 * The last action messages sent.
+	 *
+	 * The first member is the id of the message the second the message.
+	 */
+	std::deque<std::pair<uint32_t, std::string>> replay_{};
+
+	/**
+	 * The id of the last action message received.
+	 *
+	 * Only used when the protocol has message ids. It's written by the
+	 * receive handler and read when resuming the session.
+	 */
+	std::atomic<uint32_t> last_received_id_{0};
+
+	/**
+	 * Sends a message.
+	 *
+	 * The message is stored in the @ref replay_ by the send handler, once
+	 * it has its id.
+	 *
+	 * @param data                The encoded message.
+	 * @param priority            The priority of the message.
+	 * @param key                 The conflation key of the message.
+	 */
+	void
+	send_encoded(
+			  const std::string& data
+			, const communication::tpriority priority
+			, const communication::tconflation_key key);
+
+	/**
+	 * Marks the session disconnected.
+	 *
+	 * A session without a token can't be resumed, so it's directly
+	 * reapable. The connection is released from its admission.
+	 */
+	void
+	disconnect();
+
 	/** The accept handler for the session .*/
 	void
 	session_accept_handler(const boost::system::error_code& error);
@@ -137,6 +513,14 @@ private:
 			, const size_t bytes_transferred
 			, const communication::tmessage* message);
 
+	/**
+	 * The throttle handler for the session.
+	 *
+	 * Charges the message to the quota of the session's mode.
+	 */
+	std::chrono::nanoseconds
+	session_throttle_handler(const size_t bytes_transferred);
+
 	/** The send handler for the session .*/
 	void
 	session_send_handler(
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/logging/backend.hpp"
+
+#include "lib/string/concatenate.tpp"
+#include "modules/logging/module.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace logging {
+
+/** The ring of a thread, cached to avoid the lock in @ref tbackend::ring(). */
+struct tthread_ring
+{
+	/** The id of the backend owning the ring, @c 0 if none. */
+	unsigned backend;
+
+	/** The ring. */
+	void* ring;
+};
+
+/*
+ * Use @c __thread instead of @c thread_local, since the latter isn't
+ * supported by gcc-4.7. It's limited to POD types, hence the @c void*.
+ */
+static __thread tthread_ring thread_ring = {0, nullptr};
+
+const unsigned tbackend::flush_interval;
+
+/** The last id used for a @ref tbackend. */
+static std::atomic<unsigned> last_id{0};
+
+/** Returns the smallest power of 2 not less than @p value. */
+static size_t
+round_up(const size_t value)
+{
+	size_t result = 1;
+	while(result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+tbackend::tring::tring(const size_t capacity)
+	: entries(capacity)
+{
+}
+
+tbackend::tbackend(
+		  const size_t capacity
+		, const tfull_policy policy__
+		, const twrite_function& write_function__)
+	: id_(++last_id)
+	, mask_(round_up(capacity) - 1)
+	, policy_(policy__)
+	, write_function_(write_function__)
+	, thread_(&tbackend::run, this)
+{
+}
+
+tbackend::~tbackend()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	condition_.notify_one();
+	thread_.join();
+}
+
+bool
+tbackend::push(
+		  const unsigned module
+		, const tlevel level
+		, std::string&& message)
+{
+	tentry* entry = acquire();
+	if(!entry) {
+		return false;
+	}
+
+	entry->module = module;
+	entry->level = level;
+	entry->format = nullptr;
+	entry->message = std::move(message);
+
+	publish();
+
+	return true;
+}
+
+tbackend::tentry*
+tbackend::acquire()
+{
+	tring& ring = this->ring();
+
+	const size_t head = ring.head.load(std::memory_order_relaxed);
+	auto is_full = [&]()
+		{
+			return head - ring.tail.load(std::memory_order_acquire) > mask_;
+		};
+
+	if(is_full()) {
+		if(policy_ != tfull_policy::block) {
+			++dropped_;
+			return nullptr;
+		}
+
+		/* A full ring is half full, so the writer thread is already woken. */
+		std::unique_lock<std::mutex> lock(mutex_);
+		space_.wait(lock, [&]()
+			{
+				return !is_full();
+			});
+	}
+
+	return &ring.entries[head & mask_];
+}
+
+void
+tbackend::publish()
+{
+	tring& ring = *static_cast<tring*>(thread_ring.ring);
+
+	const size_t head = ring.head.load(std::memory_order_relaxed) + 1;
+	ring.head.store(head, std::memory_order_release);
+
+	/* Pairs with the fence in run(), so either sees the other's store. */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(sleeping_.load(std::memory_order_relaxed)) {
+		wake_sleeping();
+	}
+
+	/* Don't wait for the flush interval when the ring fills up. */
+	if(head - ring.tail.load(std::memory_order_relaxed) == (mask_ + 1) / 2) {
+		wake();
+	}
+}
+
+uint64_t
+tbackend::get_dropped() const
+{
+	return dropped_total_ + dropped_;
+}
+
+tbackend::tring&
+tbackend::ring()
+{
+	if(thread_ring.backend != id_) {
+		std::shared_ptr<tring> ring(new tring(mask_ + 1));
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			rings_.push_back(ring);
+		}
+
+		/* The ring of an earlier backend is no longer used. */
+		std::shared_ptr<tring>* owner = static_cast<std::shared_ptr<tring>*>(
+				pthread_getspecific(ring_key()));
+
+		if(owner) {
+			(*owner)->abandoned = true;
+			*owner = ring;
+		} else {
+			pthread_setspecific(ring_key(), new std::shared_ptr<tring>(ring));
+		}
+
+		thread_ring.backend = id_;
+		thread_ring.ring = ring.get();
+	}
+
+	return *static_cast<tring*>(thread_ring.ring);
+}
+
+pthread_key_t
+tbackend::ring_key()
+{
+	/* Shared by all backends, since a key can't be deleted safely. */
+	struct tkey
+	{
+		tkey()
+			: key()
+		{
+			pthread_key_create(&key, &tbackend::release_ring);
+		}
+
+		pthread_key_t key;
+	};
+
+	static tkey key;
+	return key.key;
+}
+
+void
+tbackend::release_ring(void* ring)
+{
+	std::shared_ptr<tring>* owner = static_cast<std::shared_ptr<tring>*>(ring);
+	(*owner)->abandoned = true;
+	delete owner;
+}
+
+void
+tbackend::wake()
+{
+	condition_.notify_one();
+}
+
+void
+tbackend::wake_sleeping()
+{
+	if(sleeping_.exchange(false)) {
+		/* The writer thread holds the lock until it waits. */
+		std::lock_guard<std::mutex> lock(mutex_);
+		condition_.notify_one();
+	}
+}
+
+bool
+tbackend::is_empty() const
+{
+	for(const auto& ring : rings_) {
+		if(ring->head.load(std::memory_order_relaxed)
+				!= ring->tail.load(std::memory_order_relaxed)) {
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+tbackend::run()
+{
+	std::vector<tentry> batch;
+
+	while(true) {
+		/* Read before draining, so the last messages are also written. */
+		const bool stop = stop_;
+
+		drain(batch);
+
+		const uint64_t dropped = dropped_.exchange(0);
+		if(dropped != 0) {
+			dropped_total_ += dropped;
+			if(policy_ == tfull_policy::count) {
+				tentry entry;
+				entry.module = module::id("logging");
+				entry.level = tlevel::warning;
+				entry.message = lib::concatenate(
+						  "Dropped »"
+						, dropped
+						, "« log messages, the ring is full.\n");
+
+				batch.push_back(std::move(entry));
+			}
+		}
+
+		if(!batch.empty()) {
+			write_function_(batch);
+			batch.clear();
+		}
+
+		if(stop) {
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		/* Sleep until a producer queues the next message. */
+		sleeping_ = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(!stop_ && is_empty()) {
+			condition_.wait(lock, [this]()
+				{
+					return !sleeping_ || stop_;
+				});
+		}
+		sleeping_ = false;
+
+		/*
+		 * Wait for more messages to write in the batch. The producers wake
+		 * the thread without holding the lock, so a wake-up can be missed,
+		 * which only delays the batch until the flush interval expires.
+		 */
+		if(!stop_) {
+			condition_.wait_for(
+					  lock
+					, std::chrono::milliseconds(flush_interval));
+		}
+	}
+}
+
+void
+tbackend::drain(std::vector<tentry>& batch)
+{
+	std::vector<tring*> rings;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(const auto& ring : rings_) {
+			rings.push_back(ring.get());
+		}
+	}
+
+	bool drained = false;
+	std::vector<tring*> abandoned;
+
+	for(tring* ring : rings) {
+		/* Read before the head, so the ring is empty after draining. */
+		if(ring->abandoned.load(std::memory_order_acquire)) {
+			abandoned.push_back(ring);
+		}
+
+		const size_t head = ring->head.load(std::memory_order_acquire);
+		drained |= ring->tail.load(std::memory_order_relaxed) != head;
+
+		size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+		for(; tail != head; ++tail) {
+			tentry& entry = ring->entries[tail & mask_];
+
+			if(entry.format) {
+				/*
+				 * Keep the buffer in the ring, so the producer can reuse its
+				 * storage for the next message.
+				 */
+				tentry text;
+				text.module = entry.module;
+				text.level = entry.level;
+				text.message = entry.format(entry.message);
+				batch.push_back(std::move(text));
+			} else {
+				batch.push_back(std::move(entry));
+			}
+		}
+
+		ring->tail.store(tail, std::memory_order_release);
+	}
+
+	if(!drained && abandoned.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		rings_.erase(std::remove_if(rings_.begin(), rings_.end()
+					, [&](const std::shared_ptr<tring>& ring)
+					{
+						return std::find(abandoned.begin(), abandoned.end()
+								, ring.get()) != abandoned.end();
+					})
+				, rings_.end());
+	}
+
+	/* The blocked producers check their ring while holding the lock. */
+	space_.notify_all();
+}
+
+/**
+ * The state of the uses of the thread.
+ *
+ * The lowest bit is set while the thread uses a backend, the other bits
+ * count the uses ended. Nested uses don't change the state, so it only
+ * changes when the outermost @ref tbackend_owner::tuse starts or ends.
+ *
+ * Only written by its own thread, so a use doesn't write a cache line
+ * shared with other threads.
+ */
+static __thread std::atomic<uint64_t> thread_uses;
+
+/** The number of nested uses of the thread. */
+static __thread unsigned thread_use_depth = 0;
+
+/** Is the @ref thread_uses of the thread in the @ref tuses? */
+static __thread bool thread_uses_registered = false;
+
+/** The states of the uses of the threads. */
+struct tuses
+{
+	tuses()
+		: mutex()
+		, states()
+		, key()
+	{
+		pthread_key_create(&key, &tuses::release);
+	}
+
+	/** Protects the @ref states. */
+	std::mutex mutex;
+
+	/** The @ref thread_uses of the threads that used a backend. */
+	std::vector<std::atomic<uint64_t>*> states;
+
+	/**
+	 * The key to release the state of a terminating thread.
+	 *
+	 * Its value is the thread's @ref thread_uses. The destructor runs before
+	 * the thread local storage of the thread is released.
+	 */
+	pthread_key_t key;
+
+	/**
+	 * Releases the state of a terminating thread.
+	 *
+	 * @param state               The value of the @ref key.
+	 */
+	static void
+	release(void* state);
+};
+
+/*
+ * Not destroyed, since threads can terminate after the static objects are
+ * destroyed.
+ */
+static tuses&
+uses()
+{
+	static tuses* result = new tuses();
+	return *result;
+}
+
+void
+tuses::release(void* state)
+{
+	tuses& uses = logging::uses();
+
+	std::lock_guard<std::mutex> lock(uses.mutex);
+	uses.states.erase(std::remove(uses.states.begin(), uses.states.end()
+				, static_cast<std::atomic<uint64_t>*>(state))
+			, uses.states.end());
+}
+
+tbackend_owner::tuse::tuse(const tbackend_owner& owner)
+	: backend_(nullptr)
+{
+	if(thread_use_depth++ == 0) {
+		if(!thread_uses_registered) {
+			tuses& uses = logging::uses();
+
+			std::lock_guard<std::mutex> lock(uses.mutex);
+			uses.states.push_back(&thread_uses);
+			pthread_setspecific(uses.key, &thread_uses);
+			thread_uses_registered = true;
+		}
+
+		thread_uses.store(
+				  thread_uses.load(std::memory_order_relaxed) | 1
+				, std::memory_order_relaxed);
+
+		/* Pairs with the fence in reset(), so a used backend isn't deleted. */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	backend_ = owner.backend_.load(std::memory_order_acquire);
+}
+
+tbackend_owner::tuse::~tuse()
+{
+	if(--thread_use_depth == 0) {
+		thread_uses.store(
+				  thread_uses.load(std::memory_order_relaxed) + 1
+				, std::memory_order_release);
+	}
+}
+
+tbackend_owner::~tbackend_owner()
+{
+	reset();
+}
+
+void
+tbackend_owner::reset(tbackend* backend)
+{
+	tbackend* old = backend_.exchange(backend);
+
+	/*
+	 * A use either started after the fence and sees the new backend, or
+	 * its state is seen here. A thread may use the old backend until the
+	 * use seen here ends, which changes its state. So a thread which logs
+	 * continuously doesn't keep the old backend alive.
+	 */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	{
+		tuses& uses = logging::uses();
+
+		std::lock_guard<std::mutex> lock(uses.mutex);
+		for(const std::atomic<uint64_t>* state : uses.states) {
+			const uint64_t used = state->load(std::memory_order_acquire);
+			if(used & 1) {
+				while(state->load(std::memory_order_acquire) == used) {
+					std::this_thread::yield();
+				}
+			}
+		}
+	}
+
+	delete old;
+}
+
+} // namespace logging
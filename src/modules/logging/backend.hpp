@@ -0,0 +1,450 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the logging backend with its own writer thread.
+ */
+
+#ifndef MODULES_LOGGING_BACKEND_HPP_INCLUDED
+#define MODULES_LOGGING_BACKEND_HPP_INCLUDED
+
+#include "modules/logging/full_policy.hpp"
+#include "modules/logging/level.hpp"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+/**
+ * A logging backend with its own writer thread.
+ *
+ * In the asynchronous mode of the loggers every message is posted to a
+ * strand in the application's @c io_service, so logging competes with the
+ * normal handlers and every message is written separately. The backend
+ * avoids both.
+ *
+ * Every thread logging gets its own ring buffer. The ring has a single
+ * producer, the logging thread, and a single consumer, the writer thread,
+ * so it needs no locking. Only the first message of a thread takes a lock,
+ * to register its ring. When the thread terminates its ring is released
+ * after writing its last messages.
+ *
+ * When all rings are empty the writer thread sleeps until a producer wakes
+ * it. Then it waits @ref flush_interval, or less when a ring is half full,
+ * drains all rings and hands the messages as one batch to the write
+ * function. The order of the messages of one thread is preserved, the
+ * messages of different threads in one batch are not ordered.
+ *
+ * When a ring is full and the policy is @ref tfull_policy::block the
+ * producer waits until the writer thread drained the ring.
+ *
+ * A message can also be deferred, then the producer only stores its encoded
+ * arguments and the writer thread formats the message, see
+ * @ref tentry::format.
+ */
+class tbackend final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The function type to format a deferred message.
+	 *
+	 * @param data                The arguments of the message, encoded by
+	 *                            the producer.
+	 *
+	 * @returns                   The formatted message.
+	 */
+	typedef std::string (*tformat_function)(const std::string& data);
+
+	/** A message in a ring. */
+	struct tentry
+	{
+		/** The id of the module, see @ref module::id(). */
+		unsigned module{0};
+
+		/** The level of the message. */
+		tlevel level{tlevel::trace};
+
+		/**
+		 * The function to format the message.
+		 *
+		 * When @c nullptr the @ref message is text, else it contains the
+		 * encoded arguments, which the writer thread formats with this
+		 * function.
+		 */
+		tformat_function format{nullptr};
+
+		/** The message. */
+		std::string message{};
+	};
+
+	/**
+	 * The function type to write a batch.
+	 *
+	 * The function is called in the writer thread.
+	 *
+	 * @param entries             The messages in the batch.
+	 */
+	typedef std::function<void(
+				  const std::vector<tentry>& entries
+			)>
+			twrite_function;
+
+	/** The maximum time a message waits in a ring, in milliseconds. */
+	static const unsigned flush_interval = 10;
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * Starts the writer thread.
+	 *
+	 * @param capacity            The number of messages in the ring of
+	 *                            every thread, rounded up to a power of 2.
+	 * @param policy__            The value of @ref policy_.
+	 * @param write_function__    The value of @ref write_function_.
+	 */
+	tbackend(const size_t capacity
+			, const tfull_policy policy__
+			, const twrite_function& write_function__);
+
+	/**
+	 * Destructor.
+	 *
+	 * Writes the queued messages and stops the writer thread.
+	 */
+	~tbackend();
+
+	tbackend&
+	operator=(const tbackend&) = delete;
+	tbackend(const tbackend&) = delete;
+
+	tbackend&
+	operator=(tbackend&&) = delete;
+	tbackend(tbackend&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Queues a message in the ring of the calling thread.
+	 *
+	 * The backend shall not be destroyed while a thread queues a message.
+	 *
+	 * @param module              The id of the module.
+	 * @param level               The level of the message.
+	 * @param message             The message.
+	 *
+	 * @returns                   Whether the message is queued, when the
+	 *                            ring is full the @ref policy_ determines
+	 *                            the result.
+	 */
+	bool
+	push(const unsigned module, const tlevel level, std::string&& message);
+
+	/**
+	 * Returns the next free entry in the ring of the calling thread.
+	 *
+	 * Allows the producer to fill the entry in place, reusing the storage of
+	 * the entry's @ref tentry::message. After filling the entry it shall be
+	 * queued with @ref publish().
+	 *
+	 * @returns                   The entry, or @c nullptr when the ring is
+	 *                            full and the @ref policy_ discards the
+	 *                            message.
+	 */
+	tentry*
+	acquire();
+
+	/** Queues the entry returned by @ref acquire(). */
+	void
+	publish();
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	/** Returns the total number of messages discarded. */
+	uint64_t
+	get_dropped() const;
+
+private:
+
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The ring buffer of a thread.
+	 *
+	 * The positions increase monotonically, the index in @ref entries is the
+	 * position masked with @ref mask_.
+	 */
+	struct tring
+	{
+		explicit tring(const size_t capacity);
+
+		/** The messages. */
+		std::vector<tentry> entries;
+
+		/** The position the producer writes next. */
+		std::atomic<size_t> head{0};
+
+		/** The position the consumer reads next. */
+		std::atomic<size_t> tail{0};
+
+		/**
+		 * Has the producer terminated?
+		 *
+		 * Set after the last message of the thread is queued, the writer
+		 * thread releases the ring once drained.
+		 */
+		std::atomic<bool> abandoned{false};
+	};
+
+
+	/***** ***** Members. ***** *****/
+
+	/**
+	 * The unique id of the backend.
+	 *
+	 * Used to validate the cached ring of a thread, a thread may have used
+	 * an earlier backend.
+	 */
+	const unsigned id_;
+
+	/** The mask to get the index in a ring. */
+	const size_t mask_;
+
+	/** The policy when a ring is full. */
+	const tfull_policy policy_;
+
+	/** The function to write a batch. */
+	const twrite_function write_function_;
+
+	/**
+	 * Protects @ref rings_ and is used for the @ref condition_ and the
+	 * @ref space_.
+	 */
+	std::mutex mutex_{};
+
+	/** Signals the writer thread to drain the rings. */
+	std::condition_variable condition_{};
+
+	/** Signals the blocked producers the writer thread drained the rings. */
+	std::condition_variable space_{};
+
+	/**
+	 * Is the writer thread waiting for the first message?
+	 *
+	 * The producer that clears the flag wakes the writer thread.
+	 */
+	std::atomic<bool> sleeping_{false};
+
+	/**
+	 * The rings of the threads logging.
+	 *
+	 * The ring is shared with its thread, see @ref release_ring(), so a
+	 * thread terminating after the backend is destroyed can still mark it
+	 * abandoned.
+	 */
+	std::vector<std::shared_ptr<tring>> rings_{};
+
+	/** The number of messages discarded since the last report. */
+	std::atomic<uint64_t> dropped_{0};
+
+	/** The total number of messages discarded. */
+	std::atomic<uint64_t> dropped_total_{0};
+
+	/** Should the writer thread stop after draining the rings? */
+	std::atomic<bool> stop_{false};
+
+	/** The writer thread. */
+	std::thread thread_;
+
+	/** Returns the ring of the calling thread, registering it if needed. */
+	tring&
+	ring();
+
+	/**
+	 * Returns the key of the thread specific ring.
+	 *
+	 * The value of the key is a @c std::shared_ptr<tring>, which is released
+	 * by @ref release_ring() when the thread terminates.
+	 */
+	static pthread_key_t
+	ring_key();
+
+	/**
+	 * Marks the ring of a terminating thread abandoned.
+	 *
+	 * @param ring                The value of the @ref ring_key().
+	 */
+	static void
+	release_ring(void* ring);
+
+	/** Wakes the writer thread, when it waits for the flush interval. */
+	void
+	wake();
+
+	/** Wakes the writer thread, when it sleeps. */
+	void
+	wake_sleeping();
+
+	/**
+	 * Returns whether all rings are empty.
+	 *
+	 * @pre                       The @ref mutex_ is locked.
+	 */
+	bool
+	is_empty() const;
+
+	/** The main loop of the writer thread. */
+	void
+	run();
+
+	/**
+	 * Moves the messages of all rings to a batch.
+	 *
+	 * Also releases the abandoned rings.
+	 *
+	 * @param batch               The batch to append the messages to.
+	 */
+	void
+	drain(std::vector<tentry>& batch);
+};
+
+/**
+ * Owns the backend of a logger.
+ *
+ * The backend can be replaced while other threads log. A thread logging
+ * uses the backend with a @ref tuse, the backend is only destroyed after
+ * all its uses ended.
+ *
+ * Every thread counts its own uses, so logging doesn't write memory shared
+ * with the other threads. Only @ref reset() reads the counters of all
+ * threads.
+ */
+class tbackend_owner final
+{
+public:
+
+	/***** ***** Types. ***** *****/
+
+	/** Uses the backend during its lifetime. */
+	class tuse final
+	{
+	public:
+		explicit tuse(const tbackend_owner& owner);
+
+		~tuse();
+
+		tuse&
+		operator=(const tuse&) = delete;
+		tuse(const tuse&) = delete;
+
+		tuse&
+		operator=(tuse&&) = delete;
+		tuse(tuse&&) = delete;
+
+		/** Returns the backend, @c nullptr if none. */
+		tbackend*
+		get() const;
+
+	private:
+
+		/** The backend used. */
+		tbackend* backend_;
+	};
+
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	tbackend_owner() = default;
+
+	/** Destructor, destroys the backend. */
+	~tbackend_owner();
+
+	tbackend_owner&
+	operator=(const tbackend_owner&) = delete;
+	tbackend_owner(const tbackend_owner&) = delete;
+
+	tbackend_owner&
+	operator=(tbackend_owner&&) = delete;
+	tbackend_owner(tbackend_owner&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/**
+	 * Replaces the backend.
+	 *
+	 * Waits until the uses of the old backend ended before destroying it.
+	 * The uses of all threads are waited for, including the uses of the
+	 * backends of other owners, since the threads only count their total
+	 * number of uses. The destructor of the backend writes the messages
+	 * still in its rings.
+	 *
+	 * @param backend             The new backend, @c nullptr for none.
+	 */
+	void
+	reset(tbackend* backend = nullptr);
+
+
+	/***** ***** Setters, getters. ***** *****/
+
+	/**
+	 * Returns whether there is a backend.
+	 *
+	 * The backend may be replaced directly afterwards, so the result is
+	 * only a hint.
+	 */
+	bool
+	is_set() const;
+
+private:
+
+	/***** ***** Members. ***** *****/
+
+	/** The backend. */
+	std::atomic<tbackend*> backend_{nullptr};
+};
+
+inline tbackend*
+tbackend_owner::tuse::get() const
+{
+	return backend_;
+}
+
+inline bool
+tbackend_owner::is_set() const
+{
+	return backend_.load(std::memory_order_relaxed) != nullptr;
+}
+
+} // namespace logging
+
+#endif
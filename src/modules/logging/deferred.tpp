@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the encoding of the arguments of a deferred log message.
+ *
+ * A deferred message is not formatted by the caller, instead the caller
+ * appends the raw values of the arguments to a binary buffer. The format
+ * site of the message is identified by @ref format<Pack...>(), which is
+ * instantiated for the argument types of the log statement. The writer
+ * thread of the @ref tbackend calls this function to decode the arguments
+ * and format the message.
+ *
+ * The arguments are encoded as:
+ * - Arithmetic types, enumerates and pointers, except pointers to @c char,
+ *   are stored as their raw bytes.
+ * - Arrays of @c const @c char are stored as a pointer. These arrays are
+ *   string literals, e.g. the message itself or @c __PRETTY_FUNCTION__,
+ *   which have static storage duration. So a local array of @c const
+ *   @c char shall not be logged; an array of @c char, e.g. a buffer of the
+ *   caller, is copied.
+ * - A @ref tliteral is stored as a pointer, it marks another string with
+ *   static storage duration.
+ * - Strings, @c std::string, arrays of @c char and pointers to @c char, are
+ *   stored as their length followed by their characters.
+ * - Other types are formatted by the caller and stored as a string.
+ *
+ * The size of the encoded arguments is determined first, so the caller's
+ * buffer is resized once and the values are copied without further checks.
+ *
+ * The writer thread formats the decoded values with @ref lib::append(), so
+ * they are formatted like the messages formatted by the caller.
+ */
+
+#ifndef MODULES_LOGGING_DEFERRED_TPP_INCLUDED
+#define MODULES_LOGGING_DEFERRED_TPP_INCLUDED
+
+#include "lib/string/concatenate.tpp"
+#include "lib/string/string_view.tpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace logging {
+
+/**
+ * A string with static storage duration.
+ *
+ * A deferred message only stores the pointer to the string.
+ */
+struct tliteral
+{
+	const char* value;
+};
+
+/**
+ * Marks a string with static storage duration.
+ *
+ * An array of @c const @c char is already stored as a pointer, this marks
+ * a pointer to such a string, e.g. an element of a table of names.
+ *
+ * @param value                   The string.
+ *
+ * @returns                       The marked string.
+ */
+inline tliteral
+literal(const char* value)
+{
+	return tliteral{value};
+}
+
+namespace deferred {
+
+/** Appends the raw bytes of a value to a buffer. */
+template<class T>
+inline void
+append(char*& data, const T& value)
+{
+	std::memcpy(data, &value, sizeof(value));
+	data += sizeof(value);
+}
+
+/** Reads the raw bytes of a value from a buffer. */
+template<class T>
+inline T
+extract(const char*& data)
+{
+	T result;
+	std::memcpy(&result, data, sizeof(result));
+	data += sizeof(result);
+	return result;
+}
+
+/**
+ * The type of an argument of a log statement.
+ *
+ * The log functions take their arguments as forwarding references, so the
+ * deduced type of an array of @c const @c char differs from the type of an
+ * array of @c char. This removes the reference and the qualifiers, except
+ * the @c const of such an array, which is encoded as a @ref tliteral.
+ */
+template<class T>
+struct targument
+{
+	typedef typename std::remove_cv<
+				typename std::remove_reference<T>::type>::type
+			type;
+};
+
+template<size_t N>
+struct targument<const char (&)[N]>
+{
+	typedef const char type[N];
+};
+
+/** Is the type a pointer to a (const) @c char? */
+template<class T>
+struct tis_string_pointer
+	: std::integral_constant<bool
+			, std::is_pointer<T>::value
+				&& std::is_same<
+					  typename std::remove_cv<
+						typename std::remove_pointer<T>::type>::type
+					, char>::value>
+{
+};
+
+/** Is the type stored as its raw bytes? */
+template<class T>
+struct tis_raw
+	: std::integral_constant<bool
+			, std::is_arithmetic<T>::value
+				|| std::is_enum<T>::value
+				|| (std::is_pointer<T>::value
+					&& !tis_string_pointer<T>::value)>
+{
+};
+
+/**
+ * Writes a stored value to the buffer.
+ *
+ * The size of all values is determined first, so the buffer is only
+ * resized once.
+ *
+ * This is the version for the types stored as their raw bytes, including
+ * a @ref tliteral.
+ */
+template<class T>
+struct twriter
+{
+	static size_t
+	size(const T& /*value*/)
+	{
+		return sizeof(T);
+	}
+
+	static void
+	write(char*& data, const T& value)
+	{
+		append(data, value);
+	}
+};
+
+/** The writer for a string, stored as its length and its characters. */
+template<>
+struct twriter<lib::tstring_view>
+{
+	static size_t
+	size(const lib::tstring_view& value)
+	{
+		return sizeof(size_t) + value.size();
+	}
+
+	static void
+	write(char*& data, const lib::tstring_view& value)
+	{
+		append(data, value.size());
+		std::memcpy(data, value.data(), value.size());
+		data += value.size();
+	}
+};
+
+/** The writer for a string formatted by the caller. */
+template<>
+struct twriter<std::string>
+	: twriter<lib::tstring_view>
+{
+};
+
+/** Decodes a string written by @ref twriter<lib::tstring_view>. */
+inline void
+decode_string(const char*& data, std::string& message)
+{
+	const size_t size = extract<size_t>(data);
+	message.append(data, size);
+	data += size;
+}
+
+/**
+ * The codec for an argument type.
+ *
+ * The codec converts the argument to the value stored, @ref tstored, which
+ * is written with its @ref twriter. Its @c decode function appends the
+ * decoded value to the message.
+ *
+ * This is the generic version, which formats the argument when encoding.
+ */
+template<class T, class Enable = void>
+struct tcodec
+{
+	typedef std::string tstored;
+
+	static tstored
+	store(const T& value)
+	{
+		return lib::concatenate(value);
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		decode_string(data, message);
+	}
+};
+
+/** The codec for the types stored as their raw bytes. */
+template<class T>
+struct tcodec<T, typename std::enable_if<tis_raw<T>::value>::type>
+{
+	typedef T tstored;
+
+	static const tstored&
+	store(const T& value)
+	{
+		return value;
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		lib::append(message, extract<T>(data));
+	}
+};
+
+/** The codec for the strings, their characters are copied. */
+template<class T>
+struct tcodec_string
+{
+	typedef lib::tstring_view tstored;
+
+	static tstored
+	store(const T& value)
+	{
+		return lib::tstring_view(value);
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		decode_string(data, message);
+	}
+};
+
+template<>
+struct tcodec<std::string>
+	: tcodec_string<std::string>
+{
+};
+
+template<>
+struct tcodec<lib::tstring_view>
+	: tcodec_string<lib::tstring_view>
+{
+};
+
+/** The codec for a pointer to a string. */
+template<class T>
+struct tcodec<T, typename std::enable_if<tis_string_pointer<T>::value>::type>
+	: tcodec_string<T>
+{
+};
+
+/**
+ * The codec for an array of @c char.
+ *
+ * The array can be a buffer of the caller, so its characters are copied.
+ * Like a stream the characters up to the first @c NUL are used.
+ */
+template<size_t N>
+struct tcodec<char[N]>
+{
+	typedef lib::tstring_view tstored;
+
+	static tstored
+	store(const char (&value)[N])
+	{
+		return lib::tstring_view(value, static_cast<size_t>(
+				std::find(value, value + N, '\0') - value));
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		decode_string(data, message);
+	}
+};
+
+/** The codec for a string literal. */
+template<>
+struct tcodec<tliteral>
+{
+	typedef tliteral tstored;
+
+	static const tstored&
+	store(const tliteral& value)
+	{
+		return value;
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		message += extract<const char*>(data);
+	}
+};
+
+/**
+ * The codec for an array of @c const @c char.
+ *
+ * The array is a string literal, e.g. the message itself, or another string
+ * with static storage duration, e.g. @c __PRETTY_FUNCTION__. So only its
+ * pointer is stored.
+ */
+template<size_t N>
+struct tcodec<const char[N]>
+{
+	typedef tliteral tstored;
+
+	static tstored
+	store(const char (&value)[N])
+	{
+		return tliteral{value};
+	}
+
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		tcodec<tliteral>::decode(data, message);
+	}
+};
+
+/** Writes the stored values of a message. */
+template<class... Pack>
+struct tencoder;
+
+template<>
+struct tencoder<>
+{
+	static size_t
+	size()
+	{
+		return 0;
+	}
+
+	static void
+	write(char*& /*data*/)
+	{
+	}
+};
+
+template<class T, class... Pack>
+struct tencoder<T, Pack...>
+{
+	static size_t
+	size(const T& t, const Pack&... pack)
+	{
+		return twriter<T>::size(t) + tencoder<Pack...>::size(pack...);
+	}
+
+	static void
+	write(char*& data, const T& t, const Pack&... pack)
+	{
+		twriter<T>::write(data, t);
+		tencoder<Pack...>::write(data, pack...);
+	}
+};
+
+/**
+ * Appends the stored values of a message to a buffer.
+ *
+ * @param buffer                  The buffer to append the values to.
+ * @param pack                    The values to append.
+ */
+template<class... Pack>
+inline void
+encode_stored(std::string& buffer, const Pack&... pack)
+{
+	const size_t offset = buffer.size();
+	buffer.resize(offset + tencoder<Pack...>::size(pack...));
+
+	char* data = &buffer[offset];
+	tencoder<Pack...>::write(data, pack...);
+}
+
+/**
+ * Encodes the arguments of a message.
+ *
+ * The types are given explicitly, see @ref targument.
+ *
+ * @param buffer                  The buffer to append the arguments to.
+ * @param pack                    The arguments to encode.
+ */
+template<class... Pack>
+inline void
+encode(std::string& buffer, const Pack&... pack)
+{
+	encode_stored<typename tcodec<Pack>::tstored...>(
+			  buffer
+			, tcodec<Pack>::store(pack)...);
+}
+
+/** Decodes the arguments of a message. */
+template<class... Pack>
+struct tdecoder;
+
+template<>
+struct tdecoder<>
+{
+	static void
+	decode(const char*& /*data*/, std::string& /*message*/)
+	{
+	}
+};
+
+template<class T, class... Pack>
+struct tdecoder<T, Pack...>
+{
+	static void
+	decode(const char*& data, std::string& message)
+	{
+		tcodec<T>::decode(data, message);
+		tdecoder<Pack...>::decode(data, message);
+	}
+};
+
+/**
+ * Formats a deferred message.
+ *
+ * The function is a @ref tbackend::tformat_function, its address is the id
+ * of the format site.
+ *
+ * @param data                    The arguments encoded by @ref encode().
+ *
+ * @returns                       The formatted message.
+ */
+template<class... Pack>
+std::string
+format(const std::string& data)
+{
+	std::string result;
+	const char* pointer = data.data();
+	tdecoder<Pack...>::decode(pointer, result);
+	return result;
+}
+
+} // namespace deferred
+} // namespace logging
+
+namespace lib {
+namespace detail {
+
+/** The formatter for a string literal, when the message isn't deferred. */
+template<>
+struct tformatter<logging::tliteral>
+{
+	static size_t
+	size(const logging::tliteral& value)
+	{
+		return std::strlen(value.value);
+	}
+
+	static void
+	append(std::string& buffer, const logging::tliteral& value)
+	{
+		buffer += value.value;
+	}
+};
+
+} // namespace detail
+} // namespace lib
+
+#endif
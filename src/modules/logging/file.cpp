@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/logging/file.hpp"
+
+#include "lib/exception/exception.hpp"
+#include "lib/string/concatenate.tpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace logging {
+
+tfile::tfile(const std::string& filename__)
+	: tfile(filename__, 0, 0, 65536, 1000)
+{
+}
+
+tfile::tfile(
+		  const std::string& filename__
+		, const size_t max_size__
+		, const unsigned max_age__
+		, const size_t flush_size__
+		, const unsigned flush_interval__)
+	: std::streambuf()
+	, filename_(filename__)
+	, max_size_(max_size__)
+	, max_age_(max_age__)
+	, flush_size_(flush_size__)
+	, flush_interval_(flush_interval__)
+	, ostream_(this)
+	, thread_()
+{
+	open();
+	thread_ = std::thread(&tfile::run, this);
+}
+
+tfile::~tfile()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	condition_.notify_one();
+	thread_.join();
+
+	::close(fd_);
+}
+
+std::ostream*
+tfile::ostream()
+{
+	return &ostream_;
+}
+
+void
+tfile::post_process()
+{
+	bool full;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		full = buffer_.size() >= flush_size_;
+	}
+
+	if(full) {
+		condition_.notify_one();
+	}
+}
+
+tfile::int_type
+tfile::overflow(int_type c)
+{
+	if(!traits_type::eq_int_type(c, traits_type::eof())) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffer_ += traits_type::to_char_type(c);
+	}
+
+	return traits_type::not_eof(c);
+}
+
+std::streamsize
+tfile::xsputn(const char* s, std::streamsize n)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	buffer_.append(s, static_cast<size_t>(n));
+	return n;
+}
+
+void
+tfile::run()
+{
+	std::string data;
+
+	while(true) {
+		bool stop;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if(!stop_ && buffer_.size() < flush_size_) {
+				condition_.wait_for(
+						  lock
+						, std::chrono::milliseconds(flush_interval_));
+			}
+
+			stop = stop_;
+			std::swap(data, buffer_);
+		}
+
+		/*
+		 * The buffer is swapped, so the loggers can continue while the data
+		 * is written and the file is rotated.
+		 */
+		if(!data.empty()) {
+			write(data);
+			data.clear();
+		}
+
+		if(stop) {
+			return;
+		}
+	}
+}
+
+void
+tfile::write(const std::string& data)
+{
+	size_t offset = 0;
+	while(offset != data.size()) {
+		const ssize_t written =
+				::write(fd_, &data[offset], data.size() - offset);
+
+		if(written < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+
+			/* Can't use the logger, it might write to this file. */
+			std::cerr << "Failed to write the log file »"
+					<< filename_
+					<< "« message »"
+					<< std::strerror(errno)
+					<< "«.\n";
+			return;
+		}
+		offset += static_cast<size_t>(written);
+	}
+	size_ += data.size();
+
+	const bool too_large = max_size_ != 0 && size_ >= max_size_;
+	const bool too_old = max_age_ != 0
+			&& std::chrono::steady_clock::now() - opened_
+				>= std::chrono::seconds(max_age_);
+
+	if(too_large || too_old) {
+		rotate();
+	}
+}
+
+void
+tfile::open()
+{
+	fd_ = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(fd_ == -1) {
+		throw lib::texception(
+				  lib::texception::ttype::no_access
+				, lib::concatenate(
+					  "Couldn't open »"
+					, filename_
+					, "« for writing message »"
+					, std::strerror(errno)
+					, "«"));
+	}
+
+	struct stat status;
+	size_ = ::fstat(fd_, &status) == 0
+			? static_cast<size_t>(status.st_size)
+			: 0;
+	opened_ = std::chrono::steady_clock::now();
+}
+
+void
+tfile::rotate()
+{
+	const std::time_t now = std::time(nullptr);
+	std::tm time;
+	::gmtime_r(&now, &time);
+
+	char suffix[sizeof("YYYYmmddTHHMMSS")];
+	std::strftime(suffix, sizeof(suffix), "%Y%m%dT%H%M%S", &time);
+
+	/* Don't overwrite a file rotated in the same second. */
+	std::string rotated = lib::concatenate(filename_, '.', suffix);
+	struct stat status;
+	for(unsigned i = 1; ::stat(rotated.c_str(), &status) == 0; ++i) {
+		rotated = lib::concatenate(filename_, '.', suffix, '.', i);
+	}
+
+	if(std::rename(filename_.c_str(), rotated.c_str()) != 0) {
+		std::cerr << "Failed to rotate the log file »"
+				<< filename_
+				<< "« message »"
+				<< std::strerror(errno)
+				<< "«.\n";
+
+		/* Retry when the file has grown or aged again. */
+		size_ = 0;
+		opened_ = std::chrono::steady_clock::now();
+		return;
+	}
+
+	::close(fd_);
+
+	try {
+		open();
+	} catch(const lib::texception& e) {
+		std::cerr << e.message << ".\n";
+	}
+}
+
+} // namespace logging
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the file sink for the loggers.
+ */
+
+#ifndef MODULES_LOGGING_FILE_HPP_INCLUDED
+#define MODULES_LOGGING_FILE_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace logging {
+
+/**
+ * A log file.
+ *
+ * The file can be used as stream for the loggers, e.g.:
+ * @code
+ * set_stream_function(std::bind(&tfile::ostream, &file));
+ * set_post_process_function(std::bind(&tfile::post_process, &file));
+ * @endcode
+ *
+ * The file is append-only. The messages written to the @ref ostream() are
+ * buffered in memory and written to disk by a dedicated thread, so a logger
+ * never waits for the disk. The buffer is written every
+ * @ref flush_interval_ milliseconds, or earlier when it contains at least
+ * @ref flush_size_ bytes.
+ *
+ * After writing, the thread rotates the file when it's larger than
+ * @ref max_size_ bytes or older than @ref max_age_ seconds. The file is
+ * renamed to its name followed by the time of the rotation, and a new file
+ * is opened.
+ *
+ * The @ref ostream() is not thread-safe, this matches the loggers, which
+ * only write to their stream from one thread at a time.
+ */
+class tfile final
+	: private std::streambuf
+{
+public:
+
+	/***** ***** Constructor, destructor, assignment. ***** *****/
+
+	/**
+	 * Constructor.
+	 *
+	 * Opens a file without rotation, which is flushed every second.
+	 *
+	 * @param filename__          The value of @ref filename_.
+	 */
+	explicit tfile(const std::string& filename__);
+
+	/**
+	 * Constructor.
+	 *
+	 * @param filename__          The value of @ref filename_.
+	 * @param max_size__          The value of @ref max_size_.
+	 * @param max_age__           The value of @ref max_age_.
+	 * @param flush_size__        The value of @ref flush_size_.
+	 * @param flush_interval__    The value of @ref flush_interval_.
+	 */
+	tfile(const std::string& filename__
+			, const size_t max_size__
+			, const unsigned max_age__
+			, const size_t flush_size__
+			, const unsigned flush_interval__);
+
+	/**
+	 * Destructor.
+	 *
+	 * Writes the buffered messages before returning.
+	 */
+	~tfile();
+
+	tfile&
+	operator=(const tfile&) = delete;
+	tfile(const tfile&) = delete;
+
+	tfile&
+	operator=(tfile&&) = delete;
+	tfile(tfile&&) = delete;
+
+
+	/***** ***** Operators. ***** *****/
+
+	/** Returns the stream to log to. */
+	std::ostream*
+	ostream();
+
+	/**
+	 * Wakes the writing thread when the buffer is full.
+	 *
+	 * Intended to be used as post process function of a logger.
+	 */
+	void
+	post_process();
+
+private:
+
+	/***** ***** Operators. ***** *****/
+
+	/** Appends a character to the buffer. */
+	virtual int_type
+	overflow(int_type c);
+
+	/** Appends characters to the buffer. */
+	virtual std::streamsize
+	xsputn(const char* s, std::streamsize n);
+
+
+	/***** ***** Members. ***** *****/
+
+	/** The name of the file. */
+	const std::string filename_;
+
+	/**
+	 * The size after which the file is rotated.
+	 *
+	 * The size is in bytes, when @c 0 the file is not rotated by size.
+	 */
+	const size_t max_size_;
+
+	/**
+	 * The age after which the file is rotated.
+	 *
+	 * The age is in seconds, when @c 0 the file is not rotated by age.
+	 */
+	const unsigned max_age_;
+
+	/** The size of the buffer after which it's written directly. */
+	const size_t flush_size_;
+
+	/** The maximum time in milliseconds a message stays in the buffer. */
+	const unsigned flush_interval_;
+
+	/** The file descriptor of the file. */
+	int fd_{-1};
+
+	/** The size of the file. */
+	size_t size_{0};
+
+	/** The time the file was opened. */
+	std::chrono::steady_clock::time_point opened_{};
+
+	/** Protects @ref buffer_ and @ref stop_. */
+	std::mutex mutex_{};
+
+	/** Signals the @ref thread_ the buffer is full. */
+	std::condition_variable condition_{};
+
+	/** The messages not yet written. */
+	std::string buffer_{};
+
+	/** Should the @ref thread_ stop? */
+	bool stop_{false};
+
+	/** The stream writing to the @ref buffer_. */
+	std::ostream ostream_;
+
+	/** The thread writing the file. */
+	std::thread thread_;
+
+	/** The main loop of the @ref thread_. */
+	void
+	run();
+
+	/**
+	 * Writes data to the file.
+	 *
+	 * Rotates the file afterwards, if needed.
+	 *
+	 * @param data                The data to write.
+	 */
+	void
+	write(const std::string& data);
+
+	/**
+	 * Opens the file.
+	 *
+	 * Throws an exception when the file can't be opened.
+	 */
+	void
+	open();
+
+	/** Renames the file and opens a new file. */
+	void
+	rotate();
+};
+
+} // namespace logging
+
+#endif
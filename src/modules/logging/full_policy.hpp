@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the policies for a full ring of the logging backend.
+ */
+
+#ifndef MODULES_LOGGING_FULL_POLICY_HPP_INCLUDED
+#define MODULES_LOGGING_FULL_POLICY_HPP_INCLUDED
+
+namespace logging {
+
+/** The action of the @ref tbackend when the ring of a thread is full. */
+enum class tfull_policy
+{
+	/** Wait until the writer thread made room in the ring. */
+	  block
+
+	/** Discard the message. */
+	, drop
+
+	/**
+	 * Discard the message, but count it.
+	 *
+	 * The writer thread logs the number of discarded messages.
+	 */
+	, count
+};
+
+} // namespace logging
+
+#include "lib/string/enumerate.tpp"
+
+ENUM_DECLARE_STREAM_OPERATORS(logging::tfull_policy)
+
+#endif
@@ -37,6 +37,12 @@ set_async_mode(boost::asio::io_service& io_service)
 	logger().set_async_mode(io_service);
 }
 
+void
+set_backend_mode(const size_t capacity, const tfull_policy policy)
+{
+	logger().set_backend_mode(capacity, policy);
+}
+
 void
 set_sync_mode()
 {
@@ -78,6 +84,15 @@ set_async_mode(boost::asio::io_service& io_service)
 	module_logger().set_async_mode(io_service);
 }
 
+void
+set_backend_mode(
+		  const size_t capacity
+		, const tfull_policy policy
+		, const bool deferred)
+{
+	module_logger().set_backend_mode(capacity, policy, deferred);
+}
+
 void
 set_sync_mode()
 {
@@ -85,11 +100,11 @@ set_sync_mode()
 }
 
 void
-log(const std::string& module
+log(const unsigned module
 		, const tlevel level
 		, std::string message)
 {
-	module_logger().log(module, level, message);
+	module_logger().log(module, level, std::move(message));
 }
 
 
@@ -107,9 +122,14 @@ set_threshold_level(
 	module_logger().set_threshold_level(module, threshold_level);
 }
 
-tregisterer::tregisterer(const std::string& module)
+void
+set_limit(const std::string& module
+		, const tlevel level
+		, const unsigned rate
+		, const unsigned burst
+		, const unsigned sample)
 {
-	module_logger().register_module(module);
+	module_logger().set_limit(module, level, rate, burst, sample);
 }
 
 } // namespace module
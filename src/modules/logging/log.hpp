@@ -35,6 +35,9 @@ is_active(const tlevel level);
 void
 set_async_mode(boost::asio::io_service& io_service);
 
+void
+set_backend_mode(const size_t capacity, const tfull_policy policy);
+
 void
 set_sync_mode();
 
@@ -99,31 +102,70 @@ namespace module {
 tmodule_logger&
 module_logger();
 
+/**
+ * Tests whether the @p level of a module is active.
+ *
+ * @param module                  The id of the module.
+ * @param level                   The level to test.
+ */
+inline bool
+is_active(const unsigned module, const tlevel level)
+{
+	return tmodule_logger::is_active(module, level);
+}
+
 bool
 is_active(const std::string& module, const tlevel level);
 
 void
 set_async_mode(boost::asio::io_service& io_service);
 
+void
+set_backend_mode(
+		  const size_t capacity
+		, const tfull_policy policy
+		, const bool deferred);
+
 void
 set_sync_mode();
 
 void
-log(const std::string& module
+log(const unsigned module
 		, const tlevel level
 		, std::string message);
 
+/**
+ * Writes a message to the log.
+ *
+ * @pre                           @ref is_active(), the @ref LOGGER_LOG macro
+ *                                tests it before evaluating the arguments.
+ *
+ * The parts are taken as forwarding references, so a deferred message can
+ * store the string literals as pointers, see @ref deferred::targument.
+ *
+ * @param module                  The id of the module.
+ * @param level                   The level of the message.
+ * @param pack                    The parts of the message.
+ */
 template<class... Pack>
 inline void
-log(const std::string& module
+log(const unsigned module
 		, const tlevel level
-		, const Pack&... pack)
+		, Pack&&... pack)
 {
-	if(!is_active(module, level)) {
+	if(!tmodule_logger::admit(module, level)) {
 		return;
 	}
 
-	log(module, level, lib::concatenate(pack...));
+	tmodule_logger& logger = module_logger();
+	if(logger.is_deferred()) {
+		logger.log_deferred<typename deferred::targument<Pack>::type...>(
+				  module
+				, level
+				, pack...);
+	} else {
+		log(module, level, lib::concatenate(pack...));
+	}
 }
 
 void
@@ -134,19 +176,12 @@ set_threshold_level(
 		  const std::string& module
 		, const tlevel threshold_level);
 
-struct tregisterer
-{
-	explicit tregisterer(const std::string& module);
-	tregisterer() = default;
-
-	tregisterer&
-	operator=(const tregisterer&) = delete;
-	tregisterer(const tregisterer&) = delete;
-
-	tregisterer&
-	operator=(tregisterer&&) = delete;
-	tregisterer(tregisterer&&) = delete;
-};
+void
+set_limit(const std::string& module
+		, const tlevel level
+		, const unsigned rate
+		, const unsigned burst
+		, const unsigned sample);
 
 } // namespace module
 } // namespace logging
@@ -156,49 +191,49 @@ struct tregisterer
 #error "Only one set of logger macros can be defined."
 #endif
 
-#define LOGGER_REGISTER_MODULE(MODULE)                                       \
-	namespace {                                                              \
-		::logging::module::tregisterer registerer(MODULE);                   \
-	}                                                                        \
+namespace {
+
+/** The id of the module of the translation unit. */
+constexpr unsigned logger_module_id =
+		::logging::module::id(LOGGER_DEFINE_MODULE_LOGGER_MACROS);
+
+static_assert(logger_module_id != ::logging::module::count
+		, "The logging module is not in logging::module::names.");
+
+} // namespace
 
-LOGGER_REGISTER_MODULE(LOGGER_DEFINE_MODULE_LOGGER_MACROS)
-#undef LOGGER_REGISTER_MODULE
+/*
+ * The level is tested before the arguments are evaluated, so a disabled log
+ * statement costs only the test in @ref logging::tmodule_logger::is_active().
+ * A statement below the floor of its module is a constant false condition,
+ * which the compiler removes.
+ */
+#define LOGGER_LOG(LEVEL, ...)                                               \
+	do {                                                                     \
+		if(::logging::module::floors[logger_module_id]                       \
+					<= static_cast<int>(LEVEL)                               \
+				&& ::logging::module::is_active(logger_module_id, LEVEL)) {  \
+			::logging::module::log(logger_module_id, LEVEL, __VA_ARGS__);    \
+		}                                                                    \
+	} while(0)                                                               \
 
 #define LOG_T(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::trace                                       \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::trace, __VA_ARGS__)                        \
 
 #define LOG_D(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::debug                                       \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::debug, __VA_ARGS__)                        \
 
 #define LOG_I(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::information                                 \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::information, __VA_ARGS__)                  \
 
 #define LOG_W(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::information                                 \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::warning, __VA_ARGS__)                      \
 
 #define LOG_E(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::error                                       \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::error, __VA_ARGS__)                        \
 
 #define LOG_F(...)                                                           \
-	::logging::module::log(                                                  \
-			  LOGGER_DEFINE_MODULE_LOGGER_MACROS                             \
-			, ::logging::tlevel::fatal                                       \
-			, __VA_ARGS__)                                                   \
+	LOGGER_LOG(::logging::tlevel::fatal, __VA_ARGS__)                        \
 
 #endif
 #endif
@@ -16,6 +16,8 @@
 
 #include "lib/exception/validate.tpp"
 
+#include <algorithm>
+
 namespace logging {
 
 tlogger::~tlogger()
@@ -36,11 +38,23 @@ tlogger::set_async_mode(boost::asio::io_service& io_service)
 	strand_ = new boost::asio::io_service::strand(io_service);
 }
 
+void
+tlogger::set_backend_mode(const size_t capacity, const tfull_policy policy)
+{
+	set_sync_mode();
+	backend_.reset(new tbackend(
+			  capacity
+			, policy
+			, std::bind(&tlogger::write, this, std::placeholders::_1)));
+}
+
 void
 tlogger::set_sync_mode()
 {
 	delete strand_;
 	strand_ = nullptr;
+
+	backend_.reset();
 }
 
 static void
@@ -76,7 +90,10 @@ tlogger::log(const tlevel level, std::string message)
 		pre_process_function_(level, message);
 	}
 
-	if(strand_) {
+	tbackend_owner::tuse backend(backend_);
+	if(backend.get()) {
+		backend.get()->push(0, level, std::move(message));
+	} else if(strand_) {
 		strand_->post(std::bind(
 				  do_log
 				, level
@@ -127,6 +144,52 @@ tlogger::set_post_process_function(const tpost_process_function& function)
 	post_process_function_ = function;
 }
 
+void
+tlogger::write(const std::vector<tbackend::tentry>& entries)
+{
+	struct tbuffer
+	{
+		std::ostream* ostream;
+		std::string data;
+
+		/** The number of messages in the @ref data. */
+		size_t messages;
+	};
+
+	std::vector<tbuffer> buffers;
+
+	for(const tbackend::tentry& entry : entries) {
+		std::ostream* ostream = stream_function_(entry.level);
+		if(!ostream) {
+			continue;
+		}
+
+		auto itor = std::find_if(buffers.begin(), buffers.end()
+				, [ostream](const tbuffer& buffer)
+				{
+					return buffer.ostream == ostream;
+				});
+
+		if(itor == buffers.end()) {
+			buffers.push_back(tbuffer{ostream, entry.message, 1});
+		} else {
+			itor->data += entry.message;
+			++itor->messages;
+		}
+	}
+
+	for(const tbuffer& buffer : buffers) {
+		buffer.ostream->write(buffer.data.data(), buffer.data.size());
+
+		/* Like the other modes it's called once per message. */
+		if(post_process_function_) {
+			for(size_t i = 0; i < buffer.messages; ++i) {
+				post_process_function_();
+			}
+		}
+	}
+}
+
 std::ostream*
 tlogger::basic_stream_function(const tlevel level)
 {
@@ -26,6 +26,7 @@
 #define MODULES_LOGGING_LOGGER_HPP_INCLUDED
 
 #include "lib/string/concatenate.tpp"
+#include "modules/logging/backend.hpp"
 #include "modules/logging/level.hpp"
 
 #include <boost/asio/strand.hpp>
@@ -125,6 +126,19 @@ public:
 	void
 	set_async_mode(boost::asio::io_service& io_service);
 
+	/**
+	 * Sets the asynchronous mode using a @ref tbackend.
+	 *
+	 * Unlike @ref set_async_mode() the messages are not dispatched in the
+	 * application's @c io_service, but written in batches by the writer
+	 * thread of the backend.
+	 *
+	 * @param capacity            The capacity of the ring of every thread.
+	 * @param policy              The policy when a ring is full.
+	 */
+	void
+	set_backend_mode(const size_t capacity, const tfull_policy policy);
+
 	/**
 	 * Sets the synchronous mode.
 	 *
@@ -145,7 +159,9 @@ public:
 	 * \li \anchor dispatch The logging is put in the logging queue storing the
 	 *     current value of @ref stream_function_ and @ref
 	 *     post_process_function_. (In synchronous mode the dispatching is also
-	 *     done, but directly executed.)
+	 *     done, but directly executed. In backend mode the message is queued
+	 *     in the ring of the calling thread, the functions are retrieved by
+	 *     the writer thread.)
 	 *
 	 * After the dispatching the real logger is called. This function gets the
 	 * values stored during dispatching, especially @ref stream_function_ and
@@ -205,6 +221,13 @@ private:
 	 */
 	boost::asio::io_service::strand* strand_{nullptr};
 
+	/**
+	 * The backend to use in asynchronous mode.
+	 *
+	 * When set the @ref strand_ is not used.
+	 */
+	tbackend_owner backend_{};
+
 	/**
 	 * The function used in the @ref pre_processing phase.
 	 *
@@ -242,6 +265,18 @@ private:
 	std::ostream*
 	basic_stream_function(const tlevel level);
 
+	/**
+	 * Writes a batch of the @ref backend_.
+	 *
+	 * The messages are collected per stream, so every stream gets a single
+	 * write per batch. After the write the @ref post_process_function_ is
+	 * called for every message written.
+	 *
+	 * @param entries             The messages to write.
+	 */
+	void
+	write(const std::vector<tbackend::tentry>& entries);
+
 };
 
 } // namespace logging
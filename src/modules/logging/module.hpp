@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the table of the modules of the module logger.
+ *
+ * Every module has a compile-time id, which is the index of its name in the
+ * table. The id is used to look up the threshold level of the module
+ * without any string handling.
+ */
+
+#ifndef MODULES_LOGGING_MODULE_HPP_INCLUDED
+#define MODULES_LOGGING_MODULE_HPP_INCLUDED
+
+/*
+ * The lowest level compiled in, the integral value of a @ref logging::tlevel.
+ *
+ * The log statements below this floor are removed at compile-time, the
+ * runtime threshold only works above the floor. The floor is set by the
+ * build system, globally with @c LOGGER_LEVEL_FLOOR and per module with
+ * @c LOGGER_LEVEL_FLOOR_<MODULE>.
+ */
+#ifndef LOGGER_LEVEL_FLOOR
+#define LOGGER_LEVEL_FLOOR 0
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_BENCHMARK
+#define LOGGER_LEVEL_FLOOR_BENCHMARK LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_CLIENT
+#define LOGGER_LEVEL_FLOOR_CLIENT LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_COMMUNICATION
+#define LOGGER_LEVEL_FLOOR_COMMUNICATION LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_CZAR
+#define LOGGER_LEVEL_FLOOR_CZAR LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_GAME
+#define LOGGER_LEVEL_FLOOR_GAME LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_LOBBY
+#define LOGGER_LEVEL_FLOOR_LOBBY LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_LOGGING
+#define LOGGER_LEVEL_FLOOR_LOGGING LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_STRAND
+#define LOGGER_LEVEL_FLOOR_STRAND LOGGER_LEVEL_FLOOR
+#endif
+
+#ifndef LOGGER_LEVEL_FLOOR_ZARD
+#define LOGGER_LEVEL_FLOOR_ZARD LOGGER_LEVEL_FLOOR
+#endif
+
+namespace logging {
+namespace module {
+
+/**
+ * The names of the modules.
+ *
+ * A module using @c LOGGER_DEFINE_MODULE_LOGGER_MACROS shall be added here,
+ * to @ref floors and to the list of modules in the build system.
+ */
+constexpr const char* names[] =
+{
+	  "benchmark"
+	, "client"
+	, "communication"
+	, "czar"
+	, "game"
+	, "lobby"
+	, "logging"
+	, "strand"
+	, "zard"
+};
+
+/** The number of modules. */
+constexpr unsigned count = sizeof(names) / sizeof(names[0]);
+
+/** The lowest level compiled in per module, see @c LOGGER_LEVEL_FLOOR. */
+constexpr int floors[] =
+{
+	  LOGGER_LEVEL_FLOOR_BENCHMARK
+	, LOGGER_LEVEL_FLOOR_CLIENT
+	, LOGGER_LEVEL_FLOOR_COMMUNICATION
+	, LOGGER_LEVEL_FLOOR_CZAR
+	, LOGGER_LEVEL_FLOOR_GAME
+	, LOGGER_LEVEL_FLOOR_LOBBY
+	, LOGGER_LEVEL_FLOOR_LOGGING
+	, LOGGER_LEVEL_FLOOR_STRAND
+	, LOGGER_LEVEL_FLOOR_ZARD
+};
+
+static_assert(sizeof(floors) / sizeof(floors[0]) == count
+		, "Every module needs a floor.");
+
+/** Compares two strings at compile-time. */
+constexpr bool
+equal(const char* lhs, const char* rhs)
+{
+	return *lhs == *rhs && (*lhs == '\0' || equal(lhs + 1, rhs + 1));
+}
+
+/**
+ * Returns the id of a module.
+ *
+ * @param name                    The name of the module.
+ * @param first                   The id to start searching, used for the
+ *                                recursion.
+ *
+ * @returns                       The id of the module or @ref count if the
+ *                                module doesn't exist.
+ */
+constexpr unsigned
+id(const char* name, const unsigned first = 0)
+{
+	return first == count
+			? count
+			: equal(names[first], name) ? first : id(name, first + 1);
+}
+
+} // namespace module
+} // namespace logging
+
+#endif
@@ -15,30 +15,138 @@
 #include "modules/logging/module_logger.hpp"
 
 #include "lib/exception/validate.tpp"
+#include "modules/logging/log.hpp"
+
+#include <algorithm>
+#include <chrono>
 
 namespace logging {
 
 tmodule_logger::~tmodule_logger()
 {
+	{
+		std::lock_guard<std::mutex> lock(summary_mutex_);
+		summary_stop_ = true;
+	}
+	summary_condition_.notify_one();
+
+	if(summary_thread_.joinable()) {
+		summary_thread_.join();
+	}
+
 	set_sync_mode();
 }
 
-void
-tmodule_logger::register_module(
-			  const std::string& module
-			, const tlevel threshold_level)
+const unsigned tmodule_logger::summary_interval;
+
+std::atomic<int> tmodule_logger::thresholds_[module::count];
+
+tmodule_logger::tlimit
+		tmodule_logger::limits_[module::count][tmodule_logger::level_count];
+
+/** Returns the current time, see @ref tmodule_logger::tlimit::arrival. */
+static int64_t
+now()
 {
-	modules_.insert(std::make_pair(module, threshold_level));
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Returns the id of a module.
+ *
+ * Throws an exception when the module doesn't exist.
+ */
+static unsigned
+find(const std::string& module)
+{
+	const unsigned result = ::logging::module::id(module.c_str());
+
+	if(result == ::logging::module::count) {
+		throw lib::texception(
+				  lib::texception::ttype::invalid_value
+				, lib::concatenate(
+					  "Logging module '"
+					, module
+					, "' is not registered"));
+	}
+
+	return result;
 }
 
 bool
 tmodule_logger::is_active(const std::string& module, const tlevel level) const
 {
-	if(modules_.count(module) == 0) {
-		return false;
+	const unsigned id = ::logging::module::id(module.c_str());
+	return id != ::logging::module::count && is_active(id, level);
+}
+
+bool
+tmodule_logger::admit_limited(const unsigned id, const tlevel level)
+{
+	tlimit& limit = limits_[id][static_cast<unsigned>(level)];
+	const int64_t time = now();
+
+	bool result = true;
+
+	const unsigned sample = limit.sample.load(std::memory_order_relaxed);
+	if(sample > 1
+			&& limit.sequence.fetch_add(1, std::memory_order_relaxed)
+				% sample != 0) {
+
+		result = false;
+	}
+
+	const unsigned rate = limit.rate.load(std::memory_order_relaxed);
+	if(result && rate != 0) {
+		const int64_t interval = 1000000000 / rate;
+		const int64_t tolerance = interval
+				* std::max(1u, limit.burst.load(std::memory_order_relaxed));
+
+		int64_t arrival = limit.arrival.load(std::memory_order_relaxed);
+		while(true) {
+			const int64_t next = std::max(arrival, time) + interval;
+			if(next - time > tolerance) {
+				result = false;
+				break;
+			}
+			if(limit.arrival.compare_exchange_weak(
+					  arrival
+					, next
+					, std::memory_order_relaxed)) {
+				break;
+			}
+		}
 	}
 
-	return static_cast<int>(level) >= static_cast<int>(modules_.at(module));
+	if(!result) {
+		limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+void
+tmodule_logger::report_suppressed()
+{
+	for(unsigned id = 0; id < module::count; ++id) {
+		for(unsigned i = 0; i < level_count; ++i) {
+			const uint64_t suppressed =
+					limits_[id][i].suppressed.exchange(0);
+
+			if(suppressed == 0) {
+				continue;
+			}
+
+			const tlevel level = static_cast<tlevel>(i);
+			log(id, level, lib::concatenate(
+					  "Suppressed »"
+					, suppressed
+					, "« messages of level »"
+					, level
+					, "«.\n"));
+		}
+	}
 }
 
 void
@@ -48,15 +156,31 @@ tmodule_logger::set_async_mode(boost::asio::io_service& io_service)
 	strand_ = new boost::asio::io_service::strand(io_service);
 }
 
+void
+tmodule_logger::set_backend_mode(
+		  const size_t capacity
+		, const tfull_policy policy
+		, const bool deferred)
+{
+	set_sync_mode();
+	deferred_ = deferred;
+	backend_.reset(new tbackend(
+			  capacity
+			, policy
+			, std::bind(&tmodule_logger::write, this, std::placeholders::_1)));
+}
+
 void
 tmodule_logger::set_sync_mode()
 {
 	delete strand_;
 	strand_ = nullptr;
+
+	backend_.reset();
 }
 
 static void
-do_log(const std::string& module
+do_log(const unsigned id
 		, const tlevel level
 		, std::string message
 		, tmodule_logger::tstream_function stream_function
@@ -66,7 +190,9 @@ do_log(const std::string& module
 		return;
 	}
 
-	std::ostream* ostream = stream_function(module, level);
+	const std::string name = module::names[id];
+
+	std::ostream* ostream = stream_function(name, level);
 
 	if(!ostream) {
 		return;
@@ -75,34 +201,37 @@ do_log(const std::string& module
 	*ostream << message;
 
 	if(post_process_function) {
-		post_process_function(std::cref(module));
+		post_process_function(std::cref(name));
 	}
 }
 
 void
 tmodule_logger::log(
-		  const std::string& module
+		  const unsigned id
 		, const tlevel level
 		, std::string message)
 {
-	if(!is_active(module, level)) {
+	if(!is_active(id, level)) {
 		return;
 	}
 
 	if(pre_process_function_) {
-		pre_process_function_(std::cref(module), level, message);
+		pre_process_function_(module::names[id], level, message);
 	}
 
-	if(strand_) {
+	tbackend_owner::tuse backend(backend_);
+	if(backend.get()) {
+		backend.get()->push(id, level, std::move(message));
+	} else if(strand_) {
 		strand_->post(std::bind(
 				  do_log
-				, std::cref(module)
+				, id
 				, level
 				, std::move(message)
 				, stream_function_
 				, post_process_function_));
 	} else {
-		do_log(module
+		do_log(id
 				, level
 				, std::move(message)
 				, stream_function_
@@ -113,8 +242,10 @@ tmodule_logger::log(
 void
 tmodule_logger::set_threshold_level(const tlevel threshold_level)
 {
-	for(auto& module : modules_) {
-		module.second = threshold_level;
+	for(std::atomic<int>& threshold : thresholds_) {
+		threshold.store(
+				  static_cast<int>(threshold_level)
+				, std::memory_order_relaxed);
 	}
 }
 
@@ -123,31 +254,57 @@ tmodule_logger::set_threshold_level(
 			  const std::string& module
 			, const tlevel threshold_level)
 {
-	if(modules_.count(module) == 0) {
-		throw lib::texception(
-				  lib::texception::ttype::invalid_value
-				, lib::concatenate(
-					  "Logging module '"
-					, module
-					, "' is not registered"));
-	}
-
-	modules_[module] = threshold_level;
+	thresholds_[find(module)].store(
+			  static_cast<int>(threshold_level)
+			, std::memory_order_relaxed);
 }
 
 tlevel
 tmodule_logger::get_threshold_level(const std::string& module) const
 {
-	if(modules_.count(module) == 0) {
-		throw lib::texception(
-				  lib::texception::ttype::invalid_value
-				, lib::concatenate(
-					  "Logging module '"
-					, module
-					, "' is not registered"));
+	return static_cast<tlevel>(
+			thresholds_[find(module)].load(std::memory_order_relaxed));
+}
+
+void
+tmodule_logger::set_limit(
+		  const std::string& module
+		, const tlevel level
+		, const unsigned rate
+		, const unsigned burst
+		, const unsigned sample)
+{
+	tlimit& limit = limits_[find(module)][static_cast<unsigned>(level)];
+
+	limit.rate.store(rate, std::memory_order_relaxed);
+	limit.burst.store(burst, std::memory_order_relaxed);
+	limit.sample.store(sample, std::memory_order_relaxed);
+	limit.enabled.store(rate != 0 || sample > 1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(summary_mutex_);
+	if(limit.enabled && !summary_thread_.joinable() && !summary_stop_) {
+		summary_thread_ = std::thread(&tmodule_logger::run_summary, this);
 	}
+}
+
+void
+tmodule_logger::run_summary()
+{
+	std::unique_lock<std::mutex> lock(summary_mutex_);
+
+	while(!summary_stop_) {
+		summary_condition_.wait_for(
+				  lock
+				, std::chrono::seconds(summary_interval)
+				, [this]()
+				{
+					return summary_stop_;
+				});
 
-	return modules_.at(module);
+		lock.unlock();
+		report_suppressed();
+		lock.lock();
+	}
 }
 
 boost::asio::io_service::strand*
@@ -174,6 +331,58 @@ tmodule_logger::set_post_process_function(const tpost_process_function& function
 	post_process_function_ = function;
 }
 
+void
+tmodule_logger::write(const std::vector<tbackend::tentry>& entries)
+{
+	struct tbuffer
+	{
+		std::ostream* ostream;
+		std::string data;
+
+		/** The modules of the messages in the @ref data, in order. */
+		std::vector<unsigned> modules;
+	};
+
+	std::vector<tbuffer> buffers;
+
+	for(const tbackend::tentry& entry : entries) {
+		std::ostream* ostream = stream_function_(
+				  module::names[entry.module]
+				, entry.level);
+
+		if(!ostream) {
+			continue;
+		}
+
+		auto itor = std::find_if(buffers.begin(), buffers.end()
+				, [ostream](const tbuffer& buffer)
+				{
+					return buffer.ostream == ostream;
+				});
+
+		if(itor == buffers.end()) {
+			buffers.push_back(tbuffer{
+					  ostream
+					, entry.message
+					, std::vector<unsigned>(1, entry.module)});
+		} else {
+			itor->data += entry.message;
+			itor->modules.push_back(entry.module);
+		}
+	}
+
+	for(const tbuffer& buffer : buffers) {
+		buffer.ostream->write(buffer.data.data(), buffer.data.size());
+
+		/* Like the other modes it's called once per message. */
+		if(post_process_function_) {
+			for(const unsigned id : buffer.modules) {
+				post_process_function_(module::names[id]);
+			}
+		}
+	}
+}
+
 std::ostream*
 tmodule_logger::basic_stream_function(const tlevel level)
 {
@@ -20,12 +20,19 @@
 #ifndef MODULES_LOGGING_MODULE_LOGGER_HPP_INCLUDED
 #define MODULES_LOGGING_MODULE_LOGGER_HPP_INCLUDED
 
+#include "modules/logging/backend.hpp"
+#include "modules/logging/deferred.tpp"
 #include "modules/logging/level.hpp"
+#include "modules/logging/module.hpp"
 
 #include <boost/asio/strand.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
-#include <map>
+#include <mutex>
+#include <thread>
 
 namespace logging {
 
@@ -48,6 +55,13 @@ public:
 	/** The function type for the \ref post_processing stage. */
 	typedef std::function<void(const std::string&)> tpost_process_function;
 
+	/** The number of log levels. */
+	static const unsigned level_count =
+			static_cast<unsigned>(tlevel::fatal) + 1;
+
+	/** The interval between two summaries of suppressed messages, in s. */
+	static const unsigned summary_interval = 10;
+
 
 	/***** ***** Constructor, destructor, assignment. ***** *****/
 
@@ -66,29 +80,61 @@ public:
 	/***** ***** Operators. ***** *****/
 
 	/**
-	 * Registers a new module.
+	 * Tests whether the @p level is active.
 	 *
-	 * If the module is already registered the function has no effect.
+	 * A level is active if it's greater than or equal to the threshold level
+	 * of the module. The test is a test on the integral value of the
+	 * @ref tlevel.
 	 *
-	 * @param module              The name of the module.
-	 * @param threshold_level     The theshold level for the logging.
+	 * This function is on the hot path of every log call, the test is a
+	 * single relaxed load of the threshold.
+	 *
+	 * @param module              The id of the module, see @ref module::id().
+	 * @param level               The level to test.
+	 *
+	 * @returns                   Whether or not the @p level is active.
+	 */
+	static bool
+	is_active(const unsigned module, const tlevel level);
+
+	/**
+	 * Tests whether a message passes the limits of its module and level.
+	 *
+	 * A message can be limited by sampling, only one in every N messages
+	 * is admitted, and by a token bucket, which admits a burst of messages
+	 * and afterwards a fixed rate of messages. The suppressed messages are
+	 * counted and every @ref summary_interval seconds the summary thread
+	 * logs a summary, see @ref report_suppressed().
+	 *
+	 * Like @ref is_active() the test is on the hot path, without a limit
+	 * the test is a single relaxed load.
+	 *
+	 * @param module              The id of the module, see @ref module::id().
+	 * @param level               The level of the message.
+	 *
+	 * @returns                   Whether the message is admitted.
+	 */
+	static bool
+	admit(const unsigned module, const tlevel level);
+
+	/**
+	 * Logs a summary of the suppressed messages.
+	 *
+	 * For every module and level with suppressed messages a message is
+	 * logged, with the same module and level, containing the number of
+	 * suppressed messages since the last summary.
 	 */
 	void
-	register_module(
-			  const std::string& module
-			, const tlevel threshold_level = tlevel::trace);
+	report_suppressed();
 
 	/**
 	 * Tests whether the @p level is active.
 	 *
-	 * A level is active if it's greater than or equal to
-	 * @ref threshold_level_. The test is a test on the integral value of the
-	 * @ref tlevel.
-	 *
+	 * @param module              The name of the module.
 	 * @param level               The level to test.
 	 *
 	 * @returns                   Whether or not the @p level is active.
-	 *                            Not registered modules are never active.
+	 *                            Unknown modules are never active.
 	 */
 	bool
 	is_active(const std::string& module, const tlevel level) const;
@@ -107,6 +153,23 @@ public:
 	void
 	set_async_mode(boost::asio::io_service& io_service);
 
+	/**
+	 * Sets the asynchronous mode using a @ref tbackend.
+	 *
+	 * Unlike @ref set_async_mode() the messages are not dispatched in the
+	 * application's @c io_service, but written in batches by the writer
+	 * thread of the backend.
+	 *
+	 * @param capacity            The capacity of the ring of every thread.
+	 * @param policy              The policy when a ring is full.
+	 * @param deferred            The value of @ref deferred_.
+	 */
+	void
+	set_backend_mode(
+			  const size_t capacity
+			, const tfull_policy policy
+			, const bool deferred);
+
 	/**
 	 * Sets the synchronous mode.
 	 *
@@ -127,7 +190,9 @@ public:
 	 * \li \anchor dispatch The logging is put in the logging queue storing the
 	 *     current value of @ref stream_function_ and @ref
 	 *     post_process_function_. (In synchronous mode the dispatching is also
-	 *     done, but directly executed.)
+	 *     done, but directly executed. In backend mode the message is queued
+	 *     in the ring of the calling thread, the functions are retrieved by
+	 *     the writer thread.)
 	 *
 	 * After the dispatching the real logger is called. This function gets the
 	 * values stored during dispatching, especially @ref stream_function_ and
@@ -143,7 +208,38 @@ public:
 	 * \li \anchor post_processing @ref post_process_function_ is called.
 	 */
 	void
-	log(const std::string& module, const tlevel level, std::string message);
+	log(const unsigned id, const tlevel level, std::string message);
+
+
+	/**
+	 * Writes a deferred message to the log.
+	 *
+	 * The arguments are encoded in the ring of the calling thread and the
+	 * message is formatted by the writer thread of the @ref backend_, see
+	 * @ref deferred::format().
+	 *
+	 * The types of the arguments are given explicitly, see
+	 * @ref deferred::targument.
+	 *
+	 * @pre                       @ref is_deferred()
+	 *
+	 * @param id                  The id of the module.
+	 * @param level               The level of the message.
+	 * @param pack                The arguments of the message.
+	 */
+	template<class... Pack>
+	void
+	log_deferred(const unsigned id, const tlevel level, const Pack&... pack);
+
+	/**
+	 * Are the messages deferred?
+	 *
+	 * Messages can only be deferred in backend mode without a
+	 * @ref pre_process_function_, since that function works on the
+	 * formatted message in the caller's thread.
+	 */
+	bool
+	is_deferred() const;
 
 
 	/***** ***** Setters, getters. ***** *****/
@@ -160,6 +256,29 @@ public:
 	tlevel
 	get_threshold_level(const std::string& module) const;
 
+	/**
+	 * Sets the limits of a module and level.
+	 *
+	 * The limits can be changed at any time, also from other threads than
+	 * the ones logging. The first limit starts the summary thread.
+	 *
+	 * @param module              The name of the module.
+	 * @param level               The level to limit.
+	 * @param rate                The number of messages per second, when
+	 *                            @c 0 the rate is not limited.
+	 * @param burst               The number of messages admitted at once,
+	 *                            at least @c 1.
+	 * @param sample              Only one in every @p sample messages is
+	 *                            admitted, when @c 0 or @c 1 all messages
+	 *                            are admitted.
+	 */
+	void
+	set_limit(const std::string& module
+			, const tlevel level
+			, const unsigned rate
+			, const unsigned burst
+			, const unsigned sample);
+
 	boost::asio::io_service::strand*
 	strand();
 
@@ -179,9 +298,75 @@ private:
 	/**
 	 * The threshold for logging.
 	 *
+	 * The index is the id of the module and the value the integral value
+	 * of its threshold @ref tlevel. The table has static storage, so it's
+	 * zero initialised, which is @ref tlevel::trace.
+	 *
 	 * @see @ref is_active() and @ref log().
 	 */
-	std::map<std::string, tlevel> modules_{};
+	static std::atomic<int> thresholds_[module::count];
+
+	/**
+	 * The limits of a module and level.
+	 *
+	 * The token bucket is implemented as generic cell rate algorithm, the
+	 * bucket is a single time stamp, so it can be updated with a compare
+	 * and exchange.
+	 */
+	struct tlimit
+	{
+		/** Is the level limited? */
+		std::atomic<bool> enabled;
+
+		/** The number of messages per second, @c 0 if not limited. */
+		std::atomic<unsigned> rate;
+
+		/** The number of messages in a burst. */
+		std::atomic<unsigned> burst;
+
+		/** One in every @c sample messages is admitted. */
+		std::atomic<unsigned> sample;
+
+		/** The number of messages sampled. */
+		std::atomic<unsigned> sequence;
+
+		/**
+		 * The theoretical arrival time of the next message.
+		 *
+		 * The time is in nanoseconds since the epoch of the
+		 * @c std::chrono::steady_clock.
+		 */
+		std::atomic<int64_t> arrival;
+
+		/** The number of messages suppressed since the last summary. */
+		std::atomic<uint64_t> suppressed;
+	};
+
+	/**
+	 * The limits.
+	 *
+	 * The first index is the id of the module, the second the integral
+	 * value of the @ref tlevel. The table has static storage, so it's zero
+	 * initialised, which disables all limits.
+	 */
+	static tlimit limits_[module::count][level_count];
+
+	/** Protects the summary thread, used for the @ref summary_condition_. */
+	std::mutex summary_mutex_{};
+
+	/** Signals the summary thread to stop. */
+	std::condition_variable summary_condition_{};
+
+	/** Should the summary thread stop? */
+	bool summary_stop_{false};
+
+	/**
+	 * The thread logging the summaries of the suppressed messages.
+	 *
+	 * Started when the first limit is set, so a summary is also logged when
+	 * no more messages are admitted.
+	 */
+	std::thread summary_thread_{};
 
 	/**
 	 * The strand to use in asynchronous mode.
@@ -193,6 +378,20 @@ private:
 	 */
 	boost::asio::io_service::strand* strand_{nullptr};
 
+	/**
+	 * The backend to use in asynchronous mode.
+	 *
+	 * When set the @ref strand_ is not used.
+	 */
+	tbackend_owner backend_{};
+
+	/**
+	 * Should the messages be deferred in backend mode?
+	 *
+	 * See @ref is_deferred().
+	 */
+	bool deferred_{false};
+
 	/**
 	 * The function used in the @ref pre_processing phase.
 	 *
@@ -229,8 +428,92 @@ private:
 	 */
 	std::ostream*
 	basic_stream_function(const tlevel level);
+
+	/**
+	 * Writes a batch of the @ref backend_.
+	 *
+	 * The messages are collected per stream, so every stream gets a single
+	 * write per batch. After the write the @ref post_process_function_ is
+	 * called for every message written, with the name of its module.
+	 *
+	 * @param entries             The messages to write.
+	 */
+	void
+	write(const std::vector<tbackend::tentry>& entries);
+
+	/**
+	 * Implements @ref admit() for a limited level.
+	 *
+	 * @param id                  The id of the module.
+	 * @param level               The level of the message.
+	 *
+	 * @returns                   Whether the message is admitted.
+	 */
+	static bool
+	admit_limited(const unsigned id, const tlevel level);
+
+	/**
+	 * The main loop of the summary thread.
+	 *
+	 * Logs a summary every @ref summary_interval seconds, and a last one
+	 * when stopped.
+	 */
+	void
+	run_summary();
 };
 
+inline bool
+tmodule_logger::is_active(const unsigned module, const tlevel level)
+{
+	return static_cast<int>(level)
+			>= thresholds_[module].load(std::memory_order_relaxed);
+}
+
+template<class... Pack>
+inline void
+tmodule_logger::log_deferred(
+		  const unsigned id
+		, const tlevel level
+		, const Pack&... pack)
+{
+	tbackend_owner::tuse backend(backend_);
+
+	/* The backend was removed after testing is_deferred(). */
+	if(!backend.get()) {
+		std::string data;
+		deferred::encode<Pack...>(data, pack...);
+		log(id, level, deferred::format<Pack...>(data));
+		return;
+	}
+
+	tbackend::tentry* entry = backend.get()->acquire();
+	if(!entry) {
+		return;
+	}
+
+	entry->module = id;
+	entry->level = level;
+	entry->format = &deferred::format<Pack...>;
+	entry->message.clear();
+	deferred::encode<Pack...>(entry->message, pack...);
+
+	backend.get()->publish();
+}
+
+inline bool
+tmodule_logger::admit(const unsigned module, const tlevel level)
+{
+	return !limits_[module][static_cast<unsigned>(level)]
+				.enabled.load(std::memory_order_relaxed)
+			|| admit_limited(module, level);
+}
+
+inline bool
+tmodule_logger::is_deferred() const
+{
+	return backend_.is_set() && deferred_ && !pre_process_function_;
+}
+
 } // namespace logging
 
 #endif
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/logging/recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+namespace logging {
+namespace recorder {
+
+/** An event in a ring. */
+struct tentry
+{
+	/** The time of the event in nanoseconds of the steady clock. */
+	int64_t time;
+
+	/** The event. */
+	tevent event;
+
+	/** The first argument of the event. */
+	uint64_t first;
+
+	/** The second argument of the event. */
+	uint64_t second;
+};
+
+/** The ring of a thread. */
+struct tring
+{
+	/** The events, the index is the position modulo the capacity. */
+	tentry entries[capacity];
+
+	/** The position of the next event. */
+	std::atomic<size_t> position{0};
+
+	/** The id of the thread, as shown by the operating system. */
+	long thread{0};
+
+	/** The next ring in the list of rings. */
+	tring* next{nullptr};
+};
+
+/** The rings of all threads that recorded an event. */
+static std::atomic<tring*> rings{nullptr};
+
+/** The ring of the calling thread. */
+static __thread tring* thread_ring = nullptr;
+
+/** Is a dump in progress? */
+static std::atomic_flag dumping = ATOMIC_FLAG_INIT;
+
+/** The file to dump the rings to. */
+static char dump_file[4096] = "zard.recorder";
+
+/** The names of the events, in the order of @ref tevent. */
+static const char* const names[] = {
+	  "session_accept"
+	, "session_close"
+	, "frame_received"
+	, "frame_sent"
+	, "command_dispatched"
+	, "handler_duration"
+	, "session_throttled"
+};
+
+/** Creates and registers the ring of the calling thread. */
+static tring*
+create_ring()
+{
+	tring* result = new tring();
+	result->thread = ::syscall(SYS_gettid);
+
+	result->next = rings.load();
+	while(!rings.compare_exchange_weak(result->next, result)) {
+		/* Retry with the new head. */
+	}
+
+	thread_ring = result;
+	return result;
+}
+
+void
+record(const tevent event, const uint64_t first, const uint64_t second)
+{
+	tring* ring = thread_ring;
+	if(!ring) {
+		ring = create_ring();
+	}
+
+	const size_t position = ring->position.load(std::memory_order_relaxed);
+	tentry& entry = ring->entries[position % capacity];
+
+	entry.time = std::chrono::steady_clock::now().time_since_epoch().count();
+	entry.event = event;
+	entry.first = first;
+	entry.second = second;
+
+	ring->position.store(position + 1, std::memory_order_release);
+}
+
+/**
+ * A line of the dump.
+ *
+ * Formats the line without allocating memory, so it can be used in a signal
+ * handler.
+ */
+class tline final
+{
+public:
+	tline()
+		: buffer_()
+	{
+	}
+
+	/** Appends a string. */
+	tline&
+	operator<<(const char* string)
+	{
+		while(*string && size_ != sizeof(buffer_)) {
+			buffer_[size_++] = *string++;
+		}
+		return *this;
+	}
+
+	/** Appends a character. */
+	tline&
+	operator<<(const char c)
+	{
+		if(size_ != sizeof(buffer_)) {
+			buffer_[size_++] = c;
+		}
+		return *this;
+	}
+
+	/** Appends a number. */
+	tline&
+	operator<<(uint64_t value)
+	{
+		char digits[20];
+		unsigned count = 0;
+		do {
+			digits[count++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while(value);
+
+		while(count && size_ != sizeof(buffer_)) {
+			buffer_[size_++] = digits[--count];
+		}
+		return *this;
+	}
+
+	/** Writes the line to a file. */
+	void
+	write(const int fd) const
+	{
+		size_t offset = 0;
+		while(offset != size_) {
+			const ssize_t written =
+					::write(fd, buffer_ + offset, size_ - offset);
+			if(written < 0 && errno == EINTR) {
+				continue;
+			}
+			if(written <= 0) {
+				return;
+			}
+			offset += static_cast<size_t>(written);
+		}
+	}
+
+private:
+
+	/** The contents of the line. */
+	char buffer_[128];
+
+	/** The size of the contents. */
+	size_t size_{0};
+};
+
+bool
+dump()
+{
+	if(dumping.test_and_set()) {
+		return false;
+	}
+
+	const int fd = ::open(dump_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd == -1) {
+		dumping.clear();
+		return false;
+	}
+
+	for(tring* ring = rings.load(); ring; ring = ring->next) {
+		(tline() << "thread " << static_cast<uint64_t>(ring->thread) << '\n')
+				.write(fd);
+
+		const size_t end = ring->position.load(std::memory_order_acquire);
+		const size_t begin = end > capacity ? end - capacity : 0;
+		for(size_t position = begin; position != end; ++position) {
+			const tentry& entry = ring->entries[position % capacity];
+			const unsigned event = static_cast<unsigned>(entry.event);
+
+			(tline() << static_cast<uint64_t>(entry.time)
+					<< ' ' << (event < sizeof(names) / sizeof(names[0])
+						? names[event] : "unknown")
+					<< ' ' << entry.first
+					<< ' ' << entry.second
+					<< '\n').write(fd);
+		}
+	}
+
+	::close(fd);
+	dumping.clear();
+	return true;
+}
+
+/** Dumps the rings and raises the signal again. */
+static void
+fatal_signal_handler(const int signal)
+{
+	dump();
+
+	/* The handler is reset, so the default action terminates. */
+	::raise(signal);
+}
+
+void
+install_signal_handlers()
+{
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = fatal_signal_handler;
+	action.sa_flags = SA_RESETHAND | SA_NODEFER;
+	sigemptyset(&action.sa_mask);
+
+	for(const int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+		::sigaction(signal, &action, nullptr);
+	}
+}
+
+void
+set_dump_file(const std::string& filename)
+{
+	const size_t size = std::min(filename.size(), sizeof(dump_file) - 1);
+	std::memcpy(dump_file, filename.data(), size);
+	dump_file[size] = '\0';
+}
+
+} // namespace recorder
+} // namespace logging
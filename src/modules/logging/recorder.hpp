@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * Contains the flight recorder.
+ *
+ * The flight recorder always records the recent events of every thread,
+ * regardless of the log levels. Every thread records to its own ring of
+ * @ref recorder::capacity events, the oldest events are overwritten. The
+ * rings are only read when they are dumped, e.g. after a crash, so
+ * recording an event only costs a few stores.
+ *
+ * The rings are never freed, so they can be dumped from a signal handler and
+ * the events of terminated threads remain available.
+ */
+
+#ifndef MODULES_LOGGING_RECORDER_HPP_INCLUDED
+#define MODULES_LOGGING_RECORDER_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+namespace logging {
+namespace recorder {
+
+/***** ***** Types. ***** *****/
+
+/**
+ * The events recorded.
+ *
+ * The meaning of the arguments of an event is documented with the event.
+ *
+ * @note The events don't use the stream operators of
+ * @ref lib/string/enumerate.tpp, the dump needs to be async-signal-safe.
+ */
+enum class tevent : uint32_t
+{
+	/** A session is accepted, the argument is the session. */
+	  session_accept
+
+	/** A session is closed, the argument is the session. */
+	, session_close
+
+	/** A frame is received, the arguments are the connection and size. */
+	, frame_received
+
+	/** A frame is sent, the arguments are the connection and size. */
+	, frame_sent
+
+	/** A command is dispatched, the arguments are the session and mode. */
+	, command_dispatched
+
+	/**
+	 * A command handler finished, the arguments are the session and the
+	 * duration of the handler in nanoseconds.
+	 */
+	, handler_duration
+
+	/**
+	 * Receiving is paused for a session over its quota, the arguments are
+	 * the session and the pause in nanoseconds.
+	 */
+	, session_throttled
+};
+
+/** The number of events in the ring of a thread. */
+static const unsigned capacity = 1024;
+
+
+/***** ***** Operators. ***** *****/
+
+/**
+ * Records an event in the ring of the calling thread.
+ *
+ * @param event                   The event to record.
+ * @param first                   The first argument of the event.
+ * @param second                  The second argument of the event.
+ */
+void
+record(const tevent event, const uint64_t first, const uint64_t second = 0);
+
+/**
+ * Records an event in the ring of the calling thread.
+ *
+ * Convenience overload for the events referring to an object.
+ *
+ * @param event                   The event to record.
+ * @param object                  The object the event refers to.
+ * @param second                  The second argument of the event.
+ */
+inline void
+record(const tevent event, const void* object, const uint64_t second = 0)
+{
+	record(event, reinterpret_cast<uintptr_t>(object), second);
+}
+
+/**
+ * Dumps the rings of all threads to the dump file.
+ *
+ * The function is async-signal-safe. The rings are not locked, so the
+ * last events of a thread that records while dumping may be torn.
+ *
+ * @returns                       Whether the rings are dumped, when another
+ *                                dump is in progress or the file can't be
+ *                                opened the rings are not dumped.
+ */
+bool
+dump();
+
+/**
+ * Installs the handlers dumping the rings on a fatal signal.
+ *
+ * The handlers handle @c SIGSEGV, @c SIGBUS, @c SIGFPE, @c SIGILL and
+ * @c SIGABRT. After dumping the signal is raised again with its default
+ * action.
+ */
+void
+install_signal_handlers();
+
+
+/***** ***** Setters, getters. ***** *****/
+
+/**
+ * Sets the file to dump the rings to.
+ *
+ * The name is copied to a static buffer, so it can be used by the signal
+ * handlers. The default file is @c zard.recorder in the working directory.
+ *
+ * @param filename                The name of the file, a name longer than
+ *                                the buffer is truncated.
+ */
+void
+set_dump_file(const std::string& filename);
+
+} // namespace recorder
+} // namespace logging
+
+#endif
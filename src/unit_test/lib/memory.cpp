@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "lib/memory/memory_resource.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <list>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(lib_memory_monotonic)
+{
+	char buffer[64];
+	lib::tmonotonic_resource arena(buffer, sizeof(buffer));
+
+	/* The first allocations use the buffer. */
+	char* first = static_cast<char*>(arena.allocate(10, 1));
+	char* second = static_cast<char*>(arena.allocate(8, 8));
+	BOOST_CHECK(first == buffer);
+	BOOST_CHECK(second >= first + 10 && second + 8 <= buffer + 64);
+	BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(second) % 8, 0u);
+
+	/* Larger allocations use the upstream resource. */
+	char* third = static_cast<char*>(arena.allocate(100, 1));
+	BOOST_CHECK(third < buffer || third >= buffer + 64);
+
+	/* After releasing the buffer is reused. */
+	arena.release();
+	BOOST_CHECK(arena.allocate(10, 1) == buffer);
+}
+
+BOOST_AUTO_TEST_CASE(lib_memory_allocator)
+{
+	char buffer[64];
+	lib::tmonotonic_resource arena(buffer, sizeof(buffer));
+
+	lib::tstring string{lib::tallocator<char>(&arena)};
+	for(unsigned i = 0; i < 1000; ++i) {
+		string += 'x';
+	}
+	BOOST_CHECK_EQUAL(string.size(), 1000u);
+	BOOST_CHECK(string.get_allocator().resource() == &arena);
+
+	std::list<unsigned, lib::tallocator<unsigned>> list{
+			lib::tallocator<unsigned>(lib::thread_pool_resource())};
+
+	unsigned sum = 0;
+	for(unsigned i = 0; i < 100; ++i) {
+		list.push_back(i);
+		sum += i;
+	}
+	for(const unsigned value : list) {
+		sum -= value;
+	}
+	BOOST_CHECK_EQUAL(sum, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(lib_memory_thread_pool)
+{
+	lib::tmemory_resource* resource = lib::thread_pool_resource();
+
+	/* A deallocated block is reused for the next block of its size. */
+	void* block = resource->allocate(100);
+	resource->deallocate(block, 100);
+	BOOST_CHECK(resource->allocate(120) == block);
+	resource->deallocate(block, 120);
+
+	std::vector<void*> blocks;
+	for(size_t size = 1; size < 4096; size *= 3) {
+		blocks.push_back(resource->allocate(size));
+		BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(blocks.back())
+				% lib::tmemory_resource::max_alignment, 0u);
+	}
+	for(size_t size = 1, i = 0; size < 4096; size *= 3, ++i) {
+		resource->deallocate(blocks[i], size);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(lib_memory_thread_pool_release)
+{
+	lib::tmemory_resource* resource = lib::thread_pool_resource();
+	const size_t before = lib::thread_pool_size();
+
+	std::vector<void*> blocks;
+	for(size_t i = 0; i < 10000; ++i) {
+		blocks.push_back(resource->allocate(64));
+	}
+	BOOST_CHECK_GE(lib::thread_pool_size(), before + 10000 * 64);
+
+	/* The empty chunks are released, except for one. */
+	for(void* block : blocks) {
+		resource->deallocate(block, 64);
+	}
+	BOOST_CHECK_LE(lib::thread_pool_size(), before + 16384);
+}
+
+BOOST_AUTO_TEST_CASE(lib_memory_thread_pool_other_thread)
+{
+	lib::tmemory_resource* resource = lib::thread_pool_resource();
+	const size_t before = lib::thread_pool_size();
+
+	std::vector<void*> blocks;
+	for(size_t i = 0; i < 1000; ++i) {
+		blocks.push_back(resource->allocate(200));
+	}
+	const size_t used = lib::thread_pool_size();
+
+	/* The blocks are returned to this thread's pools. */
+	std::thread([&]()
+		{
+			for(void* block : blocks) {
+				resource->deallocate(block, 200);
+			}
+			BOOST_CHECK_EQUAL(lib::thread_pool_size(), 0u);
+		}).join();
+
+	BOOST_CHECK_EQUAL(lib::thread_pool_size(), used);
+
+	/* Once the pool is empty the returned blocks are used again. */
+	for(void*& block : blocks) {
+		block = resource->allocate(200);
+	}
+	BOOST_CHECK_LE(lib::thread_pool_size(), used);
+
+	for(void* block : blocks) {
+		resource->deallocate(block, 200);
+	}
+	BOOST_CHECK_LE(lib::thread_pool_size(), before + 16384);
+}
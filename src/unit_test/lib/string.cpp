@@ -13,10 +13,13 @@
  */
 
 #include "lib/string/concatenate.tpp"
+#include "lib/string/string_view.tpp"
 
 #include <boost/test/unit_test.hpp>
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 
 BOOST_AUTO_TEST_CASE(lib_string_concatenate)
 {
@@ -25,6 +28,65 @@ BOOST_AUTO_TEST_CASE(lib_string_concatenate)
 	BOOST_CHECK_EQUAL(test, "abc1233.141");
 }
 
+/** Concatenates the arguments with a stream, the reference for the tests. */
+template<class... Pack>
+static std::string
+stream(const Pack&... pack)
+{
+	std::stringstream sstr;
+	lib::stream(sstr, pack...);
+	return sstr.str();
+}
+
+BOOST_AUTO_TEST_CASE(lib_string_concatenate_stream)
+{
+	const char* null = nullptr;
+	const std::string string = "string";
+	char array[16] = "array";
+
+	BOOST_CHECK_EQUAL(lib::concatenate(), "");
+	BOOST_CHECK_EQUAL(lib::concatenate(string, array, null, 'c')
+			, stream(string, array, 'c'));
+
+	BOOST_CHECK_EQUAL(
+			  lib::concatenate(0, 9, 10, 99, 100, -1, true, false)
+			, stream(0, 9, 10, 99, 100, -1, true, false));
+
+	BOOST_CHECK_EQUAL(
+			  lib::concatenate(
+				  std::numeric_limits<int64_t>::min()
+				, ' '
+				, std::numeric_limits<int64_t>::max()
+				, ' '
+				, std::numeric_limits<uint64_t>::max()
+				, ' '
+				, std::numeric_limits<short>::min())
+			, stream(
+				  std::numeric_limits<int64_t>::min()
+				, ' '
+				, std::numeric_limits<int64_t>::max()
+				, ' '
+				, std::numeric_limits<uint64_t>::max()
+				, ' '
+				, std::numeric_limits<short>::min()));
+
+	BOOST_CHECK_EQUAL(
+			  lib::concatenate(
+				  static_cast<signed char>('s')
+				, static_cast<unsigned char>('u'))
+			, "su");
+
+	BOOST_CHECK_EQUAL(
+			  lib::concatenate(0.0, ' ', -2.5f, ' ', 1e-5, ' ', 1234567.0
+				, ' ', 1e300, ' ', 0.1L)
+			, stream(0.0, ' ', -2.5f, ' ', 1e-5, ' ', 1234567.0
+				, ' ', 1e300, ' ', 0.1L));
+
+	std::string buffer = "buffer ";
+	BOOST_CHECK_EQUAL(lib::append(buffer, 1, ' ', string), "buffer 1 string");
+	BOOST_CHECK_EQUAL(buffer, "buffer 1 string");
+}
+
 enum class tunit_test
 {
 	  enum1 = 0
@@ -43,6 +105,26 @@ ENUM_DECLARE_STREAM_OPERATORS(tunit_test)
 
 ENUM_DEFINE_STREAM_OPERATORS(ENUM_TYPE)
 
+BOOST_AUTO_TEST_CASE(lib_string_concatenate_enum)
+{
+	BOOST_CHECK_EQUAL(
+			  lib::concatenate("'", tunit_test::enum1, "' '"
+				, tunit_test::enum2, "'")
+			, "'Enum 1' 'Enum 2'");
+}
+
+BOOST_AUTO_TEST_CASE(lib_string_enum_hash)
+{
+	static_assert(detail::enum_hash("") == 2166136261u
+			, "The hash of an empty string is the offset basis.");
+
+	BOOST_CHECK_EQUAL(detail::enum_hash("Enum 1")
+			, detail::enum_hash(std::string("Enum 1")));
+
+	BOOST_CHECK_EQUAL(detail::enum_hash("E_INVALID_VALUE")
+			, detail::enum_hash(std::string("E_INVALID_VALUE")));
+}
+
 BOOST_AUTO_TEST_CASE(lib_string_enum)
 {
 	/*** Input ***/
@@ -88,8 +170,27 @@ BOOST_AUTO_TEST_CASE(lib_string_enum)
 	}
 
 
+	{
+		/* A string with an embedded nul is not truncated. */
+		std::string str("Enum 1");
+		str += '\0';
+		tunit_test estr;
+
+		BOOST_CHECK_EXCEPTION(
+				  str >> estr;
+				, lib::texception
+				, [](const lib::texception& exception)
+					{
+						return exception.type
+								== lib::texception::ttype::invalid_value;
+					});
+	}
+
+
 	/*** Output ***/
 
+	BOOST_CHECK_EQUAL(enum_to_string(tunit_test::enum1), std::string("Enum 1"));
+
 	{
 		std::string str;
 		std::stringstream sstr;
@@ -125,3 +226,83 @@ BOOST_AUTO_TEST_CASE(lib_string_enum)
 					});
 	}
 }
+
+BOOST_AUTO_TEST_CASE(lib_string_string_view)
+{
+	const std::string string = "game create id";
+	const lib::tstring_view view(string);
+
+	/* A copy, since the checks take a reference, which odr-uses npos. */
+	const size_t npos = lib::tstring_view::npos;
+
+	BOOST_CHECK_EQUAL(view.size(), string.size());
+	BOOST_CHECK(view.data() == string.data());
+	BOOST_CHECK(lib::tstring_view().empty());
+
+	/*** Substr ***/
+
+	BOOST_CHECK_EQUAL(view.substr(5).str(), "create id");
+	BOOST_CHECK_EQUAL(view.substr(5, 6).str(), "create");
+	BOOST_CHECK_EQUAL(view.substr(12, 100).str(), "id");
+	BOOST_CHECK_EQUAL(view.substr(0, 0).str(), "");
+	BOOST_CHECK(view.substr(string.size()).empty());
+	BOOST_CHECK(view.substr(string.size() + 1).empty());
+	BOOST_CHECK(view.substr(npos).empty());
+
+	/*** Find ***/
+
+	BOOST_CHECK_EQUAL(view.find(' '), 4u);
+	BOOST_CHECK_EQUAL(view.find(' ', 4), 4u);
+	BOOST_CHECK_EQUAL(view.find(' ', 5), 11u);
+	BOOST_CHECK_EQUAL(view.find('x'), npos);
+	BOOST_CHECK_EQUAL(view.find(' ', 100), npos);
+	BOOST_CHECK_EQUAL(lib::tstring_view().find(' '), npos);
+
+	/*** Compare ***/
+
+	BOOST_CHECK(view == lib::tstring_view("game create id"));
+	BOOST_CHECK(view.substr(0, 4) == "game");
+	BOOST_CHECK(view != "game create");
+	BOOST_CHECK(view != "game create ix");
+	BOOST_CHECK(lib::tstring_view("a\0b", 3) != lib::tstring_view("a\0c", 3));
+	BOOST_CHECK(lib::tstring_view() == "");
+
+	/*** Output ***/
+
+	BOOST_CHECK_EQUAL(lib::concatenate('\'', view.substr(5, 6), '\'')
+			, "'create'");
+
+	std::stringstream sstr;
+	sstr << view.substr(12);
+	BOOST_CHECK_EQUAL(sstr.str(), "id");
+}
+
+BOOST_AUTO_TEST_CASE(lib_string_parse)
+{
+	uint32_t value = 42;
+
+	BOOST_CHECK(lib::parse("0", value));
+	BOOST_CHECK_EQUAL(value, 0u);
+
+	BOOST_CHECK(lib::parse("00123", value));
+	BOOST_CHECK_EQUAL(value, 123u);
+
+	BOOST_CHECK(lib::parse("4294967295", value));
+	BOOST_CHECK_EQUAL(value, 4294967295u);
+
+	/* The value is only modified upon success. */
+	value = 42;
+	BOOST_CHECK(!lib::parse("", value));
+	BOOST_CHECK(!lib::parse("-1", value));
+	BOOST_CHECK(!lib::parse("+1", value));
+	BOOST_CHECK(!lib::parse(" 1", value));
+	BOOST_CHECK(!lib::parse("1 ", value));
+	BOOST_CHECK(!lib::parse("12a", value));
+	BOOST_CHECK(!lib::parse("4294967296", value));
+	BOOST_CHECK(!lib::parse("99999999999999999999999", value));
+	BOOST_CHECK_EQUAL(value, 42u);
+
+	/* Only the viewed characters are parsed. */
+	BOOST_CHECK(lib::parse(lib::tstring_view("123456", 3), value));
+	BOOST_CHECK_EQUAL(value, 123u);
+}
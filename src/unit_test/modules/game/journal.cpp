@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/game/journal.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(modules_game_journal_encode)
+{
+	typedef game::tjournal::trecord trecord;
+
+	const std::vector<trecord> records{
+			  trecord{"join", "player"}
+			, trecord{}
+			, trecord{"command", "", std::string("\0\n\xff", 3)}};
+
+	std::string data;
+	for(const trecord& record : records) {
+		data += game::tjournal::encode(record);
+	}
+
+	std::vector<trecord> result;
+	BOOST_CHECK_EQUAL(game::tjournal::decode(data, result), data.size());
+	BOOST_CHECK(result == records);
+
+	/* A torn record is not decoded, the records before it are. */
+	const size_t last = data.size() - game::tjournal::encode(records[2]).size();
+	for(size_t size = last; size != data.size(); ++size) {
+		result.clear();
+		BOOST_CHECK_EQUAL(
+				  game::tjournal::decode(data.substr(0, size), result)
+				, last);
+		BOOST_CHECK_EQUAL(result.size(), 2u);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(modules_game_journal_filename)
+{
+	BOOST_CHECK_EQUAL(game::tjournal::encode_filename(""), "");
+	BOOST_CHECK_EQUAL(game::tjournal::encode_filename("a/b"), "612f62");
+	BOOST_CHECK_EQUAL(game::tjournal::encode_filename("\xff"), "ff");
+
+	const std::string id("game/\0\xff id", 11);
+	std::string game;
+	BOOST_CHECK(game::tjournal::decode_filename(
+			game::tjournal::encode_filename(id), game));
+	BOOST_CHECK_EQUAL(game, id);
+
+	BOOST_CHECK(!game::tjournal::decode_filename("6", game));
+	BOOST_CHECK(!game::tjournal::decode_filename("6g", game));
+	BOOST_CHECK(!game::tjournal::decode_filename("6F", game));
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/game/journal.hpp"
+#include "modules/game/record_writer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include <cstdio>
+
+BOOST_AUTO_TEST_CASE(modules_game_record_writer)
+{
+	typedef game::tjournal::trecord trecord;
+
+	std::FILE* file = std::tmpfile();
+	BOOST_REQUIRE(file);
+	const int fd = fileno(file);
+
+	/* The large field doesn't fit in the buffer of the writer. */
+	const std::string large(100000, 'x');
+	const std::vector<trecord> records{
+			  trecord{"session", "id", "0", "1"}
+			, trecord{}
+			, trecord{"snapshot", large, std::string("\0\n", 2)}};
+
+	game::trecord_writer writer(fd);
+	writer.record({"session", "id", "0", "1"});
+	writer.record({});
+
+	writer.begin(game::trecord_writer::field_size("snapshot")
+			+ game::trecord_writer::field_size(large)
+			+ game::trecord_writer::field_size(records[2][2]));
+	writer.field("snapshot");
+	writer.field(large);
+	writer.field(records[2][2]);
+
+	BOOST_CHECK(writer.flush());
+	BOOST_CHECK_EQUAL(writer.records(), 3u);
+
+	std::string expected;
+	for(const trecord& record : records) {
+		expected += game::tjournal::encode(record);
+	}
+
+	std::string data(expected.size() + 1, '\0');
+	BOOST_REQUIRE_EQUAL(::lseek(fd, 0, SEEK_SET), 0);
+	data.resize(static_cast<size_t>(::read(fd, &data[0], data.size())));
+	BOOST_CHECK(data == expected);
+
+	std::fclose(file);
+
+	game::trecord_writer::tnumber buffer;
+	BOOST_CHECK(game::trecord_writer::format(0, buffer) == "0");
+	BOOST_CHECK(game::trecord_writer::format(42, buffer) == "42");
+	BOOST_CHECK(game::trecord_writer::format(4294967295u, buffer)
+			== "4294967295");
+}
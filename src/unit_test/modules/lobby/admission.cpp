@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/detail/admission.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+/** Returns the IPv4 address with number @p index. */
+static boost::asio::ip::address
+address(const uint32_t index)
+{
+	return boost::asio::ip::address_v4(0x0a000000u + index);
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_admission_unlimited)
+{
+	lobby::detail::tadmission admission(0, 0, 0);
+
+	for(int i = 0; i < 100; ++i) {
+		BOOST_CHECK(admission.admit(address(1)));
+	}
+	for(int i = 0; i < 100; ++i) {
+		admission.release(address(1));
+	}
+
+	BOOST_CHECK_EQUAL(admission.get_refused(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_admission_max_connections)
+{
+	lobby::detail::tadmission admission(2, 0, 0);
+
+	BOOST_CHECK(admission.admit(address(1)));
+	BOOST_CHECK(admission.admit(address(2)));
+	BOOST_CHECK(!admission.admit(address(3)));
+	BOOST_CHECK_EQUAL(admission.get_refused(), 1u);
+
+	admission.release(address(1));
+	BOOST_CHECK(admission.admit(address(3)));
+	BOOST_CHECK(!admission.admit(address(1)));
+	BOOST_CHECK_EQUAL(admission.get_refused(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_admission_per_address)
+{
+	lobby::detail::tadmission admission(0, 2, 0);
+
+	BOOST_CHECK(admission.admit(address(1)));
+	BOOST_CHECK(admission.admit(address(1)));
+	BOOST_CHECK(!admission.admit(address(1)));
+
+	/* The limit is per address. */
+	BOOST_CHECK(admission.admit(address(2)));
+	BOOST_CHECK(admission.admit(
+			boost::asio::ip::address::from_string("::1")));
+
+	admission.release(address(1));
+	BOOST_CHECK(admission.admit(address(1)));
+	BOOST_CHECK_EQUAL(admission.get_refused(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_admission_grow)
+{
+	lobby::detail::tadmission admission(0, 1, 0);
+
+	/* The table grows beyond its initial size and keeps its entries. */
+	for(uint32_t i = 0; i < 10000; ++i) {
+		BOOST_CHECK(admission.admit(address(i)));
+	}
+	for(uint32_t i = 0; i < 10000; ++i) {
+		BOOST_CHECK(!admission.admit(address(i)));
+	}
+	BOOST_CHECK_EQUAL(admission.get_refused(), 10000u);
+
+	for(uint32_t i = 0; i < 10000; ++i) {
+		admission.release(address(i));
+	}
+	BOOST_CHECK(admission.admit(address(0)));
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_admission_rate_per_address)
+{
+	lobby::detail::tadmission admission(0, 0, 2);
+
+	/* Start at the beginning of a second, the rate is per second. */
+	std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+			std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::steady_clock::now().time_since_epoch())
+			+ std::chrono::seconds(1)));
+
+	BOOST_CHECK(admission.admit(address(1)));
+	admission.release(address(1));
+	BOOST_CHECK(admission.admit(address(1)));
+	admission.release(address(1));
+	BOOST_CHECK(!admission.admit(address(1)));
+
+	/* The limit is per address. */
+	BOOST_CHECK(admission.admit(address(2)));
+	BOOST_CHECK_EQUAL(admission.get_refused(), 1u);
+}
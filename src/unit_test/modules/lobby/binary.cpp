@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/binary.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+
+BOOST_AUTO_TEST_CASE(modules_lobby_binary_varint)
+{
+	const uint32_t values[] {
+		  0
+		, 1
+		, 0x7f
+		, 0x80
+		, 0x3fff
+		, 0x4000
+		, 0x0fffffff
+		, 0x10000000
+		, std::numeric_limits<uint32_t>::max()};
+
+	for(const uint32_t value : values) {
+		std::string buffer;
+		lobby::binary::append_varint(buffer, value);
+		buffer += "tail";
+
+		lib::tstring_view view(buffer);
+		uint32_t result = 0;
+		BOOST_CHECK(lobby::binary::read_varint(view, result));
+		BOOST_CHECK_EQUAL(result, value);
+		BOOST_CHECK_EQUAL(view.str(), "tail");
+	}
+
+	std::string buffer;
+	lobby::binary::append_varint(buffer, 0x80);
+	BOOST_CHECK_EQUAL(buffer, "\x80\x01");
+
+	/*** The value is only modified upon success. ***/
+
+	const uint32_t unmodified = 42;
+
+	/* Truncated, the last byte has its continuation bit set. */
+	const std::string truncated[] {"", "\x80", "\xff\xff", "\xff\xff\xff\xff"};
+	for(const std::string& data : truncated) {
+		lib::tstring_view view(data);
+		uint32_t result = unmodified;
+		BOOST_CHECK(!lobby::binary::read_varint(view, result));
+		BOOST_CHECK_EQUAL(result, unmodified);
+		BOOST_CHECK_EQUAL(view.size(), data.size());
+	}
+
+	/* Overflow, more than 32 bits or more than 5 bytes. */
+	const std::string overflow[] {
+		  "\xff\xff\xff\xff\x10"
+		, "\xff\xff\xff\xff\x7f"
+		, "\x80\x80\x80\x80\x80\x00"};
+
+	for(const std::string& data : overflow) {
+		lib::tstring_view view(data);
+		uint32_t result = unmodified;
+		BOOST_CHECK(!lobby::binary::read_varint(view, result));
+		BOOST_CHECK_EQUAL(result, unmodified);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_binary_arguments)
+{
+	const std::string long_argument(300, 'x');
+	const std::string command = lobby::binary::encode_command(
+			  5
+			, {"my game", "", long_argument});
+
+	BOOST_CHECK_EQUAL(command[0], '\x05');
+
+	lobby::targuments arguments;
+	BOOST_CHECK(lobby::binary::decode_arguments(
+			  lib::tstring_view(command).substr(1)
+			, arguments));
+
+	BOOST_REQUIRE_EQUAL(arguments.size(), 3u);
+	BOOST_CHECK(arguments[0] == "my game");
+	BOOST_CHECK(arguments[1] == "");
+	BOOST_CHECK(arguments[2] == long_argument);
+
+	/* The arguments are views on the command. */
+	BOOST_CHECK(arguments[0].data() == command.data() + 2);
+
+	/* A truncated last argument or its size. */
+	for(size_t size = 10; size < command.size() - 1; ++size) {
+		const lib::tstring_view truncated(command.data() + 1, size);
+
+		lobby::targuments result;
+		BOOST_CHECK(!lobby::binary::decode_arguments(truncated, result));
+	}
+
+	/* Too many arguments. */
+	std::string many;
+	for(size_t i = 0; i <= lobby::targuments::capacity; ++i) {
+		many += '\0';
+	}
+
+	lobby::targuments result;
+	BOOST_CHECK(!lobby::binary::decode_arguments(many, result));
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_binary_reply)
+{
+	BOOST_CHECK_EQUAL(
+			  lobby::binary::encode_reply("OK\nJoined game.\n")
+			, std::string("\0Joined game.\n", 14));
+
+	BOOST_CHECK_EQUAL(
+			  lobby::binary::encode_reply("EINVAL\n")
+			, "\x01");
+
+	BOOST_CHECK_EQUAL(
+			  lobby::binary::encode_reply("player joined name\n")
+			, "\xffplayer joined name\n");
+}
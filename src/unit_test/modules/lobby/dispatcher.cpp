@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/binary.hpp"
+#include "modules/lobby/dispatcher.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+/** The handler called last and its arguments, separated by a '|'. */
+static std::string called;
+static std::string arguments;
+
+/** Returns a handler storing its name and arguments. */
+static lobby::tdispatcher::thandler
+handler(const std::string& name)
+{
+	return [name](lobby::tsession&, const lobby::targuments& arguments__)
+		{
+			called = name;
+			for(const lib::tstring_view& argument : arguments__) {
+				lib::append(arguments, argument, '|');
+			}
+			return lib::tresult();
+		};
+}
+
+/** Dispatches a command, returns whether a handler succeeded. */
+static bool
+dispatch(
+		  const lobby::tdispatcher& dispatcher
+		, lobby::tsession& session
+		, const std::string& command)
+{
+	called.clear();
+	arguments.clear();
+	return static_cast<bool>(dispatcher.dispatch(session, command));
+}
+
+BOOST_AUTO_TEST_CASE(modules_lobby_dispatcher)
+{
+	typedef lobby::tsession::tmode tmode;
+	typedef lobby::tdispatcher::tbatch tbatch;
+
+	boost::asio::io_service io_service;
+	lobby::tsession session(io_service);
+	session.set_mode(tmode::lobby);
+
+	lobby::tdispatcher dispatcher;
+	dispatcher
+			.add("game", 1, {tmode::lobby}, handler("game"))
+			.add("game create", 2, {tmode::lobby}, handler("game create"))
+			.add("game join", 3, {tmode::lobby}, handler("game join")
+				, tbatch::forbidden)
+			.add("user", 4, {tmode::connected}, handler("user"));
+
+	/*** The longest verb matches. ***/
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game create id"));
+	BOOST_CHECK_EQUAL(called, "game create");
+	BOOST_CHECK_EQUAL(arguments, "id|");
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game join"));
+	BOOST_CHECK_EQUAL(called, "game join");
+	BOOST_CHECK_EQUAL(arguments, "");
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game open id"));
+	BOOST_CHECK_EQUAL(called, "game");
+	BOOST_CHECK_EQUAL(arguments, "open|id|");
+
+	/*** A verb only matches a whole word. ***/
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game creates id"));
+	BOOST_CHECK_EQUAL(called, "game");
+	BOOST_CHECK_EQUAL(arguments, "creates|id|");
+
+	/*** The arguments are separated by a single space. ***/
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game a  b "));
+	BOOST_CHECK_EQUAL(arguments, "a||b||");
+
+	BOOST_CHECK(!dispatch(dispatcher, session
+			, "game 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17"));
+	BOOST_CHECK_EQUAL(called, "");
+
+	BOOST_CHECK(!dispatch(dispatcher, session, "gamer"));
+	BOOST_CHECK(!dispatch(dispatcher, session, "gam"));
+	BOOST_CHECK(!dispatch(dispatcher, session, "unknown"));
+	BOOST_CHECK_EQUAL(called, "");
+
+	/*** A trailing newline is ignored. ***/
+
+	BOOST_CHECK(dispatch(dispatcher, session, "game join id\n"));
+	BOOST_CHECK_EQUAL(called, "game join");
+	BOOST_CHECK_EQUAL(arguments, "id|");
+
+	/*** A batch executes every command, unless forbidden. ***/
+
+	std::string reply;
+	{
+		const lobby::tsession::tcapture capture(session, reply);
+		BOOST_CHECK(dispatch(dispatcher, session
+				, "batch\ngame create id\n\ngame join id\nunknown\n"));
+	}
+	BOOST_CHECK_EQUAL(called, "game create");
+	BOOST_CHECK_EQUAL(arguments, "id|");
+	BOOST_CHECK_EQUAL(reply
+			, "OK\n3\n0\n"
+				"45\nEINVAL\nThe command can't be part of a batch.\n"
+				"24\nEINVAL\nUnknown command.\n");
+
+	/*** An empty command is ignored. ***/
+
+	BOOST_CHECK(dispatch(dispatcher, session, ""));
+	BOOST_CHECK_EQUAL(called, "");
+
+	/*** A command is only available in its modes. ***/
+
+	BOOST_CHECK(!dispatch(dispatcher, session, "user name"));
+	BOOST_CHECK_EQUAL(called, "");
+
+	session.set_mode(tmode::connected);
+	BOOST_CHECK(dispatch(dispatcher, session, "user name"));
+	BOOST_CHECK_EQUAL(called, "user");
+	BOOST_CHECK(!dispatch(dispatcher, session, "game create id"));
+
+	/*** The fallback gets the entire unknown command. ***/
+
+	dispatcher.set_fallback({tmode::connected}, handler("fallback"));
+
+	BOOST_CHECK(dispatch(dispatcher, session, "unknown command"));
+	BOOST_CHECK_EQUAL(called, "fallback");
+	BOOST_CHECK_EQUAL(arguments, "unknown command|");
+
+	/*** The binary encoding uses the same handlers. ***/
+
+	session.set_mode(tmode::lobby);
+	session.set_encoding(lobby::tsession::tencoding::binary);
+
+	BOOST_CHECK(dispatch(dispatcher, session
+			, lobby::binary::encode_command(2, {"my game", ""})));
+	BOOST_CHECK_EQUAL(called, "game create");
+	BOOST_CHECK_EQUAL(arguments, "my game||");
+
+	BOOST_CHECK(dispatch(dispatcher, session
+			, lobby::binary::encode_command(3, {})));
+	BOOST_CHECK_EQUAL(called, "game join");
+	BOOST_CHECK_EQUAL(arguments, "");
+
+	BOOST_CHECK(!dispatch(dispatcher, session
+			, lobby::binary::encode_command(5, {"id"})));
+	BOOST_CHECK_EQUAL(called, "");
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012 by Mark de Wever <koraq@xs4all.nl>
+ * Part of the zar project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY.
+ *
+ * See the COPYING file for more details.
+ */
+
+#include "modules/lobby/detail/quota.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+/** The number of nanoseconds in a millisecond. */
+static const int64_t ms = 1000000;
+
+BOOST_AUTO_TEST_CASE(modules_lobby_quota_charge)
+{
+	using lobby::detail::charge;
+
+	/*** An unlimited bucket is never charged. ***/
+
+	int64_t arrival = 0;
+	BOOST_CHECK_EQUAL(charge(arrival, 1000, 0, 0, 0), 0);
+	BOOST_CHECK_EQUAL(arrival, 0);
+
+	/*** A bucket of 10 tokens per second with a burst of 3. ***/
+
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 0), 0);
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 0), 0);
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 0), 0);
+	BOOST_CHECK_EQUAL(arrival, 300 * ms);
+
+	/* The burst is used, wait for the next token. */
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 0), 100 * ms);
+	BOOST_CHECK_EQUAL(arrival, 400 * ms);
+
+	/* A token is available after its interval. */
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 200 * ms), 0);
+
+	/* An idle bucket doesn't save more than its burst. */
+	arrival = 0;
+	for(int i = 0; i < 3; ++i) {
+		BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 10000 * ms), 0);
+	}
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 3, 10000 * ms), 100 * ms);
+
+	/*** A burst of 0 allows one token. ***/
+
+	arrival = 0;
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 0, 0), 0);
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 10, 0, 0), 100 * ms);
+
+	/*** Charging multiple tokens, e.g. bytes. ***/
+
+	arrival = 0;
+	BOOST_CHECK_EQUAL(charge(arrival, 150, 1000, 100, 0), 50 * ms);
+	BOOST_CHECK_EQUAL(charge(arrival, 50, 1000, 100, 50 * ms), 50 * ms);
+	BOOST_CHECK_EQUAL(charge(arrival, 1, 1000, 100, 200 * ms), 0);
+}
@@ -24,6 +24,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 
+#include <sstream>
 #include <thread>
 
 /**
@@ -43,6 +44,99 @@ struct tlog_level_convertor
 	}
 };
 
+/**
+ * Helper conversion structure.
+ *
+ * Allows @ref boost::property_tree::ptree to use a @ref logging::tfull_policy
+ * as variable.
+ */
+struct tfull_policy_convertor
+{
+	logging::tfull_policy
+	get_value(const std::string& value) const
+	{
+		logging::tfull_policy result;
+		value >> result;
+		return result;
+	}
+};
+
+/**
+ * Sets the limits of a log module and level.
+ *
+ * @param key                     The module and level separated by a slash,
+ *                                e.g. @c lobby/error.
+ * @param value                   The rate, burst and sample separated by
+ *                                spaces, see
+ *                                @ref logging::tmodule_logger::set_limit().
+ */
+static void
+set_log_limit(const std::string& key, const std::string& value)
+{
+	const size_t separator = key.find('/');
+
+	logging::tlevel level;
+	unsigned rate;
+	unsigned burst;
+	unsigned sample;
+
+	std::istringstream arguments(value);
+	if(separator == std::string::npos
+			|| !(arguments >> rate >> burst >> sample)) {
+
+		throw lib::texception(
+				  lib::texception::ttype::invalid_value
+				, lib::concatenate(
+					  "Invalid log limit »log_limit/"
+					, key
+					, "« value »"
+					, value
+					, "«"));
+	}
+
+	key.substr(separator + 1) >> level;
+
+	logging::module::set_limit(
+			  key.substr(0, separator)
+			, level
+			, rate
+			, burst
+			, sample);
+}
+
+/**
+ * Parses the quota of a session.
+ *
+ * @param key                     The key of the quota, used in the error
+ *                                message.
+ * @param value                   The message rate, message burst, byte rate
+ *                                and byte burst separated by spaces.
+ * @param quota                   The quota to set.
+ */
+static void
+set_quota(
+		  const std::string& key
+		, const std::string& value
+		, tconfiguration::tquota& quota)
+{
+	std::istringstream arguments(value);
+	if(!(arguments
+			>> quota.message_rate
+			>> quota.message_burst
+			>> quota.byte_rate
+			>> quota.byte_burst)) {
+
+		throw lib::texception(
+				  lib::texception::ttype::invalid_value
+				, lib::concatenate(
+					  "Invalid quota »"
+					, key
+					, "« value »"
+					, value
+					, "«"));
+	}
+}
+
 const tconfiguration&
 tconfiguration::configuration()
 {
@@ -78,6 +172,59 @@ tconfiguration::create()
 		result.threads = ini.get("threads", result.threads);
 		result.port = ini.get("port", result.port);
 		result.reap_interval = ini.get("reap_interval", result.reap_interval);
+		result.session_grace_time = ini.get(
+				  "session_grace_time"
+				, result.session_grace_time);
+		result.session_replay_size = ini.get(
+				  "session_replay_size"
+				, result.session_replay_size);
+		result.max_connections = ini.get(
+				  "max_connections"
+				, result.max_connections);
+		result.max_connections_per_address = ini.get(
+				  "max_connections_per_address"
+				, result.max_connections_per_address);
+		result.connection_rate_per_address = ini.get(
+				  "connection_rate_per_address"
+				, result.connection_rate_per_address);
+
+		const std::pair<const char*, tquota*> quotas[] {
+			  {"quota/connected", &result.quota_connected}
+			, {"quota/lobby", &result.quota_lobby}
+			, {"quota/game", &result.quota_game}
+		};
+		for(const auto& quota : quotas) {
+			const auto value = ini.get_optional<std::string>(quota.first);
+			if(value) {
+				set_quota(quota.first, *value, *quota.second);
+			}
+		}
+
+		result.game_tick_interval = ini.get(
+				  "game_tick_interval"
+				, result.game_tick_interval);
+		result.journal_directory = ini.get(
+				  "journal_directory"
+				, result.journal_directory);
+		result.journal_snapshot_interval = ini.get(
+				  "journal_snapshot_interval"
+				, result.journal_snapshot_interval);
+		result.game_evict_time = ini.get(
+				  "game_evict_time"
+				, result.game_evict_time);
+		result.snapshot_directory = ini.get(
+				  "snapshot_directory"
+				, result.snapshot_directory);
+		result.log_ring_size = ini.get(
+				  "log_ring_size"
+				, result.log_ring_size);
+		result.log_full_policy = ini.get(
+				  "log_full_policy"
+				, result.log_full_policy
+				, tfull_policy_convertor());
+		result.log_deferred = ini.get(
+				  "log_deferred"
+				, result.log_deferred);
 
 		logging::tlevel log_level = ini.get(
 				  "log_level/global"
@@ -86,6 +233,34 @@ tconfiguration::create()
 
 		logging::module::set_threshold_level(log_level);
 
+		static const std::string log_limit = "log_limit/";
+		for(const auto& entry : ini) {
+			if(entry.first.compare(0, log_limit.size(), log_limit) == 0) {
+				set_log_limit(
+						  entry.first.substr(log_limit.size())
+						, entry.second.data());
+			}
+		}
+
+		result.log_file = ini.get(
+				  "log_file/name"
+				, result.log_file);
+		result.log_file_max_size = ini.get(
+				  "log_file/max_size"
+				, result.log_file_max_size);
+		result.log_file_max_age = ini.get(
+				  "log_file/max_age"
+				, result.log_file_max_age);
+		result.log_file_flush_size = ini.get(
+				  "log_file/flush_size"
+				, result.log_file_flush_size);
+		result.log_file_flush_interval = ini.get(
+				  "log_file/flush_interval"
+				, result.log_file_flush_interval);
+		result.recorder_file = ini.get(
+				  "recorder_file"
+				, result.recorder_file);
+
 		/**
 		 * @todo Add a log level for every module.
 		 * E.g. log_level/zard, log_level/lobby, etc. etc..
@@ -143,4 +318,19 @@ tconfiguration::validate()
 		LOG_W("Reap interval of »0« is invalid, set to »1«.\n");
 		reap_interval = 1;
 	}
+
+	if(session_replay_size == 0) {
+		LOG_W("Session replay size of »0« is invalid, set to »1«.\n");
+		session_replay_size = 1;
+	}
+
+	if(log_file_flush_interval == 0) {
+		LOG_W("Log file flush interval of »0« is invalid, set to »1«.\n");
+		log_file_flush_interval = 1;
+	}
+
+	if(journal_snapshot_interval == 0) {
+		LOG_W("Journal snapshot interval of »0« is invalid, set to »1«.\n");
+		journal_snapshot_interval = 1;
+	}
 }
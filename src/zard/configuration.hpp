@@ -20,6 +20,7 @@
 #ifndef ZARD_CONFIGURATION_HPP_INCLUDED
 #define ZARD_CONFIGURATION_HPP_INCLUDED
 
+#include "modules/logging/full_policy.hpp"
 #include "modules/logging/level.hpp"
 
 #include <string>
@@ -64,6 +65,32 @@ public:
 	static const tconfiguration&
 	configuration();
 
+	/***** ***** Types. ***** *****/
+
+	/**
+	 * The inbound quota of a session.
+	 *
+	 * The quota are token buckets, a session can send a burst of messages
+	 * and afterwards messages at the rate. A session over its quota is not
+	 * rejected, instead receiving its messages is paused. See
+	 * @ref lobby::tsession for more information.
+	 */
+	struct tquota
+	{
+		/** The number of messages per second, when @c 0 unlimited. */
+		unsigned message_rate;
+
+		/** The number of messages which can be received at once. */
+		unsigned message_burst;
+
+		/** The number of bytes per second, when @c 0 unlimited. */
+		unsigned byte_rate;
+
+		/** The number of bytes which can be received at once. */
+		unsigned byte_burst;
+	};
+
+
 	/***** ***** Members. ***** *****/
 
 	/**
@@ -84,6 +111,142 @@ public:
 	 */
 	unsigned reap_interval{30};
 
+	/**
+	 * The time a disconnected session can be resumed.
+	 *
+	 * The time is in seconds. See @ref lobby::tsession for more information.
+	 */
+	unsigned session_grace_time{60};
+
+	/**
+	 * The number of messages a session keeps to send again when resumed.
+	 *
+	 * See @ref lobby::tsession for more information.
+	 */
+	unsigned session_replay_size{64};
+
+	/**
+	 * The maximum number of connections of the server.
+	 *
+	 * When @c 0 unlimited, the number of connections is then only limited
+	 * by the number of file descriptors of the process. A connection over
+	 * the limit is closed before a session is created, see
+	 * @ref lobby::detail::tadmission.
+	 */
+	unsigned max_connections{0};
+
+	/** The maximum concurrent connections per address, @c 0 unlimited. */
+	unsigned max_connections_per_address{64};
+
+	/** The maximum new connections per address per second, @c 0 unlimited. */
+	unsigned connection_rate_per_address{16};
+
+	/** The quota of a session before logging in. */
+	tquota quota_connected{5, 10, 4096, 16384};
+
+	/** The quota of a session in the lobby. */
+	tquota quota_lobby{50, 100, 65536, 131072};
+
+	/** The quota of a session in a game. */
+	tquota quota_game{200, 400, 262144, 524288};
+
+	/**
+	 * The default tick interval of a game.
+	 *
+	 * The interval is in milliseconds, when @c 0 games have no tick. See
+	 * @ref game::tgame for more information.
+	 */
+	unsigned game_tick_interval{0};
+
+	/**
+	 * The directory to store the journal of the games.
+	 *
+	 * When empty the games are not stored on disk.
+	 */
+	std::string journal_directory{};
+
+	/**
+	 * The number of journal records after which a game writes a snapshot.
+	 *
+	 * A lower value reduces the time to recover a game, but increases the
+	 * number of snapshots written.
+	 */
+	unsigned journal_snapshot_interval{1000};
+
+	/**
+	 * The idle time after which a game is evicted from memory.
+	 *
+	 * The time is in seconds, when @c 0 games are never evicted. Games are
+	 * only evicted when stored in the journal and without connected
+	 * players. The games are checked every @ref reap_interval seconds.
+	 */
+	unsigned game_evict_time{0};
+
+	/**
+	 * The directory to write snapshots of the server state to.
+	 *
+	 * A snapshot is written upon receiving a @c SIGUSR1. When empty the
+	 * signal is not handled.
+	 */
+	std::string snapshot_directory{};
+
+	/**
+	 * The number of log messages buffered per thread.
+	 *
+	 * The messages are written by a dedicated thread, see
+	 * @ref logging::tbackend. When @c 0 the messages are written in the
+	 * server's own threads instead.
+	 */
+	unsigned log_ring_size{4096};
+
+	/** The action when the log ring of a thread is full. */
+	logging::tfull_policy log_full_policy{logging::tfull_policy::count};
+
+	/**
+	 * Should the log messages be formatted by the log writer thread?
+	 *
+	 * Only used when @ref log_ring_size is not @c 0. The server's threads
+	 * then only store the arguments of a message, see
+	 * @ref logging::tmodule_logger::is_deferred().
+	 */
+	bool log_deferred{true};
+
+	/**
+	 * The file to write the log to.
+	 *
+	 * When empty the log is written to @c std::cout and @c std::cerr. See
+	 * @ref logging::tfile for more information.
+	 */
+	std::string log_file{};
+
+	/**
+	 * The size after which the log file is rotated.
+	 *
+	 * The size is in bytes, when @c 0 the file is not rotated by size.
+	 */
+	size_t log_file_max_size{0};
+
+	/**
+	 * The age after which the log file is rotated.
+	 *
+	 * The age is in seconds, when @c 0 the file is not rotated by age.
+	 */
+	unsigned log_file_max_age{0};
+
+	/** The number of buffered bytes after which the log file is written. */
+	size_t log_file_flush_size{65536};
+
+	/** The maximum time in milliseconds the log file is buffered. */
+	unsigned log_file_flush_interval{1000};
+
+	/**
+	 * The file to dump the flight recorder to.
+	 *
+	 * The recorder is dumped upon a fatal signal, a failed validation and
+	 * upon receiving a @c SIGUSR2, see @ref logging::recorder.
+	 */
+	std::string recorder_file{"zard.recorder"};
+
 private:
 
 	/***** ***** Operators. ***** *****/
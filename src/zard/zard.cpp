@@ -16,13 +16,17 @@
 
 #include "lib/exception/exception.hpp"
 #include "lib/exception/exit.hpp"
+#include "lib/exception/validate.tpp"
 #include "modules/lobby/lobby.hpp"
+#include "modules/logging/file.hpp"
 #include "modules/logging/log.hpp"
+#include "modules/logging/recorder.hpp"
 #include "zard/configuration.hpp"
 #include "zard/options.hpp"
 
 #include <stdexcept>
 #include <iostream>
+#include <memory>
 
 int main(int argc, char* argv[])
 {
@@ -30,13 +34,38 @@ int main(int argc, char* argv[])
 
 		LOG_I("Starting.\n");
 
+		logging::recorder::install_signal_handlers();
+		lib::set_validate_failure_hook([]()
+			{
+				logging::recorder::dump();
+			});
+
 		const toptions& options = toptions::parse(argc, argv);
 		if(!options.foreground) {
 			LOG_W("Daemon mode not yet implemented.\n");
 		}
 
 		/* Call to initialize the configuration. */
-		tconfiguration::configuration();
+		const tconfiguration& configuration = tconfiguration::configuration();
+
+		logging::recorder::set_dump_file(configuration.recorder_file);
+
+		std::unique_ptr<logging::tfile> log_file;
+		if(!configuration.log_file.empty()) {
+			log_file.reset(new logging::tfile(
+					  configuration.log_file
+					, configuration.log_file_max_size
+					, configuration.log_file_max_age
+					, configuration.log_file_flush_size
+					, configuration.log_file_flush_interval));
+
+			logging::module::module_logger().set_stream_function(std::bind(
+					  &logging::tfile::ostream
+					, log_file.get()));
+
+			logging::module::module_logger().set_post_process_function(
+					std::bind(&logging::tfile::post_process, log_file.get()));
+		}
 
 		lobby::tlobby lobby;
 